@@ -0,0 +1,324 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File CompactScenarioSet.h ------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the CompactScenarioSet class, which represents a (finite)
+ * set of scenarios stored with a reduced precision (float or quantized
+ * 16-bit integers) to save memory and bandwidth.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __CompactScenarioSet
+#define __CompactScenarioSet
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioSet.h"
+
+#include <cstdint>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup CompactScenarioSet_CLASSES Classes in CompactScenarioSet.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- CLASS CompactScenarioSet -------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// a set of scenarios stored with a reduced precision
+/** The CompactScenarioSet class represents a finite set of scenarios, all
+ * having the same dimension, each one with an associated probability, like
+ * a ScenarioSet, but storing the values with one of the following
+ * precisions:
+ *
+ * - eDouble: as double (8 bytes per value), i.e., exactly;
+ *
+ * - eFloat: as float (4 bytes per value), i.e., with about 7 significant
+ *   digits;
+ *
+ * - eQuantized: as 16-bit unsigned integers q (2 bytes per value), the k-th
+ *   value of a scenario being offset[ k ] + scale[ k ] * q. The offset and
+ *   the scale of each entry are either given (see set_quantization()) or
+ *   computed out of the range of the values of the entry in a ScenarioSet
+ *   (see set_quantization( const ScenarioSet & )); the error is then at
+ *   most half the scale, i.e., 1 / 131070 of the range. Entries whose
+ *   values are integer in a range of at most 65535 values (say, those given
+ *   to a SimpleDataMapping with int data) get scale 1, and are stored
+ *   exactly.
+ *
+ * A scenario is decoded into double by get_scenario(), which is what
+ * StochasticBlock::set_data( const CompactScenarioSet & , Index ) does
+ * before scattering the scenario into the inner Block. The same formats can
+ * be written into, and memory-mapped from, a file (see MappedScenarioSet).
+ */
+
+class CompactScenarioSet
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+
+ /// the precisions of the stored values
+ enum Precision {
+  eDouble = 0 ,    ///< double values
+  eFloat = 1 ,     ///< float values
+  eQuantized = 2   ///< 16-bit unsigned integers with an offset and a scale
+ };
+
+/*--------------------------------------------------------------------------*/
+/*------------ CONSTRUCTING AND DESTRUCTING CompactScenarioSet -------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing CompactScenarioSet
+ *  @{ */
+
+ /// constructor
+ /** Constructs an empty CompactScenarioSet for scenarios of the given
+  * dimension, stored with the given precision. With eQuantized, the offset
+  * and the scale of the entries are initially 0 and 1, respectively (see
+  * set_quantization()).
+  *
+  * @param dimension The dimension of each scenario.
+  *
+  * @param precision The precision of the stored values. */
+
+ explicit CompactScenarioSet( Index dimension = 0 ,
+                              Precision precision = eFloat );
+
+/*--------------------------------------------------------------------------*/
+
+ /// constructs a CompactScenarioSet out of a ScenarioSet
+ /** Constructs a CompactScenarioSet holding the scenarios (and the
+  * probabilities) of the given ScenarioSet, stored with the given
+  * precision; with eQuantized, the offset and the scale of the entries are
+  * computed out of the ScenarioSet (see set_quantization()). */
+
+ CompactScenarioSet( const ScenarioSet & scenarios , Precision precision );
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of CompactScenarioSet
+
+ virtual ~CompactScenarioSet() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*-------------- METHODS FOR MODIFYING THE CompactScenarioSet --------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for modifying the CompactScenarioSet
+ *  @{ */
+
+ /// sets the offset and the scale of the quantized entries
+ /** Sets the offset and the scale (both having get_dimension() elements)
+  * of the entries when the precision is eQuantized. This can only be done
+  * when the set is empty; otherwise, std::logic_error is thrown. */
+
+ void set_quantization( std::vector< double > && offset ,
+                        std::vector< double > && scale );
+
+/*--------------------------------------------------------------------------*/
+
+ /// computes the offset and the scale of the entries out of a ScenarioSet
+ /** Computes the offset and the scale of the entries when the precision is
+  * eQuantized, so that the values of each entry in the given ScenarioSet
+  * (which must have dimension get_dimension()) are represented with the
+  * smallest error. This can only be done when the set is empty; otherwise,
+  * std::logic_error is thrown. */
+
+ void set_quantization( const ScenarioSet & scenarios );
+
+/*--------------------------------------------------------------------------*/
+
+ /// adds a new scenario to the set
+ /** This method adds a new scenario at the end of the set, converting its
+  * values to the precision of the set (with eQuantized, the values out of
+  * the range represented by the offset and the scale are clamped).
+  *
+  * @param scenario A pointer to the first element of the scenario, which
+  *        must have get_dimension() elements.
+  *
+  * @param probability The probability of the scenario, with the same
+  *        meaning as in ScenarioSet::add_scenario(). */
+
+ void add_scenario( const double * scenario , double probability = -1 );
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the probabilities of the scenarios (empty means equally likely)
+
+ void set_probabilities( std::vector< double > && probabilities );
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------- METHODS FOR READING THE CompactScenarioSet ---------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for reading the CompactScenarioSet
+ *  @{ */
+
+ /// returns the dimension of the scenarios
+
+ Index get_dimension() const { return dimension; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of scenarios
+
+ Index size() const { return number; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the precision of the stored values
+
+ Precision get_precision() const { return precision; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// decodes the i-th scenario into the given array of get_dimension() double
+
+ void get_scenario( Index i , double * scenario ) const {
+  decode( precision , get_data() + std::size_t( i ) * dimension *
+                      element_size( precision ) , dimension ,
+          offset.data() , scale.data() , scenario );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the probability of the i-th scenario
+
+ double get_probability( Index i ) const {
+  return probabilities.empty() ? 1.0 / number : probabilities[ i ];
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the probabilities (empty if the scenarios are equally likely)
+
+ const std::vector< double > & get_probabilities() const {
+  return probabilities;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the offset of the quantized entries (empty if not eQuantized)
+
+ const std::vector< double > & get_offset() const { return offset; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the scale of the quantized entries (empty if not eQuantized)
+
+ const std::vector< double > & get_scale() const { return scale; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the stored values, scenario after scenario
+
+ const unsigned char * get_data() const { return data.data(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of bytes of the stored values
+
+ std::size_t get_data_size() const { return data.size(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns a copy of the (decoded) scenarios as a ScenarioSet
+
+ ScenarioSet get_scenario_set() const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of bytes of a value stored with the given precision
+
+ static std::size_t element_size( Precision precision ) {
+  return precision == eDouble ? sizeof( double ) :
+         precision == eFloat ? sizeof( float ) : sizeof( std::uint16_t );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// decodes a scenario stored with the given precision into double
+ /** Decodes the given number of values, stored with the given precision
+  * starting at the given address, into the given array of double; offset
+  * and scale are only used with eQuantized. */
+
+ static void decode( Precision precision , const void * values ,
+                     Index dimension , const double * offset ,
+                     const double * scale , double * scenario );
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the dimension of the scenarios
+ Index dimension;
+
+ /// the number of scenarios
+ Index number = 0;
+
+ /// the precision of the stored values
+ Precision precision;
+
+ /// the stored values, scenario after scenario
+ std::vector< unsigned char > data;
+
+ /// the offset of the quantized entries
+ std::vector< double > offset;
+
+ /// the scale of the quantized entries
+ std::vector< double > scale;
+
+ /// the probabilities of the scenarios (empty if equally likely)
+ std::vector< double > probabilities;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class CompactScenarioSet )
+
+/** @} end( group( CompactScenarioSet_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* CompactScenarioSet.h included */
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File CompactScenarioSet.h -----------------------*/
+/*--------------------------------------------------------------------------*/
@@ -0,0 +1,412 @@
+/*--------------------------------------------------------------------------*/
+/*------------------------ File CompressedSubset.h -------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the CompressedSubset class, which stores a sequence of
+ * indices (a Block::Subset) as a list of arithmetic progressions, so that
+ * the long runs and strided patterns of the indices of a data mapping take
+ * constant memory.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __CompressedSubset
+#define __CompressedSubset
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "Block.h"
+
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup CompressedSubset_CLASSES Classes in CompressedSubset.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------ CLASS CompressedSubset --------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// a sequence of indices stored as a list of arithmetic progressions
+/** The CompressedSubset class stores a sequence of indices, as a
+ * Block::Subset does, but split into segments. A segment is either
+ *
+ * - a progression first, first + stride, ..., first + ( length - 1 ) *
+ *   stride, where the stride can be 1 (a run, i.e., a Range), any other
+ *   positive or negative integer, or 0 (the same index repeated length
+ *   times);
+ *
+ * - or a literal segment, whose length indices are stored explicitly (see
+ *   get_literals()), gathering the indices that do not belong to any long
+ *   enough progression.
+ *
+ * The indices of the data mappings of a StochasticBlock (both the entries
+ * of the scenario and the positions in the data of the Block) are most
+ * often a few runs and strided patterns, so that they take a few segments
+ * rather than one Index each, and reading them costs little memory
+ * bandwidth: the values at a run of positions can be copied with no index
+ * at all. The segments are computed greedily by the constructor: each
+ * progression of at least min_length indices becomes a segment, and the
+ * remaining indices are gathered into literal segments, so that a
+ * CompressedSubset never takes much more memory than the Subset.
+ *
+ * The indices are read either sequentially, by the (forward) iterators, or
+ * segment by segment (see for_each() and get_segments()), which is how the
+ * hot loops should read them. The segments can also be encoded into a
+ * sequence of Index (see encode() and decode()), which is how the
+ * "DataMappings" group written by StochasticBlock::serialize() stores the
+ * indices of the data mappings. */
+
+class CompressedSubset
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+ using Subset = Block::Subset;
+ using Range = Block::Range;
+
+ /// a segment of the indices
+ struct Segment {
+  /// the first index or, for a literal segment, the position in the
+  /// literals of its first index
+  Index first;
+  Index length;          ///< the number of indices of the segment
+  std::int64_t stride;   ///< the stride, or literal for a literal segment
+
+  /// the stride marking a literal segment
+  static constexpr std::int64_t literal =
+   std::numeric_limits< std::int64_t >::min();
+
+  /// tells whether the segment is a literal one
+  bool is_literal() const { return stride == literal; }
+
+  /// returns the k-th index of a segment that is not a literal one
+  Index operator[]( Index k ) const {
+   return Index( std::int64_t( first ) + stride * std::int64_t( k ) );
+  }
+ };
+
+ /// the minimum length of a progression stored as a segment
+ static constexpr Index min_length = 4;
+
+/*--------------------------------------------------------------------------*/
+ /// a forward iterator over the indices of a CompressedSubset
+
+ class const_iterator {
+
+ public:
+
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = Index;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const Index *;
+  using reference = Index;
+
+  const_iterator() = default;
+
+  const_iterator( const CompressedSubset * set , std::size_t segment )
+   : set( set ) , segment( segment ) {}
+
+  Index operator*() const {
+   const auto & current = set->segments[ segment ];
+   if( current.is_literal() )
+    return set->literals[ current.first + k ];
+   return current[ k ];
+  }
+
+  const_iterator & operator++() {
+   if( ++k == set->segments[ segment ].length ) {
+    ++segment;
+    k = 0;
+    }
+   return *this;
+  }
+
+  const_iterator operator++( int ) {
+   auto previous = *this;
+   ++( *this );
+   return previous;
+  }
+
+  bool operator==( const const_iterator & other ) const {
+   return ( segment == other.segment ) && ( k == other.k );
+  }
+
+  bool operator!=( const const_iterator & other ) const {
+   return ! ( *this == other );
+  }
+
+ private:
+
+  const CompressedSubset * set = nullptr;
+  std::size_t segment = 0;  ///< the current segment
+  Index k = 0;              ///< the position in the current segment
+ };
+
+/*--------------------------------------------------------------------------*/
+/*--------------- CONSTRUCTING AND DESTRUCTING CompressedSubset ------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing CompressedSubset
+ *  @{ */
+
+ /// constructs an empty CompressedSubset
+
+ CompressedSubset() = default;
+
+/*--------------------------------------------------------------------------*/
+
+ /// constructs a CompressedSubset holding the given indices
+
+ explicit CompressedSubset( const Subset & elements );
+
+/*--------------------------------------------------------------------------*/
+
+ /// constructs a CompressedSubset holding the indices of the given Range
+ /** The Range must be bounded; it becomes (at most) one segment. */
+
+ explicit CompressedSubset( const Range & range );
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of CompressedSubset
+
+ virtual ~CompressedSubset() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*---------------- METHODS FOR READING THE CompressedSubset ----------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Reading the CompressedSubset
+ *  @{ */
+
+ /// returns the number of indices
+
+ Index size() const { return number; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether there is no index
+
+ bool empty() const { return number == 0; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns an iterator to the first index
+
+ const_iterator begin() const { return const_iterator( this , 0 ); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns an iterator past the last index
+
+ const_iterator end() const {
+  return const_iterator( this , segments.size() );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// calls f( index ) for each index, in order
+ /** Calls \p f on each index, in order, with a loop specialized for each
+  * kind of segment; this is faster than reading the indices with the
+  * iterators. */
+
+ template< class F >
+ void for_each( F && f ) const {
+  for( const auto & segment : segments )
+   if( segment.is_literal() ) {
+    const auto first = literals.data() + segment.first;
+    for( Index k = 0 ; k < segment.length ; ++k )
+     f( first[ k ] );
+    }
+   else if( segment.stride == 1 )
+    for( Index k = segment.first ; k < segment.first + segment.length ; ++k )
+     f( k );
+   else
+    for( Index k = 0 ; k < segment.length ; ++k )
+     f( segment[ k ] );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// replaces each given position with the index at that position
+ /** Replaces each element k of \p positions, which must be increasing and
+  * smaller than size(), with the k-th index of this CompressedSubset.
+  * This costs O( positions.size() + number of segments ). */
+
+ void translate( Subset & positions ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the segments, in the order of the indices
+
+ const std::vector< Segment > & get_segments() const { return segments; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the indices of all the literal segments
+
+ const Subset & get_literals() const { return literals; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether the indices are consecutive increasing integers
+ /** Returns true if the indices are first, first + 1, ..., i.e., a Range
+  * (which is also the case if there is no index). */
+
+ bool is_range() const {
+  return segments.empty() ||
+         ( ( segments.size() == 1 ) && ( segments[ 0 ].stride == 1 ) );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether the indices are nondecreasing
+
+ bool is_sorted() const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the largest index (0 if there is no index)
+
+ Index max() const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// writes the indices into the given array of size() Index
+
+ void decompress( Index * elements ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the indices as a Subset
+
+ Subset decompress() const {
+  Subset elements( number );
+  decompress( elements.data() );
+  return elements;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the memory (in bytes) taken by the indices
+ /** Returns the memory taken by the segments and by the literals, to be
+  * compared with size() * sizeof( Index ) taken by a Subset. */
+
+ std::size_t memory() const {
+  return segments.capacity() * sizeof( Segment ) +
+         literals.capacity() * sizeof( Index );
+ }
+
+/** @} ---------------------------------------------------------------------*/
+/*---------------- METHODS FOR ENCODING THE CompressedSubset ---------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Encoding the CompressedSubset
+ *  @{ */
+
+ /// returns the number of Index written by encode()
+ /** Returns the number of Index written by encode(): three for each
+  * progression, and one more than its length for each literal segment. */
+
+ std::size_t encoded_size() const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// appends the encoding of the indices to the given Subset
+ /** Appends to \p words the encoding of the indices, which is the sequence
+  * of the encodings of the segments:
+  *
+  * - a progression is written as its length, its first index and its
+  *   stride (modulo 2^w, with w the number of bits of an Index, so that a
+  *   negative stride is written as its two's complement);
+  *
+  * - a literal segment is written as its length with the highest bit of
+  *   the Index set (see literal_flag), followed by its indices.
+  *
+  * This is how the "DataMappings" group written by
+  * StochasticBlock::serialize() stores a Subset whenever it is shorter
+  * than the Subset itself. If a segment has literal_flag or more indices,
+  * std::length_error is thrown. */
+
+ void encode( Subset & words ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the indices encoded by encode() in the given words
+ /** Returns the indices encoded by encode() in the \p number_words Index
+  * starting at \p words. If they are not a valid encoding, then
+  * std::invalid_argument is thrown. */
+
+ static Subset decode( Subset::const_iterator words , Index number_words );
+
+/*--------------------------------------------------------------------------*/
+
+ /// the bit marking the length of a literal segment in encode()
+ static constexpr Index literal_flag =
+  Index( 1 ) << ( std::numeric_limits< Index >::digits - 1 );
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the segments, in the order of the indices
+ std::vector< Segment > segments;
+
+ /// the indices of the literal segments
+ Subset literals;
+
+ /// the number of indices
+ Index number = 0;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class CompressedSubset )
+
+/** @} end( group( CompressedSubset_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* CompressedSubset.h included */
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- End File CompressedSubset.h ----------------------*/
+/*--------------------------------------------------------------------------*/
@@ -0,0 +1,374 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File MappedScenarioSet.h -------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the MappedScenarioSet class, which gives read-only access
+ * to a set of scenarios stored in a flat binary file by memory-mapping the
+ * file, rather than reading it.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __MappedScenarioSet
+#define __MappedScenarioSet
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "CompactScenarioSet.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- FORWARD DECLARATIONS --------------------------*/
+/*--------------------------------------------------------------------------*/
+
+class StochasticBlock;
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup MappedScenarioSet_CLASSES Classes in MappedScenarioSet.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- CLASS MappedScenarioSet --------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// a read-only set of scenarios memory-mapped from a binary file
+/** The MappedScenarioSet class gives read-only access to a set of scenarios
+ * stored in a flat binary file, which is memory-mapped rather than read:
+ * opening a file of any size costs (almost) nothing, and only the pages of
+ * the scenarios which are actually used are ever loaded into memory (and
+ * they can be dropped by the operating system when memory is scarce). The
+ * values can be stored with any of the precisions of a CompactScenarioSet.
+ * With double values, each scenario is a contiguous array of double inside
+ * the mapped file, which can be directly given to
+ * StochasticBlock::set_data(); otherwise, it is decoded into double by
+ * get_scenario( Index , double * ).
+ *
+ * The file, which is written by write(), is made of (all the integers and
+ * double being in the native byte order of the machine that wrote it, which
+ * is checked when the file is opened, and each section starting at a
+ * multiple of 64 bytes):
+ *
+ * - a header of 80 bytes, holding the magic string "SMSPPSCN", the version
+ *   of the format (currently 2; the files of version 1, whose header was
+ *   64 bytes long and had no precision, are rejected), the dimension and
+ *   the number of the scenarios, the number of data mappings, the offsets
+ *   (in bytes, 0 if absent) of the other sections and the precision of the
+ *   values (see CompactScenarioSet::Precision);
+ *
+ * - optionally, the probabilities of the scenarios (number double); if
+ *   absent, the scenarios are equally likely;
+ *
+ * - optionally, the layout of the data mappings of the StochasticBlock
+ *   the scenarios are meant for: the number of entries used by each data
+ *   mapping (one 64-bit integer each), followed by the positions in the
+ *   scenario of these entries (one 32-bit integer each), so that it can be
+ *   checked that the file matches a StochasticBlock (see matches());
+ *
+ * - with eQuantized values only, the offsets of the entries (dimension
+ *   double) followed by their scales (dimension double);
+ *
+ * - the scenarios, one after the other, each one being dimension values.
+ *
+ * Conversion from and to the netCDF format of a ScenarioSet (hence, of the
+ * "ScenarioSet" group of a StochasticBlock, see
+ * StochasticBlock::serialize()) is provided by convert() and serialize().
+ */
+
+class MappedScenarioSet
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+ using Subset = Block::Subset;
+ using Precision = CompactScenarioSet::Precision;
+
+/*--------------------------------------------------------------------------*/
+/*------------ CONSTRUCTING AND DESTRUCTING MappedScenarioSet --------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing MappedScenarioSet
+ *  @{ */
+
+ /// constructor
+ /** Memory-maps the given file, which must have been written by write(),
+  * throwing std::runtime_error if it cannot be opened or mapped and
+  * std::invalid_argument if it is not in the expected format.
+  *
+  * @param filename The name of the file. */
+
+ explicit MappedScenarioSet( const std::string & filename );
+
+ MappedScenarioSet( const MappedScenarioSet & ) = delete;
+
+ MappedScenarioSet & operator=( const MappedScenarioSet & ) = delete;
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of MappedScenarioSet: unmaps the file
+
+ virtual ~MappedScenarioSet();
+
+/** @} ---------------------------------------------------------------------*/
+/*-------------------- METHODS FOR READING THE SCENARIOS -------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for reading the scenarios
+ *  @{ */
+
+ /// returns the dimension of the scenarios
+
+ Index get_dimension() const { return dimension; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of scenarios
+
+ Index size() const { return number; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether there is no scenario
+
+ bool empty() const { return number == 0; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the precision of the stored values
+
+ Precision get_precision() const { return precision; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns a pointer to the first element of the given scenario
+ /** Returns a pointer to the first element of the given scenario, which is
+  * inside the mapped file (and therefore valid as long as this
+  * MappedScenarioSet exists), if the values are double; otherwise, returns
+  * nullptr (see get_scenario( Index , double * )). */
+
+ const double * get_scenario( Index i ) const {
+  if( precision != CompactScenarioSet::eDouble )
+   return nullptr;
+  return reinterpret_cast< const double * >( scenarios ) +
+         std::size_t( i ) * dimension;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// decodes the i-th scenario into the given array of get_dimension() double
+
+ void get_scenario( Index i , double * scenario ) const {
+  CompactScenarioSet::decode( precision , scenarios + std::size_t( i ) *
+                              dimension *
+                              CompactScenarioSet::element_size( precision ) ,
+                              dimension , quantization , quantization ?
+                              quantization + dimension : nullptr ,
+                              scenario );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the probability of the given scenario
+
+ double get_probability( Index i ) const {
+  return probabilities ? probabilities[ i ] : 1.0 / number;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of data mappings whose layout is in the file
+
+ Index get_number_data_mappings() const { return mapping_sizes.size(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the positions in the scenario used by the given data mapping
+
+ Subset get_scenario_positions( Index i ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether the scenarios match the data mappings of a StochasticBlock
+ /** Returns true if the file has no layout of the data mappings, or if its
+  * layout is the same as that of the data mappings of the given
+  * StochasticBlock (see StochasticBlock::get_scenario_positions()). */
+
+ bool matches( StochasticBlock & block ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns a copy of the scenarios as a ScenarioSet
+
+ ScenarioSet get_scenario_set() const;
+
+/** @} ---------------------------------------------------------------------*/
+/*---------------------- METHODS FOR WRITING THE FILES ---------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for writing the files
+ *  @{ */
+
+ /// writes a ScenarioSet into a file in the format of MappedScenarioSet
+ /** Writes the given ScenarioSet into the given file, in the format
+  * described in the general notes of this class, throwing
+  * std::runtime_error if the file cannot be written.
+  *
+  * @param filename The name of the file.
+  *
+  * @param scenarios The scenarios.
+  *
+  * @param block If not nullptr, the layout of the data mappings of this
+  *        StochasticBlock is also written.
+  *
+  * @param precision The precision of the values in the file (see
+  *        CompactScenarioSet). */
+
+ static void write( const std::string & filename ,
+                    const ScenarioSet & scenarios ,
+                    StochasticBlock * block = nullptr ,
+                    Precision precision = CompactScenarioSet::eDouble );
+
+/*--------------------------------------------------------------------------*/
+
+ /// writes a CompactScenarioSet into a file of MappedScenarioSet
+ /** Writes the given CompactScenarioSet into the given file, with its
+  * precision, as write( const std::string & , const ScenarioSet & ,
+  * StochasticBlock * , Precision ) does. */
+
+ static void write( const std::string & filename ,
+                    const CompactScenarioSet & scenarios ,
+                    StochasticBlock * block = nullptr );
+
+/*--------------------------------------------------------------------------*/
+
+ /// converts a netCDF ScenarioSet into a file of MappedScenarioSet
+ /** Reads a ScenarioSet out of the given netCDF::NcGroup, in the format
+  * described in ScenarioSet::serialize() (say, the "ScenarioSet" group of
+  * a serialized StochasticBlock), and writes it into the given file.
+  *
+  * @param group The netCDF::NcGroup holding the ScenarioSet.
+  *
+  * @param filename The name of the file.
+  *
+  * @param block If not nullptr, the layout of the data mappings of this
+  *        StochasticBlock is also written.
+  *
+  * @param precision The precision of the values in the file. */
+
+ static void convert( const netCDF::NcGroup & group ,
+                      const std::string & filename ,
+                      StochasticBlock * block = nullptr ,
+                      Precision precision = CompactScenarioSet::eDouble );
+
+/*--------------------------------------------------------------------------*/
+
+ /// serializes the scenarios into a netCDF::NcGroup
+ /** Serializes the scenarios into the given netCDF::NcGroup in the format
+  * described in ScenarioSet::serialize(), so that the group can be read as
+  * the "ScenarioSet" group of a StochasticBlock. */
+
+ void serialize( netCDF::NcGroup & group ) const {
+  get_scenario_set().serialize( group );
+ }
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED METHODS -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// writes the file out of the given (already encoded) values
+
+ static void write_file( const std::string & filename , Index dimension ,
+                         Index number , Precision precision ,
+                         const void * data , std::size_t data_size ,
+                         const std::vector< double > & probabilities ,
+                         const std::vector< double > & q_offset ,
+                         const std::vector< double > & q_scale ,
+                         StochasticBlock * block );
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the mapped file (or its content, if it cannot be mapped)
+ const char * file = nullptr;
+
+ /// the size of the mapped file
+ std::size_t file_size = 0;
+
+ /// the content of the file, if it cannot be memory-mapped
+ std::vector< char > buffer;
+
+ /// the dimension of the scenarios
+ Index dimension = 0;
+
+ /// the number of scenarios
+ Index number = 0;
+
+ /// the precision of the stored values
+ Precision precision = CompactScenarioSet::eDouble;
+
+ /// the scenarios, inside the file
+ const char * scenarios = nullptr;
+
+ /// the offsets followed by the scales of the quantized entries, if any
+ const double * quantization = nullptr;
+
+ /// the probabilities, inside the file (nullptr if all equal)
+ const double * probabilities = nullptr;
+
+ /// the number of entries used by each data mapping
+ std::vector< std::size_t > mapping_sizes;
+
+ /// the positions used by all the data mappings, inside the file
+ const std::uint32_t * positions = nullptr;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class MappedScenarioSet )
+
+/** @} end( group( MappedScenarioSet_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* MappedScenarioSet.h included */
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File MappedScenarioSet.h ------------------------*/
+/*--------------------------------------------------------------------------*/
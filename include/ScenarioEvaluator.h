@@ -0,0 +1,259 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioEvaluator.h -------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the ScenarioEvaluator class, which evaluates (say, solves)
+ * a StochasticBlock over many scenarios in parallel, by means of a pool of
+ * independent "worker" StochasticBlocks.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ScenarioEvaluator
+#define __ScenarioEvaluator
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "StochasticBlock.h"
+
+#include <functional>
+#include <memory>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup ScenarioEvaluator_CLASSES Classes in ScenarioEvaluator.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- CLASS ScenarioEvaluator --------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// evaluates a StochasticBlock over many scenarios in parallel
+/** A StochasticBlock has a single inner Block, and therefore its scenarios
+ * can only be considered one at a time. The ScenarioEvaluator class keeps a
+ * pool of "worker" StochasticBlocks, each one having its own inner Block
+ * (and its own data mappings, referring to that inner Block), which are
+ * supposed to represent the same model. The scenarios are then distributed
+ * among the workers, each one running in its own thread.
+ *
+ * Each worker is initially given a contiguous chunk of the scenarios; when a
+ * worker has finished its chunk, it "steals" half of the remaining scenarios
+ * of the most loaded worker. This balances the load also when the time
+ * required to evaluate a scenario varies a lot from one scenario to the
+ * other, while keeping contiguous scenarios on the same worker as much as
+ * possible (which is useful, e.g., in the delta mode of set_data()).
+ *
+ * The evaluation of each scenario is performed by a user-provided function,
+ * which is called with the worker StochasticBlock and the index of the
+ * scenario; typically, this function sets the data of the worker to the
+ * scenario (which is done automatically by evaluate() when given a
+ * ScenarioSet) and then solves it with a Solver attached to the worker.
+ * Since all the workers run concurrently, this function must not modify
+ * any data shared among the workers. */
+
+class ScenarioEvaluator
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+
+ /// function evaluating a scenario on a worker StochasticBlock
+ using Evaluation = std::function< void( StochasticBlock & , Index ) >;
+
+ /// function constructing the worker with the given index
+ using WorkerFactory =
+  std::function< std::unique_ptr< StochasticBlock >( Index ) >;
+
+/*--------------------------------------------------------------------------*/
+/*------------ CONSTRUCTING AND DESTRUCTING ScenarioEvaluator --------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing ScenarioEvaluator
+ *  @{ */
+
+ /// constructor taking the workers
+ /** Constructs a ScenarioEvaluator with the given workers, which become
+  * owned by the ScenarioEvaluator. All the workers must be distinct
+  * StochasticBlocks not sharing any data (in particular, their inner
+  * Blocks), since they are used concurrently.
+  *
+  * @param workers The vector of worker StochasticBlocks, which must be
+  *        non-empty. */
+
+ explicit ScenarioEvaluator(
+  std::vector< std::unique_ptr< StochasticBlock > > && workers );
+
+/*--------------------------------------------------------------------------*/
+
+ /// constructor taking a function to construct the workers
+ /** Constructs a ScenarioEvaluator with the given number of workers, each
+  * one being constructed by the given function (which is called in the
+  * calling thread, with the index of the worker as its argument).
+  *
+  * @param number_workers The number of workers; if it is zero, then
+  *        std::thread::hardware_concurrency() workers are constructed.
+  *
+  * @param factory The function constructing the workers. */
+
+ ScenarioEvaluator( Index number_workers , const WorkerFactory & factory );
+
+/*--------------------------------------------------------------------------*/
+
+ /// constructor taking a prototype of the workers
+ /** Constructs a ScenarioEvaluator with the given number of workers, each
+  * one being a deep copy of \p prototype (see StochasticBlock::clone()),
+  * which is not used by the ScenarioEvaluator.
+  *
+  * @param prototype The StochasticBlock to be copied.
+  *
+  * @param number_workers The number of workers; if it is zero, then
+  *        std::thread::hardware_concurrency() workers are constructed. */
+
+ ScenarioEvaluator( StochasticBlock & prototype , Index number_workers )
+  : ScenarioEvaluator( number_workers , [ & prototype ]( Index ) {
+                        return prototype.clone();
+                       } ) {}
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of ScenarioEvaluator: destroys all the workers
+
+ virtual ~ScenarioEvaluator() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- METHODS FOR EVALUATING SCENARIOS -------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for evaluating scenarios
+ *  @{ */
+
+ /// evaluates the given number of scenarios
+ /** Evaluates scenarios 0, ..., number_scenarios - 1 in parallel, by
+  * calling \p evaluation( worker , i ) for each scenario i on some worker.
+  * Each scenario is evaluated exactly once. If any of the calls to \p
+  * evaluation throws an exception, the remaining scenarios are not
+  * evaluated, all the workers are stopped and the (first) exception is
+  * rethrown to the caller.
+  *
+  * @param number_scenarios The number of scenarios.
+  *
+  * @param evaluation The function evaluating a scenario. */
+
+ void evaluate( Index number_scenarios , const Evaluation & evaluation );
+
+/*--------------------------------------------------------------------------*/
+
+ /// evaluates all the scenarios of a ScenarioSet, collecting the results
+ /** Evaluates all the scenarios of the given ScenarioSet in parallel: for
+  * each scenario i, some worker is set to scenario i (see
+  * StochasticBlock::set_data( const ScenarioSet & , Index ), followed by
+  * StochasticBlock::flush_data() in case the worker is in deferred mode)
+  * and then \p function( worker , i ) is called. The value returned by \p
+  * function is the result of the evaluation of scenario i, which is placed
+  * at position i of the returned vector.
+  *
+  * @param scenarios The ScenarioSet, which is only read.
+  *
+  * @param function The function evaluating a scenario, returning a Result.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued
+  *        by set_data(), as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued
+  *        by set_data(), as described in Observer::make_par().
+  *
+  * @return The vector with the results of all the scenarios, in the same
+  *         order as the scenarios. */
+
+ template< class Result , class Function >
+ std::vector< Result > evaluate( const ScenarioSet & scenarios ,
+                                 Function && function ,
+                                 c_ModParam issuePMod = eNoBlck ,
+                                 c_ModParam issueAMod = eNoBlck ) {
+  static_assert( ! std::is_same_v< Result , bool > ,
+                 "std::vector< bool > cannot be written concurrently" );
+
+  std::vector< Result > results( scenarios.size() );
+  evaluate( scenarios.size() ,
+            [ & ]( StochasticBlock & worker , Index scenario ) {
+             worker.set_data( scenarios , scenario , issuePMod , issueAMod );
+             worker.flush_data();
+             results[ scenario ] = function( worker , scenario );
+            } );
+  return results;
+ }
+
+/** @} ---------------------------------------------------------------------*/
+/*-------------- METHODS FOR READING THE DATA OF THE ScenarioEvaluator -----*/
+/*--------------------------------------------------------------------------*/
+/** @name Reading the data of the ScenarioEvaluator
+ *  @{ */
+
+ /// returns the number of workers
+
+ Index get_number_workers() const { return workers.size(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the worker with the given index
+
+ StochasticBlock & get_worker( Index worker ) const {
+  return *workers.at( worker );
+ }
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the worker StochasticBlocks
+ std::vector< std::unique_ptr< StochasticBlock > > workers;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class ScenarioEvaluator )
+
+/** @} end( group( ScenarioEvaluator_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ScenarioEvaluator.h included */
+
+/*--------------------------------------------------------------------------*/
+/*--------------------- End File ScenarioEvaluator.h -----------------------*/
+/*--------------------------------------------------------------------------*/
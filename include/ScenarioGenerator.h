@@ -0,0 +1,249 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioGenerator.h -------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the ScenarioGenerator class, which is the base class of
+ * all the objects that can randomly generate scenarios for the data of a
+ * StochasticBlock, and for the ScenarioSetSampler class, which generates
+ * them by sampling a ScenarioSet.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ScenarioGenerator
+#define __ScenarioGenerator
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioSet.h"
+
+#include <cstdint>
+#include <random>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup ScenarioGenerator_CLASSES Classes in ScenarioGenerator.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- CLASS ScenarioGenerator --------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// base class for the random generators of scenarios
+/** The ScenarioGenerator class is the base class of all the objects
+ * describing a probability distribution (or some stochastic process) for
+ * the data of a StochasticBlock, in the form of a way to generate random
+ * scenarios.
+ *
+ * A scenario is generated by generate(), which writes it directly into a
+ * buffer provided by the caller (say, a std::vector< double > reused over
+ * many calls, or a scenario of a ScenarioSet), so that no memory is ever
+ * allocated for generating a scenario. The source of randomness is a
+ * RandomEngine also provided by the caller; since generate() is const, the
+ * same ScenarioGenerator can be used concurrently by many threads, as long
+ * as each one uses its own RandomEngine.
+ *
+ * In order to have reproducible results also when the scenarios are
+ * generated in parallel, a RandomEngine for each independent "stream" of
+ * random numbers can be obtained with get_engine(), which only depends on
+ * the seed and on the index of the stream. This is exploited by fill(),
+ * which generates many scenarios into a ScenarioSet in parallel, always
+ * obtaining the same scenarios for the same seed, irrespective of the
+ * number of threads. */
+
+class ScenarioGenerator
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+
+ /// the source of randomness of the generators
+ using RandomEngine = std::mt19937_64;
+
+/*--------------------------------------------------------------------------*/
+/*------------- CONSTRUCTING AND DESTRUCTING ScenarioGenerator -------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing ScenarioGenerator
+ *  @{ */
+
+ /// destructor of ScenarioGenerator
+
+ virtual ~ScenarioGenerator() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*-------------------- METHODS FOR GENERATING SCENARIOS --------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for generating scenarios
+ *  @{ */
+
+ /// returns the dimension of the generated scenarios
+
+ virtual Index get_dimension() const = 0;
+
+/*--------------------------------------------------------------------------*/
+
+ /// generates a random scenario
+ /** This method generates a random scenario and writes it into the
+  * get_dimension() elements starting from the given iterator.
+  *
+  * @param scenario An iterator to the first element of the buffer where
+  *        the scenario must be written.
+  *
+  * @param engine The source of randomness. */
+
+ virtual void generate( std::vector< double >::iterator scenario ,
+                        RandomEngine & engine ) const = 0;
+
+/*--------------------------------------------------------------------------*/
+
+ /// generates the given number of scenarios into a ScenarioSet
+ /** This method replaces the content of the given ScenarioSet with \p
+  * number random scenarios, which are all equally likely. The scenarios
+  * are generated in chunks of stream_length() consecutive scenarios, each
+  * chunk using its own stream (see get_engine()), and the chunks are
+  * distributed over the given number of threads. Hence, for a given seed
+  * the same scenarios are generated whatever the number of threads is. If
+  * generate() throws an exception, all the threads are stopped and the
+  * exception is rethrown.
+  *
+  * @param scenarios The ScenarioSet where the scenarios are written.
+  *
+  * @param number The number of scenarios to be generated.
+  *
+  * @param seed The seed of the random number generation.
+  *
+  * @param number_threads The number of threads to be used; if it is zero,
+  *        std::thread::hardware_concurrency() threads are used. */
+
+ void fill( ScenarioSet & scenarios , Index number , std::uint64_t seed ,
+            Index number_threads = 1 ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the RandomEngine for the given stream
+ /** This method returns the RandomEngine for the given stream and seed.
+  * Different streams (or seeds) give statistically independent sequences
+  * of random numbers; the same stream and seed always give the same one.
+  *
+  * @param seed The seed of the random number generation.
+  *
+  * @param stream The index of the stream. */
+
+ static RandomEngine get_engine( std::uint64_t seed , Index stream ) {
+  std::seed_seq sequence{ std::uint32_t( seed ) ,
+                          std::uint32_t( seed >> 32 ) ,
+                          std::uint32_t( stream ) };
+  return RandomEngine( sequence );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of consecutive scenarios generated by each stream
+
+ static constexpr Index stream_length() { return 64; }
+
+/** @} ---------------------------------------------------------------------*/
+
+};   // end( class ScenarioGenerator )
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- CLASS ScenarioSetSampler -------------------------*/
+/*--------------------------------------------------------------------------*/
+/// a ScenarioGenerator sampling the scenarios of a ScenarioSet
+/** The ScenarioSetSampler class is a ScenarioGenerator describing the
+ * discrete probability distribution given by a ScenarioSet: each generated
+ * scenario is one of the scenarios of the ScenarioSet, chosen according to
+ * their probabilities. This can be used, e.g., to sample from a large set of
+ * historical scenarios, or to perform a bootstrap. */
+
+class ScenarioSetSampler : public ScenarioGenerator
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+ /// constructor
+ /** Constructs a ScenarioSetSampler for the given (non-empty) ScenarioSet,
+  * which is copied (so that it can be safely changed or destroyed
+  * afterwards).
+  *
+  * @param scenarios The ScenarioSet to be sampled. */
+
+ explicit ScenarioSetSampler( const ScenarioSet & scenarios );
+
+/*--------------------------------------------------------------------------*/
+
+ Index get_dimension() const override { return scenarios.get_dimension(); }
+
+/*--------------------------------------------------------------------------*/
+
+ void generate( std::vector< double >::iterator scenario ,
+                RandomEngine & engine ) const override;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the index of a scenario of the ScenarioSet drawn at random
+
+ Index draw( RandomEngine & engine ) const;
+
+/*--------------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+ /// the ScenarioSet being sampled
+ ScenarioSet scenarios;
+
+ /// the cumulative probabilities of the scenarios (empty if all equal)
+ std::vector< double > cumulative;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class ScenarioSetSampler )
+
+/** @} end( group( ScenarioGenerator_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ScenarioGenerator.h included */
+
+/*--------------------------------------------------------------------------*/
+/*--------------------- End File ScenarioGenerator.h -----------------------*/
+/*--------------------------------------------------------------------------*/
@@ -0,0 +1,319 @@
+/*--------------------------------------------------------------------------*/
+/*------------------------ File ScenarioOrdering.h -------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the ScenarioOrdering class, which reorders the scenarios
+ * of a ScenarioSet so that consecutive scenarios are as close as possible,
+ * and therefore switching from one to the next changes as little as
+ * possible of the inner Block of a StochasticBlock.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ScenarioOrdering
+#define __ScenarioOrdering
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioSet.h"
+
+#include <cstdint>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup ScenarioOrdering_CLASSES Classes in ScenarioOrdering.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------ CLASS ScenarioOrdering --------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// reorders the scenarios of a ScenarioSet to maximize the reuse
+/** When all the scenarios of a ScenarioSet are given, one after the other,
+ * to StochasticBlock::set_data(), the work done at each switch (the entries
+ * written in delta mode, the Modification issued, the work of a Solver
+ * updating its model and restarting from the previous solution) depends on
+ * how much consecutive scenarios differ. The ScenarioOrdering class
+ * computes an order of the scenarios (a permutation) in which consecutive
+ * scenarios are close, in one of the following metrics:
+ *
+ * - eChangedEntries: the number of entries that differ, i.e., what the
+ *   delta mode of set_data() writes; ties are broken by the Euclidean
+ *   distance;
+ *
+ * - eEuclidean: the Euclidean distance.
+ *
+ * Only the given positions of the scenarios are considered (see
+ * set_positions()), say, the entries used by the data mappings of the
+ * StochasticBlock (see StochasticBlock::get_scenario_positions()). Two
+ * heuristics are available:
+ *
+ * - nearest neighbour, which starts from the first scenario and
+ *   repeatedly moves to the closest scenario not yet taken; this requires
+ *   O( n^2 ) distance evaluations for n scenarios, unless the candidates
+ *   considered at each step are limited to a random sample of the
+ *   remaining scenarios (see set_max_candidates());
+ *
+ * - clustering, which recursively splits the scenarios in two halves along
+ *   their principal direction (the one with the largest variance), down to
+ *   clusters of at most set_cluster_size() scenarios, and then orders each
+ *   cluster by nearest neighbour, the clusters being concatenated in the
+ *   order of the split; this requires O( n log n ) work plus the nearest
+ *   neighbour within the clusters, and is suited for very large n. */
+
+class ScenarioOrdering
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+ using Subset = Block::Subset;
+
+ /// the available ordering heuristics
+ enum Method {
+  eNearestNeighbour ,  ///< greedy nearest neighbour
+  eClustering          ///< principal-direction splitting + nearest neighbour
+ };
+
+ /// the available metrics between scenarios
+ enum Metric {
+  eChangedEntries ,  ///< number of changed entries, then Euclidean distance
+  eEuclidean         ///< Euclidean distance
+ };
+
+/*--------------------------------------------------------------------------*/
+/*------------- CONSTRUCTING AND DESTRUCTING ScenarioOrdering --------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing ScenarioOrdering
+ *  @{ */
+
+ /// constructor
+ /** Constructs a ScenarioOrdering using the given heuristic and metric.
+  *
+  * @param method The heuristic to be used.
+  *
+  * @param metric The metric to be used. */
+
+ explicit ScenarioOrdering( Method method = eNearestNeighbour ,
+                            Metric metric = eChangedEntries )
+  : method( method ) , metric( metric ) {}
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of ScenarioOrdering
+
+ virtual ~ScenarioOrdering() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*----------------------- METHODS FOR SETTING PARAMETERS -------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for setting the parameters
+ *  @{ */
+
+ /// sets the heuristic to be used
+
+ void set_method( Method method ) { this->method = method; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the metric to be used
+
+ void set_metric( Metric metric ) { this->metric = metric; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the positions of the entries to be considered
+ /** Sets the positions of the entries of the scenarios to be considered by
+  * the metric; if it is empty (the default), all the entries are
+  * considered. */
+
+ void set_positions( Subset && positions ) {
+  this->positions = std::move( positions );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the maximum number of candidates of each nearest neighbour step
+ /** Sets the maximum number of candidate scenarios that are considered at
+  * each step of nearest neighbour. If it is zero (the default), all the
+  * remaining scenarios are considered; otherwise, if there are more
+  * remaining scenarios than this number, a random sample of them (see
+  * set_seed()) is considered. */
+
+ void set_max_candidates( Index max_candidates ) {
+  this->max_candidates = max_candidates;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the seed used for sampling the candidates of nearest neighbour
+
+ void set_seed( std::uint64_t seed ) { this->seed = seed; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the maximum number of scenarios in a cluster (see eClustering)
+
+ void set_cluster_size( Index cluster_size ) {
+  this->cluster_size = std::max( cluster_size , Index( 1 ) );
+ }
+
+/** @} ---------------------------------------------------------------------*/
+/*---------------------- METHODS FOR ORDERING SCENARIOS --------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for ordering scenarios
+ *  @{ */
+
+ /// returns the order of the scenarios of the given ScenarioSet
+ /** This method returns the order in which the scenarios of \p scenarios
+  * should be considered, as a permutation of 0, ..., scenarios.size() - 1
+  * (the first element being the index of the first scenario, and so on).
+  * With eNearestNeighbour, the first scenario is always scenario 0.
+  *
+  * @param scenarios The ScenarioSet.
+  *
+  * @return The order of the scenarios. */
+
+ std::vector< Index > order( const ScenarioSet & scenarios ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns a copy of the given ScenarioSet with the scenarios reordered
+ /** This method returns a ScenarioSet with the scenarios of \p scenarios
+  * (and their probabilities) in the order returned by order().
+  *
+  * @param scenarios The ScenarioSet.
+  *
+  * @param permutation If not nullptr, on return it contains the order,
+  *        i.e., the index in \p scenarios of each scenario of the returned
+  *        ScenarioSet.
+  *
+  * @return The reordered ScenarioSet. */
+
+ ScenarioSet reorder( const ScenarioSet & scenarios ,
+                      std::vector< Index > * permutation = nullptr ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// computes the cost of a sweep over the scenarios in the given order
+ /** Computes the total number of entries (among the considered positions,
+  * see set_positions()) that change, and the total Euclidean distance,
+  * between consecutive scenarios in the given order.
+  *
+  * @param scenarios The ScenarioSet.
+  *
+  * @param permutation The order of the scenarios (all of them, or some).
+  *
+  * @param changed_entries If not nullptr, on return it contains the total
+  *        number of changed entries.
+  *
+  * @param distance If not nullptr, on return it contains the total
+  *        Euclidean distance. */
+
+ void evaluate( const ScenarioSet & scenarios ,
+                const std::vector< Index > & permutation ,
+                std::size_t * changed_entries ,
+                double * distance = nullptr ) const;
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED TYPES -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the matrix of the considered entries, one column for each scenario
+ using c_Ref = Eigen::Ref< const Eigen::MatrixXd >;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED METHODS -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// orders the given scenarios (columns of X) by nearest neighbour
+ /** Orders the scenarios in \p columns (columns of \p X) by nearest
+  * neighbour, starting from the one closest to the last scenario in \p
+  * result (or from the first one, if \p result is empty), and appends them
+  * to \p result in that order. */
+
+ void nearest_neighbour( const c_Ref & X , Subset && columns ,
+                         std::vector< Index > & result ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// orders the given scenarios (columns of X) by clustering
+ /** Recursively splits the scenarios in \p columns (columns of \p X) along
+  * their principal direction, and appends them to \p result cluster by
+  * cluster. */
+
+ void clustering( const c_Ref & X , Subset && columns ,
+                  std::vector< Index > & result ) const;
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the heuristic to be used
+ Method method;
+
+ /// the metric to be used
+ Metric metric;
+
+ /// the positions of the entries to be considered (empty = all)
+ Subset positions;
+
+ /// the maximum number of candidates of each nearest neighbour step (0 = all)
+ Index max_candidates = 0;
+
+ /// the seed used for sampling the candidates of nearest neighbour
+ std::uint64_t seed = 0;
+
+ /// the maximum number of scenarios in a cluster
+ Index cluster_size = 256;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class ScenarioOrdering )
+
+/** @} end( group( ScenarioOrdering_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ScenarioOrdering.h included */
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- End File ScenarioOrdering.h -----------------------*/
+/*--------------------------------------------------------------------------*/
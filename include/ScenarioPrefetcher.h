@@ -0,0 +1,310 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioPrefetcher.h ------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the ScenarioPrefetcher class, which loads (reads and
+ * decodes) the next scenarios to be given to a StochasticBlock in a
+ * background thread, so that the loading is taken off the critical path of
+ * the loop "set the data, solve, repeat".
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ScenarioPrefetcher
+#define __ScenarioPrefetcher
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "MappedScenarioSet.h"
+#include "StochasticBlock.h"
+
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup ScenarioPrefetcher_CLASSES Classes in ScenarioPrefetcher.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- CLASS ScenarioPrefetcher -------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// loads the next scenarios in a background thread
+/** A typical driver loop takes a scenario, gives it to a StochasticBlock
+ * with set_data(), solves the inner Block and then moves on to the next
+ * scenario. When the scenarios come from a file (see MappedScenarioSet) or
+ * are stored with a reduced precision (see CompactScenarioSet), reading
+ * and decoding the next scenario is on the critical path of this loop.
+ *
+ * The ScenarioPrefetcher class loads the scenarios of a given sequence in a
+ * background thread, into a ring of depth() buffers: while the caller uses
+ * the scenario in one buffer, the following depth() - 1 scenarios are being
+ * (or have already been) loaded into the other ones. The scenarios are then
+ * taken, in the order of the sequence, with next() (or apply_next(), which
+ * also passes the scenario to a StochasticBlock). The buffers are
+ * std::vector< double >, so that StochasticBlock::set_data() reads them
+ * directly, without any further copy.
+ *
+ * A scenario is loaded by a function writing the scenario with a given
+ * index into a given array of double; functions are provided for
+ * ScenarioSet, CompactScenarioSet and MappedScenarioSet, which must not be
+ * modified (or destroyed) while the ScenarioPrefetcher is running. The
+ * function is called in the background thread, and therefore it must not
+ * touch anything the calling thread is changing at the same time. If it
+ * throws an exception, this is rethrown by the next() call that would have
+ * returned that scenario. */
+
+class ScenarioPrefetcher
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+
+ /// function writing the scenario with the given index into the given array
+ using Loader = std::function< void( Index , double * ) >;
+
+/*--------------------------------------------------------------------------*/
+/*------------ CONSTRUCTING AND DESTRUCTING ScenarioPrefetcher -------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing ScenarioPrefetcher
+ *  @{ */
+
+ /// constructor taking the function loading the scenarios
+ /** Constructs a ScenarioPrefetcher for scenarios of the given dimension,
+  * loaded by the given function. No scenario is loaded until start() is
+  * called.
+  *
+  * @param dimension The dimension of each scenario.
+  *
+  * @param loader The function loading the scenarios.
+  *
+  * @param depth The number of buffers, i.e., the number of scenarios that
+  *        can be loaded ahead plus the one being used; it must be at least
+  *        2 (double buffering), and smaller values are increased to 2. */
+
+ ScenarioPrefetcher( Index dimension , Loader loader , Index depth = 2 );
+
+/*--------------------------------------------------------------------------*/
+
+ /// constructor loading the scenarios of a ScenarioSet
+
+ explicit ScenarioPrefetcher( const ScenarioSet & scenarios ,
+                              Index depth = 2 );
+
+/*--------------------------------------------------------------------------*/
+
+ /// constructor loading (and decoding) the scenarios of a CompactScenarioSet
+
+ explicit ScenarioPrefetcher( const CompactScenarioSet & scenarios ,
+                              Index depth = 2 );
+
+/*--------------------------------------------------------------------------*/
+
+ /// constructor loading (and decoding) the scenarios of a MappedScenarioSet
+
+ explicit ScenarioPrefetcher( const MappedScenarioSet & scenarios ,
+                              Index depth = 2 );
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of ScenarioPrefetcher: stops the background thread
+
+ virtual ~ScenarioPrefetcher() { stop(); }
+
+/*--------------------------------------------------------------------------*/
+
+ ScenarioPrefetcher( const ScenarioPrefetcher & ) = delete;
+
+ ScenarioPrefetcher & operator=( const ScenarioPrefetcher & ) = delete;
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- METHODS FOR TAKING THE SCENARIOS -------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for taking the scenarios
+ *  @{ */
+
+ /// starts loading the scenarios with the given indices, in this order
+ /** Starts loading, in the background thread, the scenarios whose indices
+  * are given, in the given order (an index can be repeated). If the
+  * ScenarioPrefetcher was already running, it is first stopped (see
+  * stop()). */
+
+ void start( std::vector< Index > && sequence );
+
+/*--------------------------------------------------------------------------*/
+
+ /// starts loading the scenarios first, ..., last - 1
+
+ void start( Index first , Index last );
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the next scenario of the sequence
+ /** Returns the buffer holding the next scenario of the sequence given to
+  * start(), waiting for it to be loaded if needed; nullptr is returned
+  * when all the scenarios have been taken (or start() has not been
+  * called). The buffer is valid until the next call to next(),
+  * apply_next(), start() or stop(): calling next() also gives the buffer
+  * of the previous scenario back to the background thread. If the loading
+  * function has thrown an exception when loading this scenario, the
+  * exception is rethrown here, and the ScenarioPrefetcher is stopped. */
+
+ const std::vector< double > * next();
+
+/*--------------------------------------------------------------------------*/
+
+ /// gives the next scenario of the sequence to the given StochasticBlock
+ /** Takes the next scenario of the sequence (see next()) and, if there is
+  * one, gives it to \p block with StochasticBlock::set_data().
+  *
+  * @return false if all the scenarios have already been taken. */
+
+ bool apply_next( StochasticBlock & block , c_ModParam issuePMod = eNoBlck ,
+                  c_ModParam issueAMod = eNoBlck ) {
+  auto scenario = next();
+  if( ! scenario )
+   return false;
+  block.set_data( scenario->cbegin() , issuePMod , issueAMod );
+  return true;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// stops the background thread, discarding the scenarios not taken yet
+
+ void stop();
+
+/** @} ---------------------------------------------------------------------*/
+/*------------ METHODS FOR READING THE DATA OF THE ScenarioPrefetcher ------*/
+/*--------------------------------------------------------------------------*/
+/** @name Reading the data of the ScenarioPrefetcher
+ *  @{ */
+
+ /// returns the dimension of the scenarios
+
+ Index get_dimension() const { return dimension; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of buffers
+
+ Index depth() const { return buffers.size(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the index of the scenario last returned by next()
+ /** Returns the index (in the ScenarioSet, or whatever the loading function
+  * reads) of the scenario last returned by next(); this is meaningless if
+  * next() has not returned a scenario since the last call to start(). */
+
+ Index get_scenario_index() const { return current; }
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED METHODS -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the body of the background thread
+
+ void run();
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the dimension of the scenarios
+ Index dimension;
+
+ /// the function loading the scenarios
+ Loader loader;
+
+ /// the ring of buffers
+ std::vector< std::vector< double > > buffers;
+
+ /// the indices of the scenarios to be loaded
+ std::vector< Index > sequence;
+
+ /// the index of the scenario last returned by next()
+ Index current = 0;
+
+ /// the number of scenarios loaded so far (guarded by mutex)
+ std::size_t loaded = 0;
+
+ /// the number of scenarios taken by next() so far
+ std::size_t taken = 0;
+
+ /// the number of buffers given back to the background thread so far
+ std::size_t released = 0;
+
+ /// whether the background thread has to stop (guarded by mutex)
+ bool stopping = false;
+
+ /// the exception thrown when loading scenario loaded (guarded by mutex)
+ std::exception_ptr error;
+
+ /// the mutex guarding the state shared with the background thread
+ std::mutex mutex;
+
+ /// signalled when a scenario has been loaded
+ std::condition_variable loaded_cv;
+
+ /// signalled when a buffer has been given back, or when stopping
+ std::condition_variable released_cv;
+
+ /// the background thread
+ std::thread thread;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class ScenarioPrefetcher )
+
+/** @} end( group( ScenarioPrefetcher_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ScenarioPrefetcher.h included */
+
+/*--------------------------------------------------------------------------*/
+/*--------------------- End File ScenarioPrefetcher.h ----------------------*/
+/*--------------------------------------------------------------------------*/
@@ -0,0 +1,264 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioReduction.h -------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the ScenarioReduction class, which reduces a ScenarioSet
+ * to a smaller one (with suitably redistributed probabilities) that is as
+ * close as possible to the original one.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ScenarioReduction
+#define __ScenarioReduction
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioSet.h"
+
+#include <cstdint>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup ScenarioReduction_CLASSES Classes in ScenarioReduction.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- CLASS ScenarioReduction --------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// reduces a ScenarioSet to a smaller one
+/** The ScenarioReduction class implements the classical heuristics for
+ * scenario reduction of Dupačová, Gröwe-Kuska, Heitsch and Römisch: given a
+ * ScenarioSet with n scenarios, a subset of m < n of its scenarios is
+ * selected, and the probability of each discarded scenario is given to the
+ * closest selected one (in the Euclidean norm), so as to (approximately)
+ * minimize the Kantorovich distance between the two distributions. Two
+ * heuristics are available:
+ *
+ * - fast forward selection, which starts from the empty set and adds one
+ *   scenario at a time, the one that most decreases the distance;
+ *
+ * - backward reduction, which starts from the full set and removes one
+ *   scenario at a time, the one with the smallest probability times
+ *   distance from the closest remaining scenario.
+ *
+ * No n x n distance matrix is ever formed: the distances are computed
+ * blockwise out of the Eigen matrix of the scenarios as ||x||^2 + ||y||^2 -
+ * 2 x'y, so that the bulk of the work is done by (cache-efficient) matrix
+ * products and only O( n ) memory is needed besides the scenarios.
+ *
+ * At each of its m iterations, forward selection computes the distance of
+ * each of the n scenarios from each candidate. By default, the candidates
+ * are a random sample of (at most) default_max_candidates of the remaining
+ * scenarios (see set_max_candidates()), so that each iteration takes
+ * O( n * max_candidates ) distance evaluations and the whole heuristic is
+ * linear in n; the candidates are used in place in the Eigen matrix, with
+ * no copy. If all the remaining scenarios are taken as candidates (the
+ * exact heuristic), each iteration takes O( n^2 ) distance evaluations
+ * instead, which is only viable for moderate n. Backward reduction needs
+ * the nearest neighbour of each scenario, whose initial computation takes
+ * O( n^2 ) distance evaluations; afterwards, each removal only costs O( n )
+ * for each scenario whose nearest neighbour was the removed one. Hence,
+ * backward reduction is best suited when m is close to n and n is
+ * moderate, and forward selection when m is much smaller than n. */
+
+class ScenarioReduction
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+
+ /// the available reduction heuristics
+ enum Method {
+  eForwardSelection ,  ///< fast forward selection
+  eBackwardReduction   ///< backward reduction
+ };
+
+ /// the default maximum number of candidates of each forward iteration
+ static constexpr Index default_max_candidates = 256;
+
+/*--------------------------------------------------------------------------*/
+/*------------- CONSTRUCTING AND DESTRUCTING ScenarioReduction -------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing ScenarioReduction
+ *  @{ */
+
+ /// constructor
+ /** Constructs a ScenarioReduction using the given heuristic.
+  *
+  * @param method The heuristic to be used. */
+
+ explicit ScenarioReduction( Method method = eForwardSelection )
+  : method( method ) {}
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of ScenarioReduction
+
+ virtual ~ScenarioReduction() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*----------------------- METHODS FOR SETTING PARAMETERS -------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for setting the parameters
+ *  @{ */
+
+ /// sets the heuristic to be used
+
+ void set_method( Method method ) { this->method = method; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the maximum number of candidates of each forward iteration
+ /** Sets the maximum number of candidate scenarios that are considered at
+  * each iteration of forward selection (default_max_candidates by
+  * default). If there are more remaining scenarios than this number, a
+  * random sample of them (see set_seed()) is considered. If it is zero,
+  * all the remaining scenarios are always considered, which makes forward
+  * selection quadratic in the number of scenarios. This parameter is
+  * ignored by backward reduction. */
+
+ void set_max_candidates( Index max_candidates ) {
+  this->max_candidates = max_candidates;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the seed used for sampling the candidates of forward selection
+
+ void set_seed( std::uint64_t seed ) { this->seed = seed; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the number of scenarios in each block of the distance computation
+ /** Sets the number of scenarios in each block of the distance computation,
+  * which determines the size of the temporary matrices (the larger the
+  * block, the better the efficiency of the matrix products, but the larger
+  * the memory used). */
+
+ void set_block_size( Index block_size ) {
+  this->block_size = std::max( block_size , Index( 1 ) );
+ }
+
+/** @} ---------------------------------------------------------------------*/
+/*---------------------- METHODS FOR REDUCING SCENARIOS --------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for reducing scenarios
+ *  @{ */
+
+ /// reduces the given ScenarioSet to the given number of scenarios
+ /** This method returns a ScenarioSet with (at most) \p number scenarios,
+  * selected among those of \p scenarios by the chosen heuristic. The
+  * selected scenarios appear in the same order as in \p scenarios, and
+  * their probability is their original probability plus that of all the
+  * discarded scenarios that are closer to them than to any other selected
+  * scenario. If \p number is not smaller than scenarios.size(), a copy of
+  * \p scenarios (with explicit probabilities) is returned.
+  *
+  * @param scenarios The ScenarioSet to be reduced.
+  *
+  * @param number The number of scenarios to be kept.
+  *
+  * @param assignment If not nullptr, on return it contains, for each
+  *        scenario of \p scenarios, the index (in the returned ScenarioSet)
+  *        of the scenario which it has been assigned to.
+  *
+  * @return The reduced ScenarioSet. */
+
+ ScenarioSet reduce( const ScenarioSet & scenarios , Index number ,
+                     std::vector< Index > * assignment = nullptr ) const;
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED METHODS -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// selects the scenarios by fast forward selection
+ /** Selects \p number scenarios by fast forward selection, marking them in
+  * \p selected, and sets \p owner[ k ] to the selected scenario closest to
+  * scenario k. */
+
+ void forward_selection( const ScenarioSet & scenarios , Index number ,
+                         std::vector< bool > & selected ,
+                         std::vector< Index > & owner ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// selects the scenarios by backward reduction
+ /** Keeps \p number scenarios by backward reduction, marking them in \p
+  * selected, and sets \p owner[ k ] to the kept scenario closest to
+  * scenario k. The cost of removing a scenario is its own probability
+  * times its distance from the closest remaining scenario: the probability
+  * of the removed scenarios is not moved around while removing, but only
+  * given to the closest kept scenario at the end. */
+
+ void backward_reduction( const ScenarioSet & scenarios , Index number ,
+                          std::vector< bool > & selected ,
+                          std::vector< Index > & owner ) const;
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the heuristic to be used
+ Method method;
+
+ /// the maximum number of candidates of each forward iteration (0 = all)
+ Index max_candidates = default_max_candidates;
+
+ /// the seed used for sampling the candidates of forward selection
+ std::uint64_t seed = 0;
+
+ /// the number of scenarios in each block of the distance computation
+ Index block_size = 1024;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class ScenarioReduction )
+
+/** @} end( group( ScenarioReduction_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ScenarioReduction.h included */
+
+/*--------------------------------------------------------------------------*/
+/*--------------------- End File ScenarioReduction.h -----------------------*/
+/*--------------------------------------------------------------------------*/
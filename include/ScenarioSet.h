@@ -0,0 +1,397 @@
+/*--------------------------------------------------------------------------*/
+/*------------------------- File ScenarioSet.h -----------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the ScenarioSet class, which represents a (finite) set of
+ * scenarios for the data of a StochasticBlock, each one possibly having an
+ * associated probability.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ScenarioSet
+#define __ScenarioSet
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "Block.h"
+
+#include <Eigen/Dense>
+
+#include <algorithm>
+#include <iterator>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup ScenarioSet_CLASSES Classes in ScenarioSet.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- CLASS ScenarioSet -----------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// a dense set of scenarios for the data of a StochasticBlock
+/** The ScenarioSet class represents a finite set of scenarios, all having
+ * the same dimension, each one with an associated probability (or weight).
+ * A scenario is a vector of double, as expected by
+ * StochasticBlock::set_data().
+ *
+ * The scenarios are stored contiguously, one after the other, in a single
+ * buffer. This buffer can be seen as a (column-major) Eigen matrix having
+ * one row for each entry of a scenario and one column for each scenario
+ * (see get_matrix()), so that any computation over the scenarios can be
+ * performed with Eigen without copying them. At the same time, each
+ * scenario can be directly passed to StochasticBlock::set_data() by means
+ * of the iterator returned by get_scenario(), without any allocation.
+ *
+ * The probabilities are optional: if they are not provided, all scenarios
+ * are considered to be equally likely. The probabilities are not required
+ * to sum to 1 (so they can also be regarded as weights), but see
+ * normalize_probabilities(). */
+
+class ScenarioSet
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+
+ /// a (column-major) matrix whose columns are the scenarios
+ using Matrix = Eigen::Map< Eigen::MatrixXd >;
+
+ /// a read-only (column-major) matrix whose columns are the scenarios
+ using c_Matrix = Eigen::Map< const Eigen::MatrixXd >;
+
+/*--------------------------------------------------------------------------*/
+/*--------------- CONSTRUCTING AND DESTRUCTING ScenarioSet -----------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing ScenarioSet
+ *  @{ */
+
+ /// constructor
+ /** Constructs a ScenarioSet with the given number of scenarios, each one
+  * having the given dimension. The values of the scenarios are all
+  * initialized to zero and no probability is given.
+  *
+  * @param dimension The dimension of each scenario.
+  *
+  * @param number The number of scenarios. */
+
+ ScenarioSet( Index dimension = 0 , Index number = 0 )
+  : dimension( dimension ) , number( number ) ,
+    data( std::size_t( dimension ) * number ) {}
+
+/*--------------------------------------------------------------------------*/
+ /// de-serialize a ScenarioSet out of netCDF::NcGroup
+ /** The method takes a netCDF::NcGroup supposedly containing all the
+  * information required to de-serialize the ScenarioSet, in the format
+  * explained in the comments of the serialize() function.
+  *
+  * @param group a netCDF::NcGroup holding the data in the format described
+  *        in the comments to serialize(). */
+
+ void deserialize( const netCDF::NcGroup & group );
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of ScenarioSet
+
+ virtual ~ScenarioSet() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*---------------- METHODS FOR MODIFYING THE ScenarioSet -------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for modifying the ScenarioSet
+ *  @{ */
+
+ /// changes the number of scenarios and their dimension
+ /** This method changes the number of scenarios and their dimension. If
+  * the dimension is not changed, the first scenarios (and their
+  * probabilities) are preserved; otherwise, all values are set to zero.
+  *
+  * @param dimension The dimension of each scenario.
+  *
+  * @param number The number of scenarios. */
+
+ void resize( Index dimension , Index number );
+
+/*--------------------------------------------------------------------------*/
+
+ /// reserves memory for the given number of scenarios
+
+ void reserve( Index number ) {
+  data.reserve( std::size_t( dimension ) * number );
+  if( ! probabilities.empty() )
+   probabilities.reserve( number );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// adds a new scenario to the set
+ /** This method adds a new scenario at the end of the set.
+  *
+  * @param scenario An iterator to the first element of the scenario, which
+  *        must have (at least) get_dimension() elements.
+  *
+  * @param probability The probability of the scenario. If no probability
+  *        has been given so far and \p probability is negative (which is
+  *        the default), then no probability is associated with the new
+  *        scenario either. If no probability has been given so far and \p
+  *        probability is not negative, the scenarios already in the set are
+  *        given probability 1 / size() each. Finally, if some probability
+  *        has been given and \p probability is negative, the probability of
+  *        the new scenario is set to zero.
+  *
+  * The scenario can be one of this set (say, get_scenario( 0 )). */
+
+ template< class Iterator >
+ void add_scenario( Iterator scenario , double probability = -1 ) {
+  if( data.size() + dimension > data.capacity() ) {
+   // the scenario may be in data: read it before data is reallocated
+   std::vector< double > grown;
+   grown.reserve( std::max( 2 * data.capacity() , data.size() + dimension ) );
+   grown.assign( data.begin() , data.end() );
+   grown.insert( grown.end() , scenario , std::next( scenario , dimension ) );
+   data.swap( grown );
+   }
+  else  // no reallocation: the scenario remains valid while appended
+   std::copy_n( scenario , dimension , std::back_inserter( data ) );
+  if( ( probability >= 0 ) && probabilities.empty() ) {
+   probabilities.assign( number , 1.0 / std::max( number , Index( 1 ) ) );
+   probabilities.push_back( probability );
+   }
+  else if( ! probabilities.empty() )
+   probabilities.push_back( std::max( probability , 0.0 ) );
+  ++number;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the values of the i-th scenario
+ /** This method sets the values of the i-th scenario.
+  *
+  * @param i The index of the scenario, which must be smaller than size().
+  *
+  * @param scenario An iterator to the first element of the new values of
+  *        the scenario, which must have (at least) get_dimension()
+  *        elements. */
+
+ template< class Iterator >
+ void set_scenario( Index i , Iterator scenario ) {
+  assert( i < number );
+  std::copy_n( scenario , dimension , get_scenario( i ) );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the probabilities of the scenarios
+ /** This method sets the probabilities of the scenarios. If the given
+  * vector is empty, then all scenarios are considered to be equally
+  * likely; otherwise, it must have size() elements.
+  *
+  * @param probabilities The vector with the probabilities of the
+  *        scenarios. */
+
+ void set_probabilities( std::vector< double > && probabilities ) {
+  if( ( ! probabilities.empty() ) && ( probabilities.size() != number ) )
+   throw( std::invalid_argument( "ScenarioSet::set_probabilities: wrong "
+                                 "number of probabilities" ) );
+  this->probabilities = std::move( probabilities );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// scales the probabilities so that they sum to 1
+
+ void normalize_probabilities();
+
+/*--------------------------------------------------------------------------*/
+
+ /// removes all the scenarios
+
+ void clear() {
+  data.clear();
+  probabilities.clear();
+  number = 0;
+ }
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------- METHODS FOR READING THE DATA OF THE ScenarioSet ----------*/
+/*--------------------------------------------------------------------------*/
+/** @name Reading the data of the ScenarioSet
+ *  @{ */
+
+ /// returns the dimension of the scenarios
+
+ Index get_dimension() const { return dimension; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of scenarios
+
+ Index size() const { return number; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns true if there is no scenario
+
+ bool empty() const { return number == 0; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns an iterator to the first element of the i-th scenario
+
+ std::vector< double >::const_iterator get_scenario( Index i ) const {
+  assert( i < number );
+  return data.cbegin() + std::size_t( i ) * dimension;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns an iterator to the first element of the i-th scenario
+
+ std::vector< double >::iterator get_scenario( Index i ) {
+  assert( i < number );
+  return data.begin() + std::size_t( i ) * dimension;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the probability of the i-th scenario
+
+ double get_probability( Index i ) const {
+  assert( i < number );
+  return probabilities.empty() ? 1.0 / number : probabilities[ i ];
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the vector of probabilities (empty if equally likely)
+
+ const std::vector< double > & get_probabilities() const {
+  return probabilities;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the matrix whose columns are the scenarios
+ /** This method returns an Eigen::Map to the buffer storing the scenarios,
+  * seen as a (column-major) matrix having get_dimension() rows and size()
+  * columns, the i-th column being the i-th scenario. No copy is made, so
+  * the returned matrix is valid only as long as the number and the
+  * dimension of the scenarios are not changed. */
+
+ c_Matrix get_matrix() const { return c_Matrix( data.data() , dimension ,
+                                                 number ); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the matrix whose columns are the scenarios
+ /** This method returns an Eigen::Map to the buffer storing the scenarios,
+  * seen as a (column-major) matrix having get_dimension() rows and size()
+  * columns, the i-th column being the i-th scenario. Changing the entries
+  * of the returned matrix changes the scenarios. */
+
+ Matrix get_matrix() { return Matrix( data.data() , dimension , number ); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the probabilities of the scenarios as an Eigen vector
+ /** This method returns the vector of the probabilities of all the
+  * scenarios (also when they are all equally likely). */
+
+ Eigen::VectorXd get_probability_vector() const;
+
+/** @} ---------------------------------------------------------------------*/
+/*------------ METHODS FOR Saving THE DATA OF THE ScenarioSet --------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Saving the data of the ScenarioSet
+ *  @{ */
+
+ /// serialize a ScenarioSet into a netCDF::NcGroup
+ /** Serialize a ScenarioSet into a netCDF::NcGroup, with the following
+  * format:
+  *
+  * - The dimension "NumberScenarios", containing the number of scenarios.
+  *
+  * - The dimension "ScenarioDimension", containing the dimension of each
+  *   scenario.
+  *
+  * - The variable "Scenarios", of type double and indexed over both the
+  *   dimensions NumberScenarios and ScenarioDimension (in this order), so
+  *   that Scenarios[ i ][ j ] is the j-th element of the i-th scenario.
+  *   This variable is absent if either dimension is zero.
+  *
+  * - The variable "Probabilities", of type double and indexed over the
+  *   dimension NumberScenarios, containing the probability of each
+  *   scenario. This variable is optional: if it is not provided, all
+  *   scenarios are equally likely. */
+
+ void serialize( netCDF::NcGroup & group ) const;
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the dimension of each scenario
+ Index dimension;
+
+ /// the number of scenarios
+ Index number;
+
+ /// the scenarios, stored one after the other
+ std::vector< double > data;
+
+ /// the probabilities of the scenarios (empty if equally likely)
+ std::vector< double > probabilities;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class ScenarioSet )
+
+/** @} end( group( ScenarioSet_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ScenarioSet.h included */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------ End File ScenarioSet.h --------------------------*/
+/*--------------------------------------------------------------------------*/
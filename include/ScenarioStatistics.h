@@ -0,0 +1,328 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioStatistics.h ------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the ScenarioStatistics class, which computes the
+ * (weighted) mean, variance and quantiles of each entry of a stream of
+ * scenarios in a single pass and in bounded memory.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ScenarioStatistics
+#define __ScenarioStatistics
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "MappedScenarioSet.h"
+
+#include <Eigen/Dense>
+
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup ScenarioStatistics_CLASSES Classes in ScenarioStatistics.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------ CLASS ScenarioStatistics ------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// the weighted mean, variance and quantiles of a stream of scenarios
+/** The ScenarioStatistics class computes, entry by entry, the weighted
+ * mean, variance and quantiles of the scenarios given to add(), each one
+ * with a nonnegative weight (say, its probability). The scenarios are only
+ * read once and are not kept, so that the scenarios of a MappedScenarioSet
+ * larger than the memory can be summarized in a single pass over the file;
+ * the resulting scenarios (see get_mean() and get_quantile()) can then be
+ * given to StochasticBlock::set_data(), e.g., to solve the expected-value
+ * problem (see also StochasticBlock::set_expected_data()).
+ *
+ * The mean and the variance are exact. The scenarios are processed in
+ * chunks of a few columns: the mean and the sum of squared deviations of a
+ * chunk are computed with Eigen (vectorized) reductions, and merged into
+ * those of the previous chunks with the pairwise update of Chan, Golub and
+ * LeVeque, which is numerically stable.
+ *
+ * The quantiles need, for each entry, a weighted histogram of get_bins()
+ * cells. As long as no more than get_bins() scenarios have been added,
+ * their values are kept, and the quantiles are exact (see
+ * is_quantile_exact()). Afterwards, each histogram covers the range of the
+ * values of its entry with get_bins() cells of equal width, and it is
+ * extended, when a value falls outside of it, by doubling the width of the
+ * cells (merging them in pairs); the quantiles are interpolated within the
+ * cells, so that their error is below the width of a cell. The memory
+ * taken is therefore about get_dimension() * get_bins() double; the
+ * quantiles can be disabled altogether with get_bins() == 0. */
+
+class ScenarioStatistics
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+
+/*--------------------------------------------------------------------------*/
+/*------------- CONSTRUCTING AND DESTRUCTING ScenarioStatistics ------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing ScenarioStatistics
+ *  @{ */
+
+ /// constructor
+ /** Constructs a ScenarioStatistics for the scenarios of the given
+  * dimension, to which no scenario has been added yet.
+  *
+  * @param dimension The dimension of the scenarios.
+  *
+  * @param bins The number of cells of the histogram of each entry, which
+  *        is rounded up to an even number; if it is zero, the quantiles are
+  *        not computed. */
+
+ explicit ScenarioStatistics( Index dimension , Index bins = 32 );
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of ScenarioStatistics
+
+ virtual ~ScenarioStatistics() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*------------------------- METHODS FOR ADDING SCENARIOS -------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for adding scenarios
+ *  @{ */
+
+ /// adds the given scenarios, stored contiguously (column-major)
+ /** Adds the \p number scenarios stored one after the other (each one
+  * having get_dimension() double) starting at \p scenarios, the i-th one
+  * having weight \p weights[ i ]. Scenarios with weight zero are ignored;
+  * std::invalid_argument is thrown if some weight is negative.
+  *
+  * @param scenarios The first element of the first scenario.
+  *
+  * @param number The number of scenarios.
+  *
+  * @param weights The weights of the scenarios. */
+
+ void add( const double * scenarios , Index number , const double * weights );
+
+/*--------------------------------------------------------------------------*/
+
+ /// adds the given scenario, with the given weight
+
+ void add( const double * scenario , double weight = 1 ) {
+  add( scenario , 1 , & weight );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// adds all the scenarios of a ScenarioSet, weighted by their probability
+
+ void add( const ScenarioSet & scenarios );
+
+/*--------------------------------------------------------------------------*/
+
+ /// adds all the scenarios of a CompactScenarioSet, weighted by their
+ /// probability (decoding a few scenarios at a time)
+
+ void add( const CompactScenarioSet & scenarios );
+
+/*--------------------------------------------------------------------------*/
+
+ /// adds all the scenarios of a MappedScenarioSet, weighted by their
+ /// probability (reading the file once, a few scenarios at a time)
+
+ void add( const MappedScenarioSet & scenarios );
+
+/*--------------------------------------------------------------------------*/
+
+ /// removes all the scenarios
+
+ void clear();
+
+/** @} ---------------------------------------------------------------------*/
+/*---------------------- METHODS FOR READING THE STATISTICS ----------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Reading the statistics
+ *  @{ */
+
+ /// returns the dimension of the scenarios
+
+ Index get_dimension() const { return dimension; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of cells of the histogram of each entry
+
+ Index get_bins() const { return bins; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of scenarios added (with positive weight)
+
+ Index size() const { return number; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the total weight of the scenarios added
+
+ double get_total_weight() const { return total_weight; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether the quantiles are exact (see the general notes)
+
+ bool is_quantile_exact() const { return number <= bins; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the weighted mean scenario
+ /** Returns the mean of the scenarios added, weighted by their weights
+  * (normalized to sum to 1), i.e., the expected scenario if the weights
+  * are the probabilities. Throws std::logic_error if no scenario has been
+  * added. */
+
+ std::vector< double > get_mean() const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the weighted variance of each entry
+ /** Returns the variance of each entry of the scenarios added, weighted by
+  * their weights (normalized to sum to 1). Throws std::logic_error if no
+  * scenario has been added. */
+
+ std::vector< double > get_variance() const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the scenario made of the given quantile of each entry
+ /** Returns the scenario whose each entry is the \p p quantile of the
+  * values of that entry in the scenarios added, weighted by their weights:
+  * the smallest value whose cumulative weight is at least \p p times the
+  * total weight, if is_quantile_exact(), or otherwise its interpolation
+  * within the histogram of the entry. The 0 and 1 quantiles are always the
+  * exact minimum and maximum. Throws std::logic_error if no scenario has
+  * been added or if get_bins() == 0.
+  *
+  * @param p The probability level, in [ 0 , 1 ]. */
+
+ std::vector< double > get_quantile( double p ) const;
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED METHODS -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// adds a scenario with positive weight to the histograms
+
+ void add_to_histograms( const double * scenario , double weight );
+
+/*--------------------------------------------------------------------------*/
+
+ /// turns the values kept so far into the histograms
+
+ void build_histograms();
+
+/*--------------------------------------------------------------------------*/
+
+ /// adds all the scenarios of a set, a chunk of them at a time
+ /** Adds the \p number scenarios of a set, decoding a few of them at a time
+  * by calling \p decode( i , scenario ), weighted by \p probability( i ). */
+
+ template< class Decode , class Probability >
+ void add_chunks( Index number , Decode && decode ,
+                  Probability && probability );
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of scenarios processed as one chunk
+
+ Index chunk_size() const;
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the dimension of the scenarios
+ Index dimension;
+
+ /// the number of cells of the histogram of each entry
+ Index bins;
+
+ /// the number of scenarios added
+ Index number = 0;
+
+ /// the total weight of the scenarios added
+ double total_weight = 0;
+
+ /// the weighted mean of each entry
+ Eigen::VectorXd mean;
+
+ /// the weighted sum of the squared deviations of each entry
+ Eigen::VectorXd deviations;
+
+ /// for each entry, its bins values (while is_quantile_exact()) or the
+ /// weights of the cells of its histogram
+ std::vector< double > cells;
+
+ /// the weights of the scenarios kept (while is_quantile_exact())
+ std::vector< double > kept_weights;
+
+ /// the lower end of the histogram of each entry
+ Eigen::VectorXd lower;
+
+ /// the width of the cells of the histogram of each entry
+ Eigen::VectorXd width;
+
+ /// the minimum and maximum value of each entry
+ Eigen::VectorXd minimum , maximum;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class ScenarioStatistics )
+
+/** @} end( group( ScenarioStatistics_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ScenarioStatistics.h included */
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- End File ScenarioStatistics.h ---------------------*/
+/*--------------------------------------------------------------------------*/
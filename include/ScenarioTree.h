@@ -0,0 +1,330 @@
+/*--------------------------------------------------------------------------*/
+/*-------------------------- File ScenarioTree.h ---------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the ScenarioTree class, which represents a multi-stage
+ * scenario tree whose nodes only store the entries of the scenario that
+ * differ from their parent node.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ScenarioTree
+#define __ScenarioTree
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "StochasticBlock.h"
+
+#include <functional>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup ScenarioTree_CLASSES Classes in ScenarioTree.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- CLASS ScenarioTree ----------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// a multi-stage scenario tree for the data of a StochasticBlock
+/** The ScenarioTree class represents a multi-stage scenario tree. Each node
+ * of the tree corresponds to a (full) scenario, as expected by
+ * StochasticBlock::set_data(), but it only stores the entries of the
+ * scenario that differ from the scenario of its parent node (typically,
+ * the values revealed at its stage); the root node (node 0, at stage 0)
+ * stores the whole scenario. Each node also has a probability conditional
+ * to its parent node, so that the probability of a node is the product of
+ * the conditional probabilities along the path from the root. Each leaf
+ * corresponds to one of the scenarios of the equivalent "flat" ScenarioSet
+ * (see get_scenario_set()), which has to store all the entries of each
+ * leaf, whereas the tree stores the values shared by several leaves only
+ * once.
+ *
+ * The tree can be traversed in depth-first order on a StochasticBlock (see
+ * traverse()): when moving from a node to the next one, only the entries
+ * that change are written into the inner Block (see
+ * StochasticBlock::write_data_entries()), so that the entries fixed at the
+ * first stages are written only once for all the leaves below them. */
+
+class ScenarioTree
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+ using Subset = Block::Subset;
+
+ /// function visiting a node, whose scenario has been set on the
+ /// StochasticBlock
+ using Visit = std::function< void( StochasticBlock & , Index ) >;
+
+/*--------------------------------------------------------------------------*/
+/*--------------- CONSTRUCTING AND DESTRUCTING ScenarioTree ----------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing ScenarioTree
+ *  @{ */
+
+ /// constructor taking the scenario of the root node
+ /** Constructs a ScenarioTree having only the root node, whose scenario is
+  * the given one; its size is the dimension of all the scenarios of the
+  * tree. */
+
+ explicit ScenarioTree( std::vector< double > && root = {} );
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of ScenarioTree
+
+ virtual ~ScenarioTree() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*---------------- METHODS FOR MODIFYING THE ScenarioTree ------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for modifying the ScenarioTree
+ *  @{ */
+
+ /// adds a new node to the tree
+ /** Adds a new child of the given node, whose scenario is the one of \p
+  * parent except for the given entries. Throws std::invalid_argument if \p
+  * parent is not a node of the tree, if \p positions and \p values have
+  * different sizes or if some position is not smaller than
+  * get_dimension().
+  *
+  * @param parent The parent of the new node.
+  *
+  * @param positions The positions of the entries of the scenario that
+  *        differ from the ones of \p parent (without duplicates).
+  *
+  * @param values The values of those entries, in the same order.
+  *
+  * @param probability The probability of the new node conditional to \p
+  *        parent.
+  *
+  * @return The index of the new node. */
+
+ Index add_node( Index parent , Subset && positions ,
+                 std::vector< double > && values , double probability = 1 );
+
+/** @} ---------------------------------------------------------------------*/
+/*------------- METHODS FOR READING THE DATA OF THE ScenarioTree -----------*/
+/*--------------------------------------------------------------------------*/
+/** @name Reading the data of the ScenarioTree
+ *  @{ */
+
+ /// returns the dimension of the scenarios
+
+ Index get_dimension() const { return root.size(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of nodes of the tree
+
+ Index size() const { return nodes.size(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the scenario of the root node
+
+ const std::vector< double > & get_root_scenario() const { return root; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the parent of the given node (the root is its own parent)
+
+ Index get_parent( Index node ) const { return nodes[ node ].parent; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the stage of the given node (0 for the root)
+
+ Index get_stage( Index node ) const { return nodes[ node ].stage; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the children of the given node, in the order they were added
+
+ const Subset & get_children( Index node ) const {
+  return nodes[ node ].children;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether the given node is a leaf
+
+ bool is_leaf( Index node ) const { return nodes[ node ].children.empty(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the leaves, in depth-first order
+
+ Subset get_leaves() const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the positions of the entries stored by the given node
+
+ const Subset & get_positions( Index node ) const {
+  return nodes[ node ].positions;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the values of the entries stored by the given node
+
+ const std::vector< double > & get_values( Index node ) const {
+  return nodes[ node ].values;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the probability of the node conditional to its parent
+
+ double get_conditional_probability( Index node ) const {
+  return nodes[ node ].probability;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the probability of the node (product along its path)
+
+ double get_probability( Index node ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// writes the (full) scenario of the given node into the given array
+ /** Writes the scenario of the given node, i.e., the one of the root
+  * changed by the entries of the nodes along the path to the given node,
+  * into the given array of get_dimension() double. */
+
+ void get_scenario( Index node , double * scenario ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of values stored by all the nodes
+ /** Returns the number of values stored by all the nodes, the root
+  * included, to be compared with get_dimension() times the number of
+  * leaves stored by the equivalent ScenarioSet. */
+
+ std::size_t get_number_values() const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the scenarios of the leaves as a ScenarioSet
+ /** Returns a ScenarioSet having one scenario for each leaf, in depth-first
+  * order (see get_leaves()), with the probability of the leaf. */
+
+ ScenarioSet get_scenario_set() const;
+
+/** @} ---------------------------------------------------------------------*/
+/*------------------- METHODS FOR TRAVERSING THE ScenarioTree --------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Traversing the ScenarioTree
+ *  @{ */
+
+ /// traverses the tree in depth-first order on the given StochasticBlock
+ /** Visits the nodes of the tree in depth-first order, starting from the
+  * root (i.e., each node before its children, and the children in the
+  * order they were added): before \p visit( block , node ) is called, the
+  * data of \p block is set to the scenario of the node. The whole scenario
+  * is written for the root (with StochasticBlock::set_data()); then, only
+  * the entries stored by the nodes entered and left since the previous
+  * visit are written (with StochasticBlock::write_data_entries()), so that
+  * the values shared by the nodes of a subtree are only written once.
+  *
+  * \p visit is free to solve (or anything else) the inner Block of \p
+  * block, but it must not change the data handled by the data mappings.
+  * After the traversal, \p block holds the scenario of the last visited
+  * node.
+  *
+  * @param block The StochasticBlock, whose data mappings must use no more
+  *        than get_dimension() entries of the scenario.
+  *
+  * @param visit The function visiting a node.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+
+ void traverse( StochasticBlock & block , const Visit & visit ,
+                c_ModParam issuePMod = eNoBlck ,
+                c_ModParam issueAMod = eNoBlck ) const;
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED TYPES -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// a node of the tree
+
+ struct Node {
+  Index parent = 0;              ///< the parent node
+  Index stage = 0;               ///< the stage (depth) of the node
+  double probability = 1;        ///< the probability given the parent
+  Subset positions;              ///< the positions of the stored entries
+  std::vector< double > values;  ///< the values of the stored entries
+  Subset children;               ///< the children of the node
+ };
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the scenario of the root node
+ std::vector< double > root;
+
+ /// the nodes of the tree (the root being the first one)
+ std::vector< Node > nodes;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class ScenarioTree )
+
+/** @} end( group( ScenarioTree_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ScenarioTree.h included */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------ End File ScenarioTree.h -------------------------*/
+/*--------------------------------------------------------------------------*/
@@ -25,10 +25,26 @@
 /*--------------------------------------------------------------------------*/
 
 #include "Block.h"
+#include "CompactScenarioSet.h"
+#include "CompressedSubset.h"
 #include "DataMapping.h"
+#include "ScenarioGenerator.h"
+#include "ScenarioSet.h"
+#include "ScenarioStatistics.h"
+#include "WarmStartCache.h"
 
 #include <Eigen/Dense>
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <typeindex>
+
 /*--------------------------------------------------------------------------*/
 /*----------------------------- NAMESPACE ----------------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -117,12 +133,43 @@ namespace SMSpp_di_unipi_it
  *    any sense. What this class provides is a means to set the value of the
  *    data of its inner Block.
  *
+ * 5) It can optionally work in "delta mode" (see set_delta_mode()). In this
+ *    mode the StochasticBlock remembers the last scenario that has been
+ *    applied to the inner Block and, when set_data() is called again, only
+ *    the entries of the new scenario that differ from the last one are
+ *    actually written into the inner Block. For each DataMapping, the
+ *    registered method of the Block is only called (with the Subset or the
+ *    sub-Ranges of the changed entries) if at least one of its values has
+ *    changed. This is useful when consecutive scenarios share most of their
+ *    values, since it reduces both the calls to the Block methods and the
+ *    Modification that are issued.
+ *
+ * 6) It can optionally hold a ScenarioSet (see set_scenario_set()), i.e., a
+ *    finite set of scenarios (possibly with probabilities), in which case
+ *    any of these scenarios can be applied to the inner Block by simply
+ *    giving its index to set_data().
+ *
+ * 7) It can optionally work in "deferred mode" (see set_deferred_mode()), in
+ *    which set_data() only records the scenario and marks its changed
+ *    entries, and the inner Block is only updated when flush_data() is
+ *    called. This is useful when the scenario is set (or partly changed,
+ *    see set_data_entries()) several times before the inner Block is used.
+ *
+ * 8) It can optionally hold a WarmStartCache (see set_warm_start_cache()),
+ *    which keeps the Solution of the inner Block for recently solved
+ *    scenarios (see store_solution()), so that the Solution of the same or
+ *    of the closest scenario can be written into the inner Block before a
+ *    new scenario is solved (see warm_start()).
+ *
  * A StochasticBlock should have a probability distribution (or some kind of
- * partial stochastic process) that describes the uncertainty in it. However,
- * for the moment, it is not supported by this class and this feature will be
- * implemented later on. Typically, an object of this class would be used in
- * conjunction with a scenario generator and the set_data() method of this
- * object would be called to consider a particular scenario.
+ * partial stochastic process) that describes the uncertainty in it. This is
+ * supported in the form of a ScenarioGenerator, which can be attached to the
+ * StochasticBlock (see set_scenario_generator()) and which is used by
+ * set_random_data() to generate a random scenario and apply it to the inner
+ * Block. More in general, an object of this class would be used in
+ * conjunction with a scenario generator (not necessarily the attached one)
+ * and the set_data() method of this object would be called to consider a
+ * particular scenario.
  */
 
 class StochasticBlock : public Block
@@ -133,6 +180,80 @@ class StochasticBlock : public Block
 
 public:
 
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// function writing some values into the Block of a DataMapping
+ /** A function of this type writes into the Block of a DataMapping the
+  * given values (the first parameter) at the given positions (the second
+  * parameter) of the data handled by the DataMapping. The positions are a
+  * subset of the "to" set of the DataMapping, in the same order. */
+
+ using Scatter = std::function< void( std::vector< double >::const_iterator ,
+                                      Subset && , c_ModParam , c_ModParam ) >;
+
+ /// a step of a compiled plan for setting the data of the inner Block
+ /** A function of this type reads some entries of the given scenario and
+  * writes them into the inner Block (see compile_data_mappings()). */
+
+ using ScatterStep = std::function< void(
+  std::vector< double >::const_iterator , c_ModParam , c_ModParam ) >;
+
+ /// function building a ScatterStep for the given "from" and "to" sets
+ using StepBuilder = std::function< ScatterStep( Subset && , Subset && ) >;
+
+ /// function reading some values from the Block of a DataMapping
+ /** A function of this type reads from the given Block the values at the
+  * given positions of the data handled by a DataMapping (that is, a subset
+  * of its "to" set), writing them, converted to double and in the same
+  * order, starting from the given iterator (see register_getter()). */
+
+ using Getter = std::function< void( Block * , const Subset & ,
+                                     std::vector< double >::iterator ) >;
+
+ /// the values of the data of the inner Block handled by the data mappings
+ /** A Snapshot holds the values of the data of the inner Block at all the
+  * positions handled by the data mappings (see take_snapshot()), one data
+  * mapping after the other, in the order of their "to" sets. */
+
+ struct Snapshot {
+  std::vector< double > values;  ///< the values of all the data mappings
+  std::vector< Index > sizes;    ///< the number of values of each one
+  std::size_t id = 0;            ///< identifies it (0 if not taken)
+ };
+
+ /// the counters collected on the hot paths (see enable_statistics())
+ /** A Statistics holds the counters that a StochasticBlock collects, when
+  * asked to (see enable_statistics()), about the work done by set_data()
+  * and add_Modification(). The counters of the data mappings are indexed
+  * as the vector returned by get_data_mappings(). The data mappings whose
+  * layout is not known (that are not one of the SimpleDataMapping with
+  * Subset or Range sets) are timed, but the number of elements they write
+  * is not counted. When the compiled plan is used (see
+  * compile_data_mappings()) the time of a step is split among the data
+  * mappings merged into it in proportion to the number of their elements.
+  */
+
+ struct Statistics {
+  using Clock = std::chrono::steady_clock;
+
+  std::size_t set_data_calls = 0;      ///< number of calls to set_data()
+  std::vector< std::size_t > elements; ///< elements written by each mapping
+  std::vector< double > time;          ///< seconds spent by each mapping
+  std::size_t modifications = 0;       ///< number of Modification received
+
+  /// number of Modification received, by (dynamic) type
+  std::map< std::type_index , std::size_t > modification_types;
+
+  /// records that data mapping i has written n elements since start
+  void add( Index i , std::size_t n , Clock::time_point start ) {
+   elements[ i ] += n;
+   time[ i ] += std::chrono::duration< double >( Clock::now() - start )
+    .count();
+  }
+ };
+
 /*--------------------------------------------------------------------------*/
 /*------------- CONSTRUCTING AND DESTRUCTING StochasticBlock ---------------*/
 /*--------------------------------------------------------------------------*/
@@ -166,12 +287,169 @@ public:
   * information required to de-serialize the StochasticBlock, in the format
   * explained in the comments of the serialize() function.
   *
+  * If the lazy deserialization is enabled (see set_lazy_deserialization()),
+  * the inner Block and the data mappings are not built here: the
+  * netCDF::NcGroup is kept, and they are only built when first needed (see
+  * complete_deserialization()). In this case, the StochasticBlock keeps a
+  * handle to the netCDF::NcGroup, hence the netCDF file must remain open
+  * until the deserialization is completed (or the StochasticBlock is
+  * destroyed, or deserialized again). The data mappings in the
+  * "DataMappings" group can be built by several threads (see
+  * set_deserialization_threads()).
+  *
   * @param group a netCDF::NcGroup holding the data in the format described
   *        in the comments to serialize(),
   */
 
  void deserialize( const netCDF::NcGroup & group ) override;
 
+/*--------------------------------------------------------------------------*/
+ /// enables or disables the lazy deserialization of all StochasticBlock
+ /** This method enables or disables, for all the StochasticBlock which are
+  * deserialized from now on, the lazy deserialization of the "Block" group
+  * and of the data mappings (see deserialize()). This is useful when a file
+  * holds many StochasticBlock but only some of them are actually used (say,
+  * by a worker handling one stage): the inner Block of the others is never
+  * built, which saves both time and memory.
+  *
+  * The inner Block and the data mappings are built by
+  * complete_deserialization(), which is automatically called by all the
+  * methods of StochasticBlock needing them, such as get_inner_block(),
+  * get_data_mappings(), set_data() and serialize(), and by the virtual
+  * methods of Block it overrides: the ones a Solver calls on the Block it
+  * is registered to (generate_abstract_variables(),
+  * generate_abstract_constraints() and generate_objective()), as well as
+  * add_Modification(), get_R3_Block() and get_objective_sense(). Only the
+  * non-virtual methods of Block (say, get_nested_Blocks()) do not know
+  * about it: code using them without calling any of the above must first
+  * call complete_deserialization(). The completion is done only once even
+  * if several threads call (say) get_inner_block() on the same
+  * StochasticBlock at the same time.
+  *
+  * The setting is global, and it can be changed while other threads
+  * deserialize StochasticBlock: each deserialize() reads it once. The
+  * netCDF file of a lazily deserialized StochasticBlock must remain open
+  * until its deserialization is completed (see deserialize()). */
+
+ static void set_lazy_deserialization( bool lazy = true ) {
+  lazy_deserialization.store( lazy );
+ }
+
+/*--------------------------------------------------------------------------*/
+ /// sets the number of threads building the data mappings when deserializing
+ /** The data mappings in the "DataMappings" group (see serialize()) are
+  * deserialized in two phases: all the variables of the group are first
+  * read by the calling thread (the netCDF library is not thread-safe), and
+  * then each data mapping is built out of them: its sets are copied, its
+  * Block is found in the inner Block and its method is looked up by name.
+  * With thousands of data mappings having large sets, the second phase
+  * takes most of the time, and this method allows it to be split among \p
+  * number_threads threads, for all the StochasticBlock which are
+  * deserialized from now on (including the completion of a lazy
+  * deserialization, see set_lazy_deserialization()), like the ones built
+  * by Block::new_Block(); the result does not depend on the number of
+  * threads. Like set_lazy_deserialization(), the setting is global and it
+  * can be changed while other threads deserialize StochasticBlock.
+  *
+  * While the data mappings are built, the inner Block must not be changed
+  * and no method must be registered (see Block::register_method()).
+  *
+  * @param number_threads The number of threads; if it is zero,
+  *        std::thread::hardware_concurrency() threads are used. The default
+  *        is 1, i.e., the data mappings are built by the calling thread. */
+
+ static void set_deserialization_threads( Index number_threads ) {
+  deserialization_threads.store( number_threads );
+ }
+
+/*--------------------------------------------------------------------------*/
+ /// enables or disables writing the "DataMappings" group in serialize()
+ /** This method enables or disables, for all the StochasticBlock which are
+  * serialized from now on, writing the data mappings as the "DataMappings"
+  * group (see serialize()), which is much faster to read and write than the
+  * format of the SMS++ core when there are many data mappings. It is
+  * disabled by default, since only the readers knowing it (say, the
+  * deserialize() of this version of StochasticBlock) can read a file
+  * holding it; deserialize() always accepts both formats. */
+
+ static void set_data_mappings_group( bool write = true ) {
+  write_data_mappings_group.store( write );
+ }
+
+/*--------------------------------------------------------------------------*/
+ /// builds the inner Block and the data mappings, if they are still pending
+ /** If this StochasticBlock has been lazily deserialized (see
+  * set_lazy_deserialization()) and its inner Block and data mappings have
+  * not been built yet, this method builds them out of the netCDF::NcGroup
+  * given to deserialize(), which must still be valid; otherwise, it does
+  * nothing. This method can be called by several threads at the same time:
+  * only one of them builds the inner Block and the data mappings, while
+  * the others wait for it to finish. If building them throws, the next
+  * call tries again. */
+
+ void complete_deserialization() const {
+  if( lazy && ( ! lazy->done.load( std::memory_order_acquire ) ) )
+   std::call_once( lazy->once , [ this ]() {
+    // the inner Block and the data mappings are logically part of the
+    // (already deserialized) state, and call_once serializes the writes
+    auto self = const_cast< StochasticBlock * >( this );
+    self->deserialize_inner_block( lazy->group );
+    lazy->done.store( true , std::memory_order_release );
+    } );
+ }
+
+
+/*--------------------------------------------------------------------------*/
+ /// returns a deep copy of this StochasticBlock (see clone())
+ /** Returns a new StochasticBlock (or fills \p base, which must then be a
+  * StochasticBlock) which is a deep copy of this one:
+  *
+  * - the inner Block is copied with its get_R3_Block( \p r3bc ), which must
+  *   return a copy having the same structure of nested Blocks (this is what
+  *   a Block without any "reformulation" does);
+  *
+  * - each data mapping is copied and rebound to the Block of the copy
+  *   corresponding to its own Block, i.e., the one found by following the
+  *   same path of nested Blocks from the inner Block; a data mapping whose
+  *   Block is not a (nested) Block of the inner Block keeps it;
+  *
+  * - the ScenarioSet (if any) is copied, and so are the modes of set_data()
+  *   (delta, compiled, deferred and grouped Modification), while the last
+  *   and pending scenarios, the statistics, the ScenarioGenerator and the
+  *   WarmStartCache are not.
+  *
+  * Only the data mappings whose layout is known (see
+  * compile_data_mappings()) can be copied; if some is not,
+  * std::logic_error is thrown. No netCDF round trip is involved, so that
+  * creating many replicas (say, the workers of a ScenarioEvaluator) is
+  * cheap.
+  *
+  * @param r3bc The Configuration passed to get_R3_Block() of the inner
+  *        Block.
+  *
+  * @param base If not nullptr, the StochasticBlock which becomes the copy
+  *        (its previous inner Block and data mappings are destroyed).
+  *
+  * @param father The father of the new StochasticBlock (ignored if \p base
+  *        is not nullptr).
+  *
+  * @return The copy. */
+
+ Block * get_R3_Block( Configuration * r3bc = nullptr , Block * base = nullptr ,
+                       Block * father = nullptr ) override;
+
+/*--------------------------------------------------------------------------*/
+ /// returns a deep copy of this StochasticBlock, with its data mappings
+ /** Returns a deep copy of this StochasticBlock, whose data mappings refer
+  * to the copy of the inner Block, as described in get_R3_Block().
+  *
+  * @param father The father of the new StochasticBlock. */
+
+ std::unique_ptr< StochasticBlock > clone( Block * father = nullptr ) {
+  return std::unique_ptr< StochasticBlock >( static_cast< StochasticBlock * >(
+   get_R3_Block( nullptr , nullptr , father ) ) );
+ }
+
 /*--------------------------------------------------------------------------*/
  /// destructor of StochasticBlock
  /** Destructor of StochasticBlock. It destroys the inner Block (if any),
@@ -195,6 +473,43 @@ public:
 /** @name Other initializations
  *  @{ */
 
+ /// generates the abstract Variable of the StochasticBlock
+ /** A StochasticBlock has no Variable of its own: this method only makes
+  * sure that a lazy deserialization (see set_lazy_deserialization()) is
+  * completed, since it is called by the Solver registered to this
+  * StochasticBlock before they look at its inner Block. */
+
+ void generate_abstract_variables( Configuration * stvv = nullptr )
+  override {
+  complete_deserialization();
+  Block::generate_abstract_variables( stvv );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// generates the abstract Constraint of the StochasticBlock
+ /** Like generate_abstract_variables(), only completes a lazy
+  * deserialization. */
+
+ void generate_abstract_constraints( Configuration * stcc = nullptr )
+  override {
+  complete_deserialization();
+  Block::generate_abstract_constraints( stcc );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// generates the Objective of the StochasticBlock
+ /** Like generate_abstract_variables(), only completes a lazy
+  * deserialization. */
+
+ void generate_objective( Configuration * objc = nullptr ) override {
+  complete_deserialization();
+  Block::generate_objective( objc );
+ }
+
+/*--------------------------------------------------------------------------*/
+
  /// set the (only) sub-Block of this StochasticBlock
  /** This method sets the only sub-Block of this StochasticBlock.
   *
@@ -206,23 +521,8 @@ public:
   *        its allocated memory is released.
   */
  void set_inner_block( Block * block , bool destroy_previous_block = true ) {
-  if( ( ! v_Block.empty() ) && ( block == v_Block.front() ) &&
-      ( ! destroy_previous_block ) )
-   return; // the given Block is already here; silently return
-
-  if( destroy_previous_block && ( ! v_Block.empty() ) ) {
-   assert( v_Block.size() == 1 );
-   delete v_Block.front();
-  }
-
-  v_Block.clear();
-  v_Block.push_back( block );
-
-  if( block )
-   block->set_f_Block( this );
-
- if( anyone_there() )
-  add_Modification( std::make_shared< NBModification >( this ) );
+  complete_deserialization();
+  replace_inner_block( block , destroy_previous_block );
  }
 
 /*--------------------------------------------------------------------------*/
@@ -240,7 +540,247 @@ public:
   */
  void set_data_mappings( std::vector< std::unique_ptr< SimpleDataMappingBase > >
                          && data_mappings ) {
+  complete_deserialization();
   this->data_mappings = std::move( data_mappings );
+  layouts_valid = false;
+  reset_last_scenario();
+  discard_pending_data();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the ScenarioSet of this StochasticBlock
+ /** This method sets the ScenarioSet of this StochasticBlock, i.e., the set
+  * of scenarios that can be applied by giving their index to set_data(). The
+  * previous ScenarioSet (if any) is destroyed. Each scenario in the set is
+  * expected to be compatible with the data mappings of this
+  * StochasticBlock.
+  *
+  * @param scenario_set The new ScenarioSet, possibly nullptr. */
+
+ void set_scenario_set( std::unique_ptr< ScenarioSet > scenario_set ) {
+  this->scenario_set = std::move( scenario_set );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the ScenarioGenerator of this StochasticBlock
+ /** This method sets the ScenarioGenerator of this StochasticBlock, i.e.,
+  * the object describing the probability distribution of its data, which
+  * is used by set_random_data(). The previous ScenarioGenerator (if any) is
+  * destroyed.
+  *
+  * @param scenario_generator The new ScenarioGenerator, possibly nullptr. */
+
+ void set_scenario_generator(
+  std::unique_ptr< ScenarioGenerator > scenario_generator ) {
+  this->scenario_generator = std::move( scenario_generator );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the WarmStartCache of this StochasticBlock
+ /** This method sets the WarmStartCache used by store_solution() and
+  * warm_start(); the previous one (if any) is destroyed. Giving nullptr
+  * removes the WarmStartCache.
+  *
+  * @param cache The WarmStartCache. */
+
+ void set_warm_start_cache( std::unique_ptr< WarmStartCache > cache ) {
+  warm_start_cache = std::move( cache );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// enables or disables the "delta mode" of set_data()
+ /** This method enables or disables the "delta mode" of set_data(). When
+  * this mode is enabled, the StochasticBlock keeps a copy of the last
+  * scenario that has been passed to set_data() and, at each subsequent call
+  * to set_data(), only the entries of the new scenario that differ from the
+  * ones of the last scenario are written into the inner Block. The first
+  * call to set_data() after the delta mode is enabled (or after
+  * reset_last_scenario() is called) always writes the whole scenario.
+  *
+  * Note that the delta mode assumes that the data of the inner Block
+  * associated with the DataMapping is only changed by means of set_data()
+  * of this StochasticBlock. If that data is changed by other means, then
+  * reset_last_scenario() must be called, or the next call to set_data()
+  * may fail to write some of the entries.
+  *
+  * The delta mode requires to know which entries of the scenario are used by
+  * each DataMapping, which is currently possible for all the
+  * SimpleDataMapping having Subset or Range as their sets and int or double
+  * as their type. Any other SimpleDataMappingBase is always fully applied.
+  *
+  * @param delta_mode indicates whether the delta mode must be enabled. */
+
+ void set_delta_mode( bool delta_mode = true ) {
+  this->delta_mode = delta_mode;
+  reset_last_scenario();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// enables or disables the use of a compiled plan in set_data()
+ /** This method enables or disables the use of a "compiled plan" in
+  * set_data(). By default, set_data() calls the set_data() method of each
+  * SimpleDataMappingBase in turn, which in turn (typically) builds the
+  * Subset or Range of the positions to be written and calls the registered
+  * Block method. When the compiled plan is enabled, all the data mappings
+  * are instead flattened once and for all into a sequence of steps, where:
+  *
+  * - the data mappings calling the same method of the same Block (and
+  *   having the same type of data) are merged into a single step, so that
+  *   the method is called only once for all of them;
+  *
+  * - the positions of the scenario read by each step are resolved once,
+  *   and if they are contiguous and the data is double, the scenario is
+  *   passed to the method of the Block without any copy;
+  *
+  * - if the positions of the Block written by a step are contiguous and
+  *   the Block also has a method with the same name taking a Range, that
+  *   method is used; conversely, the positions written by a method taking a
+  *   Range are split into contiguous runs once and for all.
+  *
+  * The plan is (re)built at the first call to set_data() after the data
+  * mappings have changed. Merging requires the data mappings to report the
+  * name of their Block method: those that do not are never merged. The
+  * data mappings whose layout is not known are always applied as they
+  * are. Note that the compiled plan is not used in delta mode (see
+  * set_delta_mode()), which already only writes what has changed.
+  *
+  * @param compile indicates whether the compiled plan must be used. */
+
+ void compile_data_mappings( bool compile = true ) {
+  compiled = compile;
+  layouts_valid = false;
+  plan.clear();
+  plan_mappings.clear();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// forgets the last scenario passed to set_data() in delta mode
+ /** This method makes the StochasticBlock forget the last scenario that has
+  * been passed to set_data() while in delta mode, so that the next call to
+  * set_data() writes the whole scenario into the inner Block. */
+
+ void reset_last_scenario() {
+  last_scenario.clear();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// enables or disables the "deferred mode" of set_data()
+ /** This method enables or disables the "deferred mode" of set_data(). When
+  * this mode is enabled, set_data() does not write the scenario into the
+  * inner Block: it only records it as the "pending scenario", marking the
+  * entries which differ from the ones previously recorded. The pending
+  * scenario can also be partly changed with set_data_entries(). The
+  * pending scenario is actually written into the inner Block by
+  * flush_data(), which only calls the data mappings having at least one
+  * changed entry. Hence, when set_data() is called several times before the
+  * inner Block is used (say, solved), each entry is only written once, and
+  * no Modification is issued for intermediate values nobody looks at.
+  *
+  * It is responsibility of the caller to call flush_data() before the inner
+  * Block is used (ScenarioEvaluator::evaluate() does it automatically after
+  * setting the scenario of a worker). The Modification are issued by
+  * flush_data() according to the parameters given to the last call to
+  * set_data() or set_data_entries(). The pending scenario is discarded when
+  * the inner Block or the data mappings are changed.
+  *
+  * Only the data mappings whose layout is known (see set_delta_mode()) are
+  * deferred; any other SimpleDataMappingBase is fully applied by each call
+  * to set_data(). The deferred mode can be combined with the delta mode or
+  * the compiled plan, which are then used by flush_data().
+  *
+  * @param deferred_mode indicates whether the deferred mode must be
+  *        enabled; if it is disabled, the pending scenario is flushed. */
+
+ void set_deferred_mode( bool deferred_mode = true ) {
+  if( ! deferred_mode )
+   flush_data();
+  this->deferred_mode = deferred_mode;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// writes the pending scenario into the inner Block (see set_deferred_mode())
+ /** Writes the changed entries of the pending scenario into the inner Block,
+  * by calling (the compiled plan steps of) the data mappings having at least
+  * one changed entry, or by the delta mode if it is enabled. Does nothing
+  * if no entry has changed since the last call. The elements written are
+  * counted in the statistics (if they are enabled), but not as a further
+  * call to set_data(). */
+
+ void flush_data();
+
+/*--------------------------------------------------------------------------*/
+
+ /// discards the pending scenario of the deferred mode (if any)
+ /** Discards the pending scenario of the deferred mode (if any), without
+  * writing it into the inner Block; the next call to set_data() in deferred
+  * mode will mark all the entries as changed. */
+
+ void discard_pending_data() {
+  pending_scenario.clear();
+  changed_entries.clear();
+  pending = false;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// enables or disables grouping the Modification of each set_data()
+ /** This method enables or disables grouping the Modification issued while
+  * writing a scenario. By default, each data mapping (or step of the
+  * compiled plan) issues its own Modification as the registered Block
+  * method is called, so that changing a scenario may send dozens of small
+  * Modification to the Solvers. When the grouping is enabled, each call to
+  * set_data() (as well as each flush_data() and restore_snapshot()) that
+  * issues some Modification opens a new channel (see Block::open_channel()),
+  * nested into the channel of \p issuePMod (or, if that is 0, of \p
+  * issueAMod), and the data mappings issue their
+  * Modification into it; the channel is closed when the whole scenario has
+  * been written, so that the Solvers receive a single GroupModification
+  * per scenario and can process all the changes in one pass. Nothing is
+  * done if nobody is listening (see Block::anyone_there()) or no
+  * Modification is asked for (eNoMod).
+  *
+  * @param group indicates whether the Modification must be grouped. */
+
+ void set_group_modifications( bool group = true ) {
+  group_modifications = group;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// enables or disables the collection of statistics
+ /** This method enables or disables the collection of the counters
+  * described in Statistics, which can then be read with get_statistics()
+  * and are printed by print() with vlvl > 1. When the statistics are
+  * disabled (the default) the only overhead on set_data() is a test for
+  * each data mapping; when they are enabled, the clock is also read twice
+  * for each data mapping (or step of the compiled plan). Enabling the
+  * statistics when they already are enabled does not reset them (see
+  * reset_statistics()), while disabling them discards them.
+  *
+  * @param enable true if the statistics must be collected. */
+
+ void enable_statistics( bool enable = true ) {
+  if( ! enable )
+   statistics.reset();
+  else if( ! statistics )
+   statistics = std::make_unique< Statistics >();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// resets to zero all the statistics (if they are enabled)
+
+ void reset_statistics() {
+  if( statistics )
+   *statistics = Statistics();
  }
 
 /** @} ---------------------------------------------------------------------*/
@@ -249,6 +789,23 @@ public:
 /** @name Methods for handling Modification
  *  @{ */
 
+ /// adds a Modification to the StochasticBlock
+ /** Adds a Modification to the StochasticBlock. This is typically called by
+  * the inner Block (or any of its sub-Blocks) when its data is changed, e.g.
+  * as a consequence of set_data(). The Modification is forwarded as it is,
+  * on the given channel, to the Solvers attached to this StochasticBlock and
+  * to its father Block (if any), so that the Solvers can react to the
+  * specific change (say, a change in some right-hand sides or costs)
+  * rather than having to consider the whole inner Block as changed. If no
+  * one is listening, the Modification is simply discarded.
+  *
+  * @param mod The Modification to be added.
+  *
+  * @param chnl The channel in which the Modification must be added.
+  *
+  * If the statistics are enabled (see enable_statistics()), the
+  * Modification is counted, whether or not anyone is listening. */
+
  void add_Modification( sp_Mod mod , Observer::ChnlName chnl = 0 ) override;
 
 /** @} ---------------------------------------------------------------------*/
@@ -258,6 +815,10 @@ public:
  *  @{ */
 
  /// prints the StochasticBlock onto an ostream
+ /** Prints the StochasticBlock onto an ostream. With vlvl > 0, also the
+  * number of data mappings, the ScenarioSet (if any) and the modes of
+  * set_data() are printed; with vlvl > 1, also the statistics (if they are
+  * enabled, see enable_statistics()). */
 
  void print( std::ostream & output , char vlvl = 0 ) const override;
 
@@ -270,12 +831,59 @@ public:
   *   group is optional. If it is not provided, then the inner Block must be
   *   provided by other means.
   *
-  * - The description of a vector of SimpleDataMappingBase, containing the
-  *   DataMappings associated with this StochasticBlock. This is optional. For
-  *   the time being, each provided DataMapping is expected to be a
-  *   SimpleDataMappingBase. Moreover, the inner Block of this StochasticBlock
-  *   will serve as the reference Block for both the serialization and
-  *   deserialization of each SimpleDataMappingBase.
+  * - The group "DataMappings", containing the DataMappings associated with
+  *   this StochasticBlock. This group is optional, and it is only written
+  *   if it has been enabled by set_data_mappings_group() (by default it is
+  *   not, so that the file can be read by the readers of the format of the
+  *   SMS++ core) and each DataMapping is a SimpleDataMapping whose sets are
+  *   Subset or Range, whose data is int or double, which has the name of
+  *   the method it calls and whose Block is the inner Block or one of its
+  *   (recursively) nested Blocks. It has:
+  *
+  *   - the dimension "NumberDataMappings", the number of DataMappings;
+  *
+  *   - the variable "Type", of type netCDF::NcInt and indexed over
+  *     "NumberDataMappings", whose bits tell for each DataMapping whether
+  *     its "from" set is a Range (1), its "to" set is a Range (2), its
+  *     data is int (4), its "from" set is encoded (8) and its "to" set is
+  *     encoded (16);
+  *
+  *   - the variables "SetFromSize" and "SetToSize", of type
+  *     netCDF::NcUint and indexed over "NumberDataMappings", holding the
+  *     number of elements of the "from" and of the "to" set of each
+  *     DataMapping (2 for a Range, whose elements are its two ends). A
+  *     Subset set is encoded, that is, its elements are the ones written
+  *     by CompressedSubset::encode() (runs, strided progressions and
+  *     literal segments), whenever they are fewer than its indices;
+  *
+  *   - the dimensions "SetFromLength" and "SetToLength", the total number
+  *     of elements of the "from" and of the "to" sets, and the variables
+  *     "SetFromElements" and "SetToElements", of type netCDF::NcUint and
+  *     indexed over them, holding the elements of all the sets, one
+  *     DataMapping after the other;
+  *
+  *   - the variable "BlockPathSize", of type netCDF::NcUint and indexed
+  *     over "NumberDataMappings", the dimension "BlockPathLength" and the
+  *     variable "BlockPath", of type netCDF::NcUint and indexed over it,
+  *     holding in the same way, for each DataMapping, the indices of the
+  *     nested Blocks leading from the inner Block to its Block (none if it
+  *     is the inner Block);
+  *
+  *   - the variable "FunctionNameSize", of type netCDF::NcUint and indexed
+  *     over "NumberDataMappings", the dimension "FunctionNameLength" and
+  *     the variable "FunctionName", of type netCDF::NcChar and indexed over
+  *     it, holding in the same way the name of the method of each
+  *     DataMapping (see Block::register_method()).
+  *
+  *   A dimension whose size would be zero, and the variable indexed over
+  *   it, are not written. If the DataMappings are not written in this
+  *   format, they are described by SimpleDataMappingBase::serialize() (with
+  *   the inner Block as the reference Block), in the format of the SMS++
+  *   core.
+  *
+  * - The group "ScenarioSet", containing the description of the ScenarioSet
+  *   of this StochasticBlock, in the format explained in the comments of
+  *   ScenarioSet::serialize(). This group is optional.
   */
 
  virtual void serialize( netCDF::NcGroup & group ) const override;
@@ -302,8 +910,11 @@ public:
  void set_data( const std::vector< double > & data ,
                 c_ModParam issuePMod = eNoBlck ,
                 c_ModParam issueAMod = eNoBlck ) {
-  for( size_t i = 0 ; i < data_mappings.size() ; ++i )
-   data_mappings[ i ]->set_data( data.begin() , issuePMod , issueAMod );
+  if( delta_mode || compiled || deferred_mode ) {
+   update_layouts();
+   assert( data.size() >= scenario_dimension );
+   }
+  set_data( data.cbegin() , issuePMod , issueAMod );
  }
 
 /*--------------------------------------------------------------------------*/
@@ -312,6 +923,13 @@ public:
  /** This function sets the value of the (possibly stochastic) data of this
   * StochasticBlock.
   *
+  * The data mappings only accept iterators of std::vector< double >: any
+  * other iterator (say, a pointer into a MappedScenarioSet) is accepted as
+  * well, the entries of the scenario used by the data mappings being first
+  * copied into an internal buffer, but only if no data mapping is opaque
+  * (see compile_data_mappings()), since otherwise it is not known which
+  * entries they use; if some is, std::logic_error is thrown.
+  *
   * @param data An iterator to the first element of the data.
   *
   * @param issuePMod Decides if and how a "physical Modification" is issued,
@@ -320,13 +938,329 @@ public:
   * @param issueAMod Decides if and how an "abstract Modification" is issued,
   *        as described in Observer::make_par().
   */
- template< class Iterator >
+ template< class Iterator , typename = typename std::enable_if_t<
+                             ! std::is_integral_v< Iterator > > >
  void set_data( Iterator data , c_ModParam issuePMod = eNoBlck ,
                 c_ModParam issueAMod = eNoBlck ) {
-  for( size_t i = 0 ; i < data_mappings.size() ; ++i )
-   data_mappings[ i ]->set_data( data , issuePMod , issueAMod );
+  if constexpr( ! std::is_convertible_v< Iterator ,
+                std::vector< double >::const_iterator > ) {
+   update_layouts();
+   if( ! opaque_mappings.empty() )
+    throw( std::logic_error( "StochasticBlock::set_data: opaque data "
+                             "mappings require a std::vector iterator" ) );
+   scenario_buffer.resize( scenario_dimension );
+   std::copy_n( data , scenario_dimension , scenario_buffer.begin() );
+   set_data( scenario_buffer.cbegin() , issuePMod , issueAMod );
+   }
+  else {
+   complete_deserialization();
+   if( statistics )
+    start_statistics();
+
+   issue_grouped( issuePMod , issueAMod ,
+                  [ & ]( c_ModParam pmod , c_ModParam amod ) {
+    if( delta_mode || compiled || deferred_mode ) {
+     update_layouts();
+     set_data_layouts( data , pmod , amod );
+     for( auto i : opaque_mappings )
+      set_data_mapping( i , data , pmod , amod );
+     return;
+     }
+
+    for( Index i = 0 ; i < data_mappings.size() ; ++i )
+     set_data_mapping( i , data , pmod , amod );
+   } );
+   }
  }
 
+/*--------------------------------------------------------------------------*/
+
+ /// stores the current Solution of the inner Block for the given scenario
+ /** This function reads the current Solution of the inner Block (see
+  * Block::get_Solution()) and stores it in the WarmStartCache (see
+  * set_warm_start_cache()) for the given scenario, which is typically the
+  * one that has just been solved. Only the entries of the scenario used by
+  * the data mappings are considered.
+  *
+  * @param scenario An iterator to the first element of the scenario.
+  *
+  * @return false if the inner Block provides no Solution. */
+
+ bool store_solution( std::vector< double >::const_iterator scenario );
+
+/*--------------------------------------------------------------------------*/
+
+ /// writes into the inner Block the cached Solution of a similar scenario
+ /** This function looks in the WarmStartCache (see set_warm_start_cache())
+  * for the Solution of the given scenario or, failing that, of the closest
+  * cached scenario (see WarmStartCache::find()), and writes it into the
+  * inner Block (see Solution::write()), so that a Solver can start from it.
+  * The scenario is typically the one that has just been given to
+  * set_data().
+  *
+  * @param scenario An iterator to the first element of the scenario.
+  *
+  * @param exact If not nullptr, on return it tells whether the Solution
+  *        was the one of the same scenario.
+  *
+  * @return true if a Solution has been written. */
+
+ bool warm_start( std::vector< double >::const_iterator scenario ,
+                  bool * exact = nullptr );
+
+/*--------------------------------------------------------------------------*/
+
+ /// restores the data of the inner Block saved in a Snapshot
+ /** This function restores the data of the inner Block handled by the data
+  * mappings to the values saved in the given Snapshot (see take_snapshot()).
+  *
+  * The StochasticBlock keeps track of the positions of the inner Block that
+  * it writes (by set_data(), flush_data(), set_data_entries() and so on)
+  * after the last Snapshot has been taken, or restored. If \p snapshot is
+  * that Snapshot, only those positions are written back, and nothing is
+  * read, so that restoring it after a scenario has changed only a few
+  * values is cheap. Otherwise (say, an older Snapshot is restored), the
+  * current values are all read first, by means of the registered Getters
+  * (see register_getter()), and only those that differ from the saved ones
+  * are written. Note that the data of the inner Block changed in any other
+  * way than through this StochasticBlock are not seen, hence not restored,
+  * in the first case. The last scenario of the delta mode is forgotten
+  * (see reset_last_scenario()) and the pending scenario of the deferred
+  * mode, if any, is discarded.
+  *
+  * @param snapshot The Snapshot, which must have been taken with the same
+  *        data mappings.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+ void restore_snapshot( const Snapshot & snapshot ,
+                        c_ModParam issuePMod = eNoBlck ,
+                        c_ModParam issueAMod = eNoBlck );
+
+/*--------------------------------------------------------------------------*/
+
+ /// changes some entries of the pending scenario (see set_deferred_mode())
+ /** This function changes the given entries of the pending scenario of the
+  * deferred mode, which must be enabled, leaving the other entries
+  * unchanged; the changed entries are written into the inner Block by the
+  * next call to flush_data(). A whole scenario must have been given to
+  * set_data() before (since the deferred mode has been enabled, or the
+  * pending scenario has been discarded).
+  *
+  * @param positions The positions in the scenario of the entries to be
+  *        changed.
+  *
+  * @param values An iterator to the first of the positions.size() new
+  *        values of the entries, in the same order as \p positions.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued
+  *        by flush_data(), as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued
+  *        by flush_data(), as described in Observer::make_par().
+  */
+ template< class Iterator >
+ void set_data_entries( const Subset & positions , Iterator values ,
+                        c_ModParam issuePMod = eNoBlck ,
+                        c_ModParam issueAMod = eNoBlck ) {
+  if( ! deferred_mode )
+   throw( std::logic_error( "StochasticBlock::set_data_entries: the "
+                            "deferred mode is not enabled" ) );
+  update_layouts();
+  if( pending_scenario.size() != scenario_dimension )
+   throw( std::logic_error( "StochasticBlock::set_data_entries: there is "
+                            "no pending scenario" ) );
+
+  for( auto position : positions ) {
+   assert( position < scenario_dimension );
+   const double value = *(values++);
+   if( value != pending_scenario[ position ] ) {
+    pending_scenario[ position ] = value;
+    changed_entries[ position ] = true;
+    pending = true;
+    }
+   }
+  pending_pmod = issuePMod;
+  pending_amod = issueAMod;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// writes some entries of a scenario into the inner Block
+ /** This function writes into the inner Block only the given entries of the
+  * given scenario, i.e., it only calls the data mappings using (some of)
+  * them, and each one only for the positions of the inner Block
+  * corresponding to the given entries (the whole data mapping is applied if
+  * all its entries are given). This is useful when the caller knows which
+  * entries have changed since the scenario previously written, say, when
+  * traversing a ScenarioTree. The data mappings whose layout is not known
+  * (see compile_data_mappings()) are always fully applied. The entries are
+  * written at once, also in deferred mode (whose pending scenario is
+  * discarded), and the last scenario of the delta mode, if any, is updated
+  * accordingly.
+  *
+  * @param positions The positions in the scenario of the entries to be
+  *        written (without duplicates).
+  *
+  * @param data An iterator to the first element of the scenario, having at
+  *        least as many elements as the entries used by the data mappings.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+ void write_data_entries( const Subset & positions ,
+                          std::vector< double >::const_iterator data ,
+                          c_ModParam issuePMod = eNoBlck ,
+                          c_ModParam issueAMod = eNoBlck );
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the data of this StochasticBlock to a scenario of a ScenarioSet
+ /** This function sets the value of the (possibly stochastic) data of this
+  * StochasticBlock to the given scenario of the given ScenarioSet. No copy
+  * of the scenario is made.
+  *
+  * @param scenarios The ScenarioSet.
+  *
+  * @param scenario The index of the scenario in \p scenarios.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+ void set_data( const ScenarioSet & scenarios , Index scenario ,
+                c_ModParam issuePMod = eNoBlck ,
+                c_ModParam issueAMod = eNoBlck ) {
+  set_data( scenarios.get_scenario( scenario ) , issuePMod , issueAMod );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the data of this StochasticBlock to a scenario of a CompactScenarioSet
+ /** This function sets the value of the (possibly stochastic) data of this
+  * StochasticBlock to the given scenario of the given CompactScenarioSet,
+  * which is decoded (in a single pass) into an internal buffer.
+  *
+  * @param scenarios The CompactScenarioSet.
+  *
+  * @param scenario The index of the scenario in \p scenarios.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+ void set_data( const CompactScenarioSet & scenarios , Index scenario ,
+                c_ModParam issuePMod = eNoBlck ,
+                c_ModParam issueAMod = eNoBlck ) {
+  scenario_buffer.resize( scenarios.get_dimension() );
+  scenarios.get_scenario( scenario , scenario_buffer.data() );
+  set_data( scenario_buffer.cbegin() , issuePMod , issueAMod );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the data of this StochasticBlock to one of its scenarios
+ /** This function sets the value of the (possibly stochastic) data of this
+  * StochasticBlock to the given scenario of its ScenarioSet (see
+  * set_scenario_set()).
+  *
+  * @param scenario The index of the scenario in the ScenarioSet.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+ void set_data( Index scenario , c_ModParam issuePMod = eNoBlck ,
+                c_ModParam issueAMod = eNoBlck ) {
+  if( ! scenario_set )
+   throw( std::logic_error( "StochasticBlock::set_data: there is no "
+                            "ScenarioSet" ) );
+  set_data( *scenario_set , scenario , issuePMod , issueAMod );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the data of this StochasticBlock to a random scenario
+ /** This function generates a random scenario with the ScenarioGenerator of
+  * this StochasticBlock (see set_scenario_generator()) and sets the data of
+  * this StochasticBlock to that scenario. The scenario is generated into a
+  * buffer owned by the StochasticBlock, which is reused at each call, and
+  * can be read afterwards with get_random_data().
+  *
+  * @param engine The source of randomness; in order to obtain reproducible
+  *        results, each thread should use its own RandomEngine (see
+  *        ScenarioGenerator::get_engine()).
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+ void set_random_data( ScenarioGenerator::RandomEngine & engine ,
+                       c_ModParam issuePMod = eNoBlck ,
+                       c_ModParam issueAMod = eNoBlck ) {
+  if( ! scenario_generator )
+   throw( std::logic_error( "StochasticBlock::set_random_data: there is no "
+                            "ScenarioGenerator" ) );
+  random_scenario.resize( scenario_generator->get_dimension() );
+  scenario_generator->generate( random_scenario.begin() , engine );
+  set_data( random_scenario.cbegin() , issuePMod , issueAMod );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the data of this StochasticBlock to its expected scenario
+ /** This function sets the data of this StochasticBlock to the expected
+  * scenario of its ScenarioSet (see set_scenario_set()), i.e., the mean of
+  * its scenarios weighted by their probabilities (see ScenarioStatistics),
+  * as in the expected-value problem. Throws std::logic_error if there is
+  * no ScenarioSet or if it is empty. For a MappedScenarioSet (possibly
+  * larger than the memory), ScenarioStatistics::get_mean() can be given to
+  * set_data() instead.
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+ void set_expected_data( c_ModParam issuePMod = eNoBlck ,
+                         c_ModParam issueAMod = eNoBlck );
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the data of this StochasticBlock to a quantile scenario
+ /** This function sets each entry of the data of this StochasticBlock to
+  * the \p p quantile of that entry in the scenarios of its ScenarioSet (see
+  * set_scenario_set()), weighted by their probabilities; the quantiles are
+  * exact (see ScenarioStatistics::get_quantile()). Throws std::logic_error
+  * if there is no ScenarioSet or if it is empty.
+  *
+  * @param p The probability level, in [ 0 , 1 ].
+  *
+  * @param issuePMod Decides if and how a "physical Modification" is issued,
+  *        as described in Observer::make_par().
+  *
+  * @param issueAMod Decides if and how an "abstract Modification" is issued,
+  *        as described in Observer::make_par().
+  */
+ void set_quantile_data( double p , c_ModParam issuePMod = eNoBlck ,
+                         c_ModParam issueAMod = eNoBlck );
+
 /*--------------------------------------------------------------------------*/
 
  /// adds a new SimpleDataMappingBase to this StochasticBlock
@@ -336,7 +1270,11 @@ public:
   * @param data_mapping The SimpleDataMappingBase to be added.
   */
  void add_data_mapping( std::unique_ptr< SimpleDataMappingBase > data_mapping ) {
+  complete_deserialization();
   data_mappings.push_back( std::move( data_mapping ) );
+  layouts_valid = false;
+  reset_last_scenario();
+  discard_pending_data();
  }
 
 /**@} ----------------------------------------------------------------------*/
@@ -362,6 +1300,28 @@ public:
   return Objective::eUndef;
  }
 
+/*--------------------------------------------------------------------------*/
+
+ /// registers a Getter for the method of the given name
+ /** This function registers the Getter which reads the data written by the
+  * method with the given name (the same used with Block::register_method(),
+  * say "UCBlock::set_active_power_demand") and data of type T (int or
+  * double). This is what allows take_snapshot() and get_current_data() to
+  * read the data of the inner Block for the SimpleDataMapping having that
+  * method. It is typically called in the static_initialization() of the
+  * Block class which registers the method. Note that the Block classes of
+  * SMS++ do not register any Getter (yet), hence take_snapshot() and
+  * get_current_data() throw std::logic_error for them until they do.
+  *
+  * @param name The name of the method writing the data.
+  *
+  * @param getter The Getter reading the data. */
+
+ template< class T >
+ static void register_getter( const std::string & name , Getter getter ) {
+  get_getters()[ { name , std::is_same_v< T , int > } ] = std::move( getter );
+ }
+
 /*--------------------------------------------------------------------------*/
 
  /// returns the vector of pointers to SimpleDataMappingBase
@@ -374,6 +1334,7 @@ public:
 
  const std::vector< std::unique_ptr< SimpleDataMappingBase > > &
  get_data_mappings() const {
+  complete_deserialization();
   return data_mappings;
  }
 
@@ -387,19 +1348,437 @@ public:
   */
 
  Block * get_inner_block() const {
+  complete_deserialization();
   return v_Block.empty() ? nullptr : v_Block.front();
  }
 
+/*--------------------------------------------------------------------------*/
+
+ /// returns a pointer to the ScenarioSet (nullptr if there is none)
+
+ ScenarioSet * get_scenario_set() const { return scenario_set.get(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns a pointer to the ScenarioGenerator (nullptr if there is none)
+
+ ScenarioGenerator * get_scenario_generator() const {
+  return scenario_generator.get();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns a pointer to the WarmStartCache (nullptr if there is none)
+
+ WarmStartCache * get_warm_start_cache() const {
+  return warm_start_cache.get();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the last scenario generated by set_random_data()
+
+ const std::vector< double > & get_random_data() const {
+  return random_scenario;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether the delta mode of set_data() is enabled
+
+ bool is_delta_mode() const { return delta_mode; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the positions in the scenario used by the i-th data mapping
+ /** Returns the positions in the scenario of the entries used by the i-th
+  * data mapping, in the order in which they are given to its Block; the
+  * returned Subset is empty if the data mapping is opaque (see
+  * compile_data_mappings()). The positions are kept compressed, hence the
+  * Subset is built at each call. */
+
+ Subset get_scenario_positions( Index i ) {
+  update_layouts();
+  return layouts[ i ].from.decompress();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the current data of the inner Block handled by the data mappings
+ /** This function reads (by means of the registered Getter, see
+  * register_getter()) the current values of the data of the inner Block at
+  * all the positions handled by the data mappings, and returns them in a
+  * Snapshot which can later be given to restore_snapshot(). All the data
+  * mappings must be SimpleDataMapping with Subset or Range sets whose
+  * method has a registered Getter; otherwise, std::logic_error is thrown.
+  * Since no Block class of SMS++ registers a Getter yet, this is always the
+  * case unless the Block class of the inner Block (and of its sub-Blocks
+  * handled by the data mappings) does. From now on, the positions written
+  * by this StochasticBlock are tracked, so that restoring the returned
+  * Snapshot only writes them back (see restore_snapshot()). */
+
+ Snapshot take_snapshot();
+
+/*--------------------------------------------------------------------------*/
+
+ /// reads the current scenario out of the inner Block
+ /** This function is the inverse of set_data(): it reads (as take_snapshot()
+  * does) the current values of the data of the inner Block handled by the
+  * data mappings and writes each of them at its position in the scenario.
+  * The scenario is resized to the number of entries used by the data
+  * mappings; the entries which are not used by any data mapping are set to
+  * zero, and if an entry is used by more than one data mapping, then the
+  * value of the last one is taken. As for take_snapshot(), all the data
+  * mappings need a registered Getter (see register_getter()), which the
+  * Block classes of SMS++ do not provide yet; otherwise, std::logic_error
+  * is thrown.
+  *
+  * @param scenario The vector where the scenario is written. */
+
+ void get_current_data( std::vector< double > & scenario );
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether the deferred mode of set_data() is enabled
+
+ bool is_deferred_mode() const { return deferred_mode; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// tells whether the pending scenario has entries still to be flushed
+
+ bool has_pending_data() const { return pending; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the statistics (nullptr if they are not enabled)
+ /** Returns a pointer to the statistics collected so far, or nullptr if
+  * they are not enabled (see enable_statistics()). */
+
+ const Statistics * get_statistics() const { return statistics.get(); }
+
 /**@} ----------------------------------------------------------------------*/
 /*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
 /*--------------------------------------------------------------------------*/
 
 protected:
 
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED TYPES -------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the layout of a SimpleDataMappingBase
+ /** A DataMappingLayout describes which entries of the scenario are used by
+  * a SimpleDataMappingBase (the "from" set) and to which positions of the
+  * data of its Block they are written (the "to" set), as well as functions
+  * for writing (and possibly reading) any subset of these positions and
+  * for building a step of a compiled plan (see compile_data_mappings()).
+  * The two sets are stored as CompressedSubset, so that the (possibly
+  * millions of) indices of runs and strided patterns take little memory,
+  * and a Range one takes (almost) none at all. The remaining fields
+  * identify the Block method called by the SimpleDataMappingBase, so that
+  * the data mappings calling the same method can be merged. */
+
+ struct DataMappingLayout {
+  CompressedSubset from;    ///< the positions in the scenario
+  CompressedSubset to;      ///< the corresponding positions in the Block
+  Scatter scatter;          ///< writes any subset of the positions
+  StepBuilder build_step;   ///< builds a step for any ( from , to ) pair
+  Getter get;               ///< reads any subset of the positions
+  Block * block = nullptr;  ///< the Block of the SimpleDataMappingBase
+  std::string function_name;  ///< the name of the method of the Block
+  bool int_data = false;      ///< true if the data of the Block is int
+  bool range_target = false;  ///< true if the method takes a Range
+ };
+
+ /// the state of a lazy deserialization (see set_lazy_deserialization())
+ /** A LazyDeserialization holds the netCDF::NcGroup given to deserialize()
+  * out of which complete_deserialization() builds the inner Block and the
+  * data mappings, and makes sure that this is done exactly once even if
+  * complete_deserialization() is called by several threads. */
+
+ struct LazyDeserialization {
+  netCDF::NcGroup group;             ///< the group given to deserialize()
+  std::once_flag once;               ///< guards the completion
+  std::atomic< bool > done{ false }; ///< true once it has been completed
+ };
+
 /*--------------------------------------------------------------------------*/
 /*-------------------------- PROTECTED METHODS -----------------------------*/
 /*--------------------------------------------------------------------------*/
 
+ /// returns the number of entries of the scenario used by the data mappings
+ /** Returns the number of entries of the scenario used by the data
+  * mappings, throwing std::logic_error if some data mapping is opaque. */
+
+ Index get_scenario_dimension() {
+  update_layouts();
+  if( ! opaque_mappings.empty() )
+   throw( std::logic_error( "StochasticBlock: the scenario dimension of "
+                            "opaque data mappings is not known" ) );
+  return scenario_dimension;
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// writes data by calling write, grouping its Modification if required
+ /** Calls \p write( pmod , amod ), which writes some data into the inner
+  * Block issuing the Modification as described by pmod and amod. If the
+  * grouping is enabled (see set_group_modifications()), some Modification
+  * is asked for and someone is listening, a new channel is opened for the
+  * duration of the call, and pmod and amod are \p issuePMod and \p
+  * issueAMod moved to that channel; otherwise, they are just \p issuePMod
+  * and \p issueAMod. Nested calls use the channel of the outermost one. */
+
+ template< class Write >
+ void issue_grouped( c_ModParam issuePMod , c_ModParam issueAMod ,
+                     Write && write ) {
+  if( ( ! group_modifications ) || grouping ||
+      ( ( par2mod( issuePMod ) == eNoMod ) &&
+        ( par2mod( issueAMod ) == eNoMod ) ) || ( ! anyone_there() ) ) {
+   write( issuePMod , issueAMod );
+   return;
+   }
+
+  const auto father = par2chnl( issuePMod ) ? par2chnl( issuePMod ) :
+                                              par2chnl( issueAMod );
+  const auto chnl = open_channel( father );
+  grouping = true;
+  try {
+   write( make_par( par2mod( issuePMod ) , chnl ) ,
+          make_par( par2mod( issueAMod ) , chnl ) );
+   }
+  catch( ... ) {
+   grouping = false;
+   close_channel( chnl );
+   throw;
+   }
+  grouping = false;
+  close_channel( chnl );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// builds the inner Block and the data mappings out of the given group
+ /** Builds the inner Block and the data mappings out of the "Block" group
+  * and of the data mappings of the given netCDF::NcGroup (the one given to
+  * deserialize()). */
+
+ void deserialize_inner_block( const netCDF::NcGroup & group );
+
+/*--------------------------------------------------------------------------*/
+
+ /// builds the data mappings out of the given "DataMappings" group
+ /** Builds the data mappings out of the given "DataMappings" group (see
+  * serialize()), whose variables are read by the calling thread, while the
+  * data mappings are then built by deserialization_threads threads (see
+  * set_deserialization_threads()). */
+
+ void deserialize_data_mappings( const netCDF::NcGroup & group );
+
+/*--------------------------------------------------------------------------*/
+
+ /// writes the data mappings as the "DataMappings" group
+ /** Writes the data mappings into the "DataMappings" group of the given
+  * netCDF::NcGroup (see serialize()) and returns true, or writes nothing
+  * and returns false if some of them cannot be written in that format. */
+
+ bool serialize_data_mappings( netCDF::NcGroup & group ,
+                               Block * inner_block ) const;
+
+/*--------------------------------------------------------------------------*/
+
+ /// replaces the inner Block (see set_inner_block())
+ /** Does what set_inner_block() does, but without completing a lazy
+  * deserialization first, so that it can be called while completing it. */
+
+ void replace_inner_block( Block * block , bool destroy_previous_block ) {
+  if( ( ! v_Block.empty() ) && ( block == v_Block.front() ) &&
+      ( ! destroy_previous_block ) )
+   return; // the given Block is already here; silently return
+
+  reset_last_scenario();
+  discard_pending_data();
+  snapshot_id = 0;
+
+  if( destroy_previous_block && ( ! v_Block.empty() ) ) {
+   assert( v_Block.size() == 1 );
+   delete v_Block.front();
+  }
+
+  v_Block.clear();
+  v_Block.push_back( block );
+
+  if( block )
+   block->set_f_Block( this );
+
+ if( anyone_there() )
+  add_Modification( std::make_shared< NBModification >( this ) );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// (re)computes the layouts of the data mappings (and the plan), if needed
+
+ void update_layouts();
+
+/*--------------------------------------------------------------------------*/
+
+ /// builds the compiled plan out of the layouts of the data mappings
+
+ void build_plan();
+
+/*--------------------------------------------------------------------------*/
+
+ /// reads the current values of the i-th data mapping into values
+ /** Reads from the inner Block the current values at all the positions of
+  * the "to" set of the i-th data mapping, throwing std::logic_error if its
+  * layout or its Getter is not known. */
+
+ void gather( Index i , std::vector< double >::iterator values );
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the registered Getters, by method name and int-ness of the data
+
+ static std::map< std::pair< std::string , bool > , Getter > & get_getters();
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the data for all the non-opaque data mappings
+ /** Writes into the inner Block the given scenario for all the data
+  * mappings whose layout is known, either in delta mode (see
+  * set_data_delta()) or by means of the compiled plan, or records it as the
+  * pending scenario in deferred mode (see set_data_deferred()).
+  *
+  * @param data An iterator to the first element of a scenario having at
+  *        least scenario_dimension elements. */
+
+ void set_data_layouts( std::vector< double >::const_iterator data ,
+                        c_ModParam issuePMod , c_ModParam issueAMod ) {
+  if( deferred_mode )
+   set_data_deferred( data , issuePMod , issueAMod );
+  else if( delta_mode )
+   set_data_delta( data , issuePMod , issueAMod );
+  else if( statistics || snapshot_id )
+   set_data_plan( data , issuePMod , issueAMod );
+  else
+   for( auto & step : plan )
+    step( data , issuePMod , issueAMod );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// runs the compiled plan, collecting the statistics (if enabled)
+ /** Runs the steps of the compiled plan, collecting the statistics if they
+  * are enabled. If \p only_changed is true, only the steps involving at
+  * least one data mapping having a changed entry (see changed_mappings) are
+  * run. The data mappings of the steps run are tracked as written (see
+  * track_written()). */
+
+ void set_data_plan( std::vector< double >::const_iterator data ,
+                     c_ModParam issuePMod , c_ModParam issueAMod ,
+                     bool only_changed = false );
+
+/*--------------------------------------------------------------------------*/
+
+ /// records the given scenario as the pending one (see set_deferred_mode())
+
+ void set_data_deferred( std::vector< double >::const_iterator data ,
+                         c_ModParam issuePMod , c_ModParam issueAMod );
+
+/*--------------------------------------------------------------------------*/
+
+ /// calls set_data() of the i-th data mapping (collecting the statistics)
+
+ template< class Iterator >
+ void set_data_mapping( Index i , Iterator data , c_ModParam issuePMod ,
+                        c_ModParam issueAMod ) {
+  if( snapshot_id )
+   track_written( i );
+  if( ! statistics ) {
+   data_mappings[ i ]->set_data( data , issuePMod , issueAMod );
+   return;
+   }
+  const auto start = Statistics::Clock::now();
+  data_mappings[ i ]->set_data( data , issuePMod , issueAMod );
+  statistics->add( i , layouts[ i ].from.size() , start );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// starts tracking the positions written after the given Snapshot
+ /** Makes the Snapshot with the given id the one whose written positions are
+  * tracked (see restore_snapshot()), with none written so far. */
+
+ void start_tracking( std::size_t id );
+
+/*--------------------------------------------------------------------------*/
+
+ /// records that the i-th data mapping has been written in full
+ /** Records, for restore_snapshot(), that all the positions of the i-th data
+  * mapping have been written since the last Snapshot was taken (or
+  * restored). It must only be called if snapshot_id is not 0. */
+
+ void track_written( Index i ) {
+  written_in_full[ i ] = true;
+  Subset().swap( written_entries[ i ] );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// records that the k-th position of the i-th data mapping has been written
+ /** As track_written( i ), but only for the k-th position of the i-th data
+  * mapping (the k-th element of layouts[ i ].to). When the recorded positions
+  * (possibly repeated) become as many as those of the data mapping, the
+  * data mapping is recorded as written in full, so that the memory used is
+  * bounded. */
+
+ void track_written( Index i , Index k ) {
+  if( written_in_full[ i ] )
+   return;
+  written_entries[ i ].push_back( k );
+  if( written_entries[ i ].size() >= layouts[ i ].to.size() )
+   track_written( i );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// starts a call to set_data() when the statistics are enabled
+
+ void start_statistics() {
+  ++statistics->set_data_calls;
+  size_statistics();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// gives the counters of the statistics one entry per data mapping
+ /** Makes the counters of the statistics as many as the data mappings, as
+  * they may have been enabled or reset, or data mappings may have been
+  * added, since they were last used. */
+
+ void size_statistics() {
+  update_layouts();
+  statistics->elements.resize( data_mappings.size() , 0 );
+  statistics->time.resize( data_mappings.size() , 0 );
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the data in delta mode for all the non-opaque data mappings
+ /** Writes into the inner Block the entries of the given scenario that
+  * differ from those of the last scenario, for all the data mappings whose
+  * layout is known, and then records the given scenario as the last one.
+  * The "opaque" data mappings (those whose layout is not known) are not
+  * considered and must be handled by the caller.
+  *
+  * @param data An iterator to the first element of a scenario having at
+  *        least scenario_dimension elements. */
+
+ void set_data_delta( std::vector< double >::const_iterator data ,
+                      c_ModParam issuePMod , c_ModParam issueAMod );
+
 /*--------------------------------------------------------------------------*/
 /*---------------------------- PROTECTED FIELDS  ---------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -407,6 +1786,115 @@ protected:
  /// The vector of data mappings
  std::vector< std::unique_ptr< SimpleDataMappingBase > > data_mappings;
 
+ /// the ScenarioSet (if any)
+ std::unique_ptr< ScenarioSet > scenario_set;
+
+ /// the state of the lazy deserialization (nullptr if none)
+ std::unique_ptr< LazyDeserialization > lazy;
+
+ /// true if deserialize() does not build the inner Block and data mappings
+ static inline std::atomic< bool > lazy_deserialization{ false };
+
+ /// the number of threads building the deserialized data mappings (0: all)
+ static inline std::atomic< Index > deserialization_threads{ 1 };
+
+ /// true if serialize() writes the "DataMappings" group, when it can
+ static inline std::atomic< bool > write_data_mappings_group{ false };
+
+ /// the ScenarioGenerator (if any)
+ std::unique_ptr< ScenarioGenerator > scenario_generator;
+
+ /// the last scenario generated by set_random_data()
+ std::vector< double > random_scenario;
+
+ /// the WarmStartCache (if any)
+ std::unique_ptr< WarmStartCache > warm_start_cache;
+
+ /// true if set_data() only writes the entries that have changed
+ bool delta_mode = false;
+
+ /// true if set_data() uses the compiled plan
+ bool compiled = false;
+
+ /// the compiled plan (if compiled is true)
+ std::vector< ScatterStep > plan;
+
+ /// the data mappings merged into each step of the compiled plan
+ std::vector< Subset > plan_mappings;
+
+ /// true if the layouts of the data mappings are up to date
+ bool layouts_valid = false;
+
+ /// the layouts of the data mappings (empty for the opaque ones)
+ std::vector< DataMappingLayout > layouts;
+
+ /// the indices of the data mappings whose layout is not known
+ std::vector< Index > opaque_mappings;
+
+ /// the number of entries of a scenario used by the data mappings
+ Index scenario_dimension = 0;
+
+ /// the last scenario passed to set_data() in delta mode (if any)
+ std::vector< double > last_scenario;
+
+ /// buffer for the scenario in delta mode
+ std::vector< double > scenario_buffer;
+
+ /// buffers for the changed entries in delta mode
+ std::vector< double > changed_values;
+ Subset changed_positions;
+
+ /// the id of the Snapshot whose written positions are tracked (0 if none)
+ std::size_t snapshot_id = 0;
+
+ /// the data mappings written in full since that Snapshot
+ std::vector< bool > written_in_full;
+
+ /// the (possibly repeated) positions in the "to" set of each data mapping
+ /// written since that Snapshot, unless it was written in full
+ std::vector< Subset > written_entries;
+
+ /// the statistics (if they are enabled)
+ std::unique_ptr< Statistics > statistics;
+
+ /// true if set_data() only records the pending scenario
+ bool deferred_mode = false;
+
+ /// true if some entry of the pending scenario is still to be flushed
+ bool pending = false;
+
+ /// the pending scenario of the deferred mode (if any)
+ std::vector< double > pending_scenario;
+
+ /// the entries of the pending scenario still to be flushed
+ std::vector< bool > changed_entries;
+
+ /// the data mappings having some changed entry (used by flush_data())
+ std::vector< bool > changed_mappings;
+
+ /// the parameters for the Modification issued by flush_data()
+ ModParam pending_pmod = eNoBlck;
+ ModParam pending_amod = eNoBlck;
+
+ /// true if the Modification of each set_data() are grouped
+ bool group_modifications = false;
+
+ /// true while the Modification are being grouped into a channel
+ bool grouping = false;
+
+ /// for each entry k of the scenario, the pairs ( data mapping , position
+ /// in its "from" set ) using it are entry_users[ entry_start[ k ] ], ...,
+ /// entry_users[ entry_start[ k + 1 ] - 1 ] (built by write_data_entries()),
+ /// and the positions in their Block are the same elements of entry_targets
+ std::vector< Index > entry_start;
+ std::vector< std::pair< Index , Index > > entry_users;
+ Subset entry_targets;
+
+ /// the values and the positions of the inner Block written by
+ /// write_data_entries() for each data mapping
+ std::vector< std::vector< double > > entry_values;
+ std::vector< Subset > entry_positions;
+
 /*--------------------------------------------------------------------------*/
 /*--------------------- PRIVATE PART OF THE CLASS --------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -0,0 +1,307 @@
+/*--------------------------------------------------------------------------*/
+/*------------------------ File WarmStartCache.h ---------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Header file for the WarmStartCache class, which keeps the Solution of
+ * (a bounded number of) scenarios, so that the Solution of the same or of a
+ * nearby scenario can be used to warm start the solution of a new one.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __WarmStartCache
+#define __WarmStartCache
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "Block.h"
+#include "Solution.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <list>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------- CLASSES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @defgroup WarmStartCache_CLASSES Classes in WarmStartCache.h
+ *  @{ */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------ CLASS WarmStartCache ----------------------------*/
+/*--------------------------------------------------------------------------*/
+/*--------------------------- GENERAL NOTES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+/// a bounded cache of the Solution of the scenarios
+/** The WarmStartCache class keeps a Solution (say, of the inner Block of a
+ * StochasticBlock, see StochasticBlock::store_solution()) for each one of a
+ * bounded number of scenarios. Given a new scenario, find() returns the
+ * Solution of the same scenario, if it is in the cache, or otherwise that
+ * of the closest scenario in the cache (in the Euclidean norm), provided it
+ * is close enough (see set_max_distance()). The Solution can then be
+ * written into the Block (see StochasticBlock::warm_start()) so that the
+ * Solver starts from it rather than from scratch.
+ *
+ * The scenarios are identified by a 64-bit fingerprint of their content
+ * (see fingerprint()), which makes looking for the same scenario cost
+ * O( 1 ) plus one comparison of the scenarios (two different scenarios
+ * having the same fingerprint are correctly told apart). Looking for the
+ * closest scenario costs O( size() * dimension ) in the worst case, which
+ * is why the cache is bounded: when more than get_capacity() scenarios are
+ * stored, the least recently used one (stored or returned by find()) is
+ * evicted, so that the memory used by a long run stays bounded.
+ *
+ * A WarmStartCache is not thread-safe: each worker of a ScenarioEvaluator
+ * should have its own one. */
+
+class WarmStartCache
+{
+/*--------------------------------------------------------------------------*/
+/*----------------------- PUBLIC PART OF THE CLASS -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+public:
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PUBLIC TYPES --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ using Index = Block::Index;
+
+/*--------------------------------------------------------------------------*/
+/*-------------- CONSTRUCTING AND DESTRUCTING WarmStartCache ---------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Constructing and destructing WarmStartCache
+ *  @{ */
+
+ /// constructor
+ /** Constructs an empty WarmStartCache able to hold the given number of
+  * scenarios.
+  *
+  * @param capacity The maximum number of scenarios in the cache (at least
+  *        1). */
+
+ explicit WarmStartCache( Index capacity = 64 )
+  : capacity( std::max( capacity , Index( 1 ) ) ) {}
+
+/*--------------------------------------------------------------------------*/
+ /// destructor of WarmStartCache
+
+ virtual ~WarmStartCache() = default;
+
+/** @} ---------------------------------------------------------------------*/
+/*----------------------- METHODS FOR SETTING PARAMETERS -------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for setting the parameters
+ *  @{ */
+
+ /// sets the maximum number of scenarios in the cache
+ /** Sets the maximum number of scenarios in the cache (at least 1); if the
+  * cache currently holds more scenarios, the least recently used ones are
+  * evicted. */
+
+ void set_capacity( Index capacity );
+
+/*--------------------------------------------------------------------------*/
+
+ /// sets the maximum distance of the closest scenario returned by find()
+ /** Sets the maximum (Euclidean) distance between a scenario and the
+  * closest scenario in the cache for the Solution of the latter to be
+  * returned by find(). The default is +infinity, i.e., the closest
+  * scenario is always returned; with 0, only the same scenario is. */
+
+ void set_max_distance( double max_distance ) {
+  this->max_distance = max_distance;
+ }
+
+/** @} ---------------------------------------------------------------------*/
+/*------------------ METHODS FOR STORING AND FINDING Solution --------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for storing and finding Solution
+ *  @{ */
+
+ /// stores the Solution of the given scenario
+ /** Stores the given Solution for the given scenario, which becomes the
+  * most recently used one. If the scenario is already in the cache, its
+  * Solution is replaced; otherwise, if the cache is full, the least
+  * recently used scenario is evicted.
+  *
+  * @param scenario An iterator to the first element of the scenario.
+  *
+  * @param dimension The number of elements of the scenario.
+  *
+  * @param solution The Solution of the scenario. */
+
+ void store( std::vector< double >::const_iterator scenario ,
+             Index dimension , std::unique_ptr< Solution > solution );
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the Solution of the same or of the closest scenario
+ /** Returns the Solution of the given scenario, if it is in the cache, or
+  * otherwise that of the closest scenario (of the same dimension) in the
+  * cache, provided that its distance is not larger than the one given to
+  * set_max_distance(). The scenario whose Solution is returned becomes the
+  * most recently used one. If no such scenario exists, nullptr is returned.
+  * The returned Solution belongs to the cache, and it remains valid until
+  * the scenario is evicted or its Solution replaced.
+  *
+  * @param scenario An iterator to the first element of the scenario.
+  *
+  * @param dimension The number of elements of the scenario.
+  *
+  * @param exact If not nullptr, on return it tells whether the Solution
+  *        is the one of the given scenario.
+  *
+  * @return The Solution, or nullptr if none is found. */
+
+ Solution * find( std::vector< double >::const_iterator scenario ,
+                  Index dimension , bool * exact = nullptr );
+
+/*--------------------------------------------------------------------------*/
+
+ /// removes all the scenarios from the cache
+
+ void clear() {
+  entries.clear();
+  fingerprints.clear();
+ }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the fingerprint of the given scenario
+ /** Returns a 64-bit hash of the content of the given scenario; equal
+  * scenarios (where 0 and -0 are considered equal) have the same
+  * fingerprint. */
+
+ static std::uint64_t fingerprint(
+  std::vector< double >::const_iterator scenario , Index dimension );
+
+/** @} ---------------------------------------------------------------------*/
+/*-------------------- METHODS FOR READING THE DATA ------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @name Methods for reading the data
+ *  @{ */
+
+ /// returns the number of scenarios in the cache
+
+ Index size() const { return entries.size(); }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the maximum number of scenarios in the cache
+
+ Index get_capacity() const { return capacity; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of calls to find() which found the same scenario
+
+ std::size_t get_exact_hits() const { return exact_hits; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of calls to find() which found a close scenario
+
+ std::size_t get_nearest_hits() const { return nearest_hits; }
+
+/*--------------------------------------------------------------------------*/
+
+ /// returns the number of calls to find() which found nothing
+
+ std::size_t get_misses() const { return misses; }
+
+/** @} ---------------------------------------------------------------------*/
+/*--------------------- PROTECTED PART OF THE CLASS ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+protected:
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED TYPES -------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// a scenario in the cache, with its fingerprint and Solution
+ struct Entry {
+  std::uint64_t fingerprint;
+  std::vector< double > scenario;
+  std::unique_ptr< Solution > solution;
+ };
+
+ using EntryIterator = std::list< Entry >::iterator;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- PROTECTED METHODS -----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// returns the Entry of the given scenario (entries.end() if none)
+
+ EntryIterator find_exact( std::vector< double >::const_iterator scenario ,
+                           Index dimension , std::uint64_t fingerprint );
+
+/*--------------------------------------------------------------------------*/
+
+ /// evicts the least recently used scenarios beyond the capacity
+
+ void evict();
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------- PROTECTED FIELDS  ---------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ /// the scenarios in the cache, from the most to the least recently used
+ std::list< Entry > entries;
+
+ /// the scenarios in the cache, by fingerprint
+ std::unordered_multimap< std::uint64_t , EntryIterator > fingerprints;
+
+ /// the maximum number of scenarios in the cache
+ Index capacity;
+
+ /// the maximum distance of the closest scenario returned by find()
+ double max_distance = std::numeric_limits< double >::infinity();
+
+ /// the counters of the outcomes of find()
+ std::size_t exact_hits = 0;
+ std::size_t nearest_hits = 0;
+ std::size_t misses = 0;
+
+/*--------------------------------------------------------------------------*/
+
+};   // end( class WarmStartCache )
+
+/** @} end( group( WarmStartCache_CLASSES ) ) */
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* WarmStartCache.h included */
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- End File WarmStartCache.h -------------------------*/
+/*--------------------------------------------------------------------------*/
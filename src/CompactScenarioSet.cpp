@@ -0,0 +1,202 @@
+/*--------------------------------------------------------------------------*/
+/*---------------------- File CompactScenarioSet.cpp -----------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the CompactScenarioSet class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "CompactScenarioSet.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = CompactScenarioSet::Index;
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------- LOCAL DEFINITIONS ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+namespace {
+
+/// the largest quantized value
+const double max_quantized = std::numeric_limits< std::uint16_t >::max();
+
+}  // end( anonymous namespace )
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- METHODS of CompactScenarioSet -----------------------*/
+/*--------------------------------------------------------------------------*/
+
+CompactScenarioSet::CompactScenarioSet( Index dimension ,
+                                        Precision precision )
+ : dimension( dimension ) , precision( precision ) {
+ if( precision == eQuantized ) {
+  offset.assign( dimension , 0 );
+  scale.assign( dimension , 1 );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+CompactScenarioSet::CompactScenarioSet( const ScenarioSet & scenarios ,
+                                        Precision precision )
+ : CompactScenarioSet( scenarios.get_dimension() , precision ) {
+ if( precision == eQuantized )
+  set_quantization( scenarios );
+ data.reserve( std::size_t( dimension ) * scenarios.size() *
+               element_size( precision ) );
+ for( Index i = 0 ; i < scenarios.size() ; ++i )
+  add_scenario( dimension ? & *scenarios.get_scenario( i ) : nullptr );
+ probabilities = scenarios.get_probabilities();
+}
+
+/*--------------------------------------------------------------------------*/
+
+void CompactScenarioSet::set_quantization( std::vector< double > && offset ,
+                                           std::vector< double > && scale ) {
+ if( number > 0 )
+  throw( std::logic_error( "CompactScenarioSet::set_quantization: the set "
+                           "is not empty" ) );
+ if( ( offset.size() != dimension ) || ( scale.size() != dimension ) )
+  throw( std::invalid_argument( "CompactScenarioSet::set_quantization: "
+                                "wrong size" ) );
+ this->offset = std::move( offset );
+ this->scale = std::move( scale );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void CompactScenarioSet::set_quantization( const ScenarioSet & scenarios ) {
+ if( scenarios.get_dimension() != dimension )
+  throw( std::invalid_argument( "CompactScenarioSet::set_quantization: "
+                                "wrong dimension" ) );
+
+ std::vector< double > offset( dimension , 0 );
+ std::vector< double > scale( dimension , 1 );
+ for( Index k = 0 ; k < dimension ; ++k ) {
+  double min = std::numeric_limits< double >::infinity();
+  double max = - min;
+  bool integer = true;
+  for( Index i = 0 ; i < scenarios.size() ; ++i ) {
+   const double value = scenarios.get_scenario( i )[ k ];
+   min = std::min( min , value );
+   max = std::max( max , value );
+   integer = integer && ( value == std::round( value ) );
+   }
+  if( scenarios.size() == 0 )
+   continue;
+  offset[ k ] = min;
+  if( ( ! integer ) || ( max - min > max_quantized ) )
+   scale[ k ] = max > min ? ( max - min ) / max_quantized : 1;
+  }
+
+ set_quantization( std::move( offset ) , std::move( scale ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void CompactScenarioSet::add_scenario( const double * scenario ,
+                                       double probability ) {
+ const auto start = data.size();
+ data.resize( start + std::size_t( dimension ) * element_size( precision ) );
+ auto values = data.data() + start;
+
+ switch( precision ) {
+  case( eDouble ):
+   if( dimension > 0 )  // the pointers may be null if there is nothing
+    std::memcpy( values , scenario , dimension * sizeof( double ) );
+   break;
+  case( eFloat ): {
+   auto floats = reinterpret_cast< float * >( values );
+   for( Index k = 0 ; k < dimension ; ++k )
+    floats[ k ] = scenario[ k ];
+   break;
+   }
+  case( eQuantized ): {
+   auto quantized = reinterpret_cast< std::uint16_t * >( values );
+   for( Index k = 0 ; k < dimension ; ++k ) {
+    const double q = scale[ k ] == 0 ? 0 :
+                     std::round( ( scenario[ k ] - offset[ k ] ) / scale[ k ] );
+    quantized[ k ] = std::uint16_t( std::clamp( q , 0.0 , max_quantized ) );
+    }
+   }
+  }
+
+ if( ( probability >= 0 ) && probabilities.empty() ) {
+  probabilities.assign( number , 1.0 / std::max( number , Index( 1 ) ) );
+  probabilities.push_back( probability );
+  }
+ else if( ! probabilities.empty() )
+  probabilities.push_back( std::max( probability , 0.0 ) );
+ ++number;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void CompactScenarioSet::set_probabilities( std::vector< double > &&
+                                            probabilities ) {
+ if( ( ! probabilities.empty() ) && ( probabilities.size() != number ) )
+  throw( std::invalid_argument( "CompactScenarioSet::set_probabilities: "
+                                "wrong number of probabilities" ) );
+ this->probabilities = std::move( probabilities );
+}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioSet CompactScenarioSet::get_scenario_set() const {
+ ScenarioSet scenario_set( dimension , number );
+ for( Index i = 0 ; ( i < number ) && ( dimension > 0 ) ; ++i )
+  get_scenario( i , & *scenario_set.get_scenario( i ) );
+ if( ! probabilities.empty() )
+  scenario_set.set_probabilities( std::vector< double >( probabilities ) );
+ return scenario_set;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void CompactScenarioSet::decode( Precision precision , const void * values ,
+                                 Index dimension , const double * offset ,
+                                 const double * scale , double * scenario ) {
+ // one loop per precision, so that each one can be vectorized
+ switch( precision ) {
+  case( eDouble ):
+   if( dimension > 0 )  // the pointers may be null if there is nothing
+    std::memcpy( scenario , values , dimension * sizeof( double ) );
+   break;
+  case( eFloat ): {
+   auto floats = static_cast< const float * >( values );
+   for( Index k = 0 ; k < dimension ; ++k )
+    scenario[ k ] = floats[ k ];
+   break;
+   }
+  case( eQuantized ): {
+   auto quantized = static_cast< const std::uint16_t * >( values );
+   for( Index k = 0 ; k < dimension ; ++k )
+    scenario[ k ] = offset[ k ] + scale[ k ] * quantized[ k ];
+   }
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File CompactScenarioSet.cpp ---------------------*/
+/*--------------------------------------------------------------------------*/
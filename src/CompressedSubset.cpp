@@ -0,0 +1,213 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File CompressedSubset.cpp ------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the CompressedSubset class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "CompressedSubset.h"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = CompressedSubset::Index;
+using Subset = CompressedSubset::Subset;
+
+/*--------------------------------------------------------------------------*/
+/*--------------------- METHODS of CompressedSubset ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+CompressedSubset::CompressedSubset( const Subset & elements )
+ : number( elements.size() ) {
+ const Index n = elements.size();
+
+ auto add_literal = [ & ]( Index element ) {
+  if( segments.empty() || ( ! segments.back().is_literal() ) )
+   segments.push_back( { Index( literals.size() ) , 0 , Segment::literal } );
+  literals.push_back( element );
+  ++segments.back().length;
+ };
+
+ for( Index k = 0 ; k < n ; ) {
+  // the longest progression starting at k
+  Index h = k + 1;
+  if( h < n ) {
+   const auto stride = std::int64_t( elements[ h ] ) -
+                       std::int64_t( elements[ k ] );
+   while( ( h + 1 < n ) && ( std::int64_t( elements[ h + 1 ] ) -
+                             std::int64_t( elements[ h ] ) == stride ) )
+    ++h;
+   if( h + 1 - k >= min_length ) {
+    segments.push_back( { elements[ k ] , h + 1 - k , stride } );
+    k = h + 1;
+    continue;
+    }
+   }
+  add_literal( elements[ k++ ] );
+  }
+
+ segments.shrink_to_fit();
+ literals.shrink_to_fit();
+}
+
+/*--------------------------------------------------------------------------*/
+
+CompressedSubset::CompressedSubset( const Range & range )
+ : number( range.second > range.first ? range.second - range.first : 0 ) {
+ if( number > 0 )
+  segments.push_back( { range.first , number , 1 } );
+}
+
+/*--------------------------------------------------------------------------*/
+
+bool CompressedSubset::is_sorted() const {
+ Index previous = 0;
+ for( const auto & segment : segments ) {
+  if( segment.is_literal() ) {
+   const auto first = literals.begin() + segment.first;
+   if( ( first[ 0 ] < previous ) ||
+       ( ! std::is_sorted( first , first + segment.length ) ) )
+    return false;
+   previous = first[ segment.length - 1 ];
+   }
+  else {
+   if( ( segment.first < previous ) || ( segment.stride < 0 ) )
+    return false;
+   previous = segment[ segment.length - 1 ];
+   }
+  }
+ return true;
+}
+
+/*--------------------------------------------------------------------------*/
+
+Index CompressedSubset::max() const {
+ Index result = 0;
+ for( const auto & segment : segments )
+  if( segment.is_literal() ) {
+   const auto first = literals.begin() + segment.first;
+   result = std::max( result , *std::max_element( first ,
+                                                  first + segment.length ) );
+   }
+  else
+   result = std::max( { result , segment.first ,
+                        segment[ segment.length - 1 ] } );
+ return result;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void CompressedSubset::decompress( Index * elements ) const {
+ for( const auto & segment : segments ) {
+  if( segment.is_literal() )
+   std::copy_n( literals.begin() + segment.first , segment.length ,
+                elements );
+  else if( segment.stride == 1 )
+   std::iota( elements , elements + segment.length , segment.first );
+  else {
+   // unsigned arithmetic wraps around, so that negative strides work too
+   const auto stride = Index( segment.stride );
+   auto element = segment.first;
+   for( Index k = 0 ; k < segment.length ; ++k , element += stride )
+    elements[ k ] = element;
+   }
+  elements += segment.length;
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void CompressedSubset::translate( Subset & positions ) const {
+ auto segment = segments.begin();
+ Index start = 0;  // the position of the first index of segment
+ for( auto & position : positions ) {
+  while( position >= start + segment->length )
+   start += ( segment++ )->length;
+  const auto k = position - start;
+  position = segment->is_literal() ? literals[ segment->first + k ] :
+                                     ( *segment )[ k ];
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+std::size_t CompressedSubset::encoded_size() const {
+ std::size_t size = 0;
+ for( const auto & segment : segments )
+  size += segment.is_literal() ? 1 + segment.length : 3;
+ return size;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void CompressedSubset::encode( Subset & words ) const {
+ words.reserve( words.size() + encoded_size() );
+ for( const auto & segment : segments ) {
+  if( segment.length >= literal_flag )
+   throw( std::length_error( "CompressedSubset::encode: too long segment" ) );
+  if( segment.is_literal() ) {
+   words.push_back( segment.length | literal_flag );
+   words.insert( words.end() , literals.begin() + segment.first ,
+                 literals.begin() + segment.first + segment.length );
+   }
+  else {
+   words.push_back( segment.length );
+   words.push_back( segment.first );
+   words.push_back( Index( segment.stride ) );
+   }
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+Subset CompressedSubset::decode( Subset::const_iterator words ,
+                                 Index number_words ) {
+ Subset elements;
+ const auto end = words + number_words;
+ while( words != end ) {
+  const auto length = *words & ~literal_flag;
+  const bool literal = *words++ & literal_flag;
+  if( length == 0 )
+   throw( std::invalid_argument( "CompressedSubset::decode: empty segment" ) );
+  if( literal ) {
+   if( Index( end - words ) < length )
+    throw( std::invalid_argument( "CompressedSubset::decode: truncated "
+                                  "literal segment" ) );
+   elements.insert( elements.end() , words , words + length );
+   words += length;
+   }
+  else {
+   if( end - words < 2 )
+    throw( std::invalid_argument( "CompressedSubset::decode: truncated "
+                                  "progression" ) );
+   // unsigned arithmetic wraps around, so that negative strides work too
+   auto element = *words++;
+   const auto stride = *words++;
+   for( Index k = 0 ; k < length ; ++k , element += stride )
+    elements.push_back( element );
+   }
+  }
+ return elements;
+}
+
+/*--------------------------------------------------------------------------*/
+/*--------------------- End File CompressedSubset.cpp ----------------------*/
+/*--------------------------------------------------------------------------*/
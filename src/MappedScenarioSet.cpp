@@ -0,0 +1,406 @@
+/*--------------------------------------------------------------------------*/
+/*---------------------- File MappedScenarioSet.cpp ------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the MappedScenarioSet class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "MappedScenarioSet.h"
+#include "StochasticBlock.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#if __has_include( <sys/mman.h> )
+#define MAPPED_SCENARIO_SET_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#define MAPPED_SCENARIO_SET_MMAP 0
+#endif
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = MappedScenarioSet::Index;
+using Subset = MappedScenarioSet::Subset;
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------- LOCAL DEFINITIONS ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+namespace {
+
+/// the header of the file
+struct FileHeader {
+ char magic[ 8 ];
+ std::uint32_t version;
+ std::uint32_t byte_order;
+ std::uint64_t dimension;
+ std::uint64_t number;
+ std::uint64_t number_mappings;
+ std::uint64_t probabilities_offset;
+ std::uint64_t positions_offset;
+ std::uint64_t scenarios_offset;
+ std::uint64_t precision;
+ std::uint64_t quantization_offset;
+};
+
+static_assert( sizeof( FileHeader ) == 80 );
+
+const char magic[ 8 ] = { 'S' , 'M' , 'S' , 'P' , 'P' , 'S' , 'C' , 'N' };
+
+/// the version of the format; version 1 had a 64-byte header, without the
+/// precision and the quantization offset, and it is no longer read
+const std::uint32_t version = 2;
+
+const std::uint32_t byte_order = 0x01020304;
+
+/// the alignment (in bytes) of each section of the file
+const std::uint64_t alignment = 64;
+
+std::uint64_t align( std::uint64_t offset ) {
+ return ( offset + alignment - 1 ) / alignment * alignment;
+}
+
+/// writes the given bytes, padded up to the given offset
+
+void write_section( std::ofstream & output , const void * bytes ,
+                    std::uint64_t size , std::uint64_t & offset ) {
+ output.write( static_cast< const char * >( bytes ) , size );
+ const auto end = align( offset + size );
+ static const char zeros[ alignment ] = {};
+ output.write( zeros , end - offset - size );
+ offset = end;
+}
+
+}  // end( anonymous namespace )
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- METHODS of MappedScenarioSet ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+MappedScenarioSet::MappedScenarioSet( const std::string & filename ) {
+#if MAPPED_SCENARIO_SET_MMAP
+ const int descriptor = ::open( filename.c_str() , O_RDONLY );
+ if( descriptor < 0 )
+  throw( std::runtime_error( "MappedScenarioSet: cannot open " + filename ) );
+ struct stat status;
+ if( ::fstat( descriptor , & status ) != 0 ) {
+  ::close( descriptor );
+  throw( std::runtime_error( "MappedScenarioSet: cannot stat " + filename ) );
+  }
+ file_size = status.st_size;
+ if( file_size > 0 ) {
+  void * address = ::mmap( nullptr , file_size , PROT_READ , MAP_PRIVATE ,
+                           descriptor , 0 );
+  if( address == MAP_FAILED ) {
+   ::close( descriptor );
+   throw( std::runtime_error( "MappedScenarioSet: cannot map " + filename ) );
+   }
+  file = static_cast< const char * >( address );
+  }
+ ::close( descriptor );  // the mapping outlives the descriptor
+#else
+ std::ifstream input( filename , std::ios::binary | std::ios::ate );
+ if( ! input )
+  throw( std::runtime_error( "MappedScenarioSet: cannot open " + filename ) );
+ file_size = input.tellg();
+ buffer.resize( file_size );
+ input.seekg( 0 );
+ if( ! input.read( buffer.data() , file_size ) )
+  throw( std::runtime_error( "MappedScenarioSet: cannot read " + filename ) );
+ file = buffer.data();
+#endif
+
+ // check the header and the sections (unmapping the file if they are wrong)
+ try {
+  FileHeader header;
+  if( file_size < sizeof( header ) )
+   throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                 " is too short" ) );
+  std::memcpy( & header , file , sizeof( header ) );
+  if( std::memcmp( header.magic , magic , sizeof( magic ) ) != 0 )
+   throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                 " is not a scenario file" ) );
+  if( header.version == 1 )
+   throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                 " has the 64-byte header of version 1,"
+                                 " write it again" ) );
+  if( header.version != version )
+   throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                 " has an unsupported version" ) );
+  if( header.byte_order != byte_order )
+   throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                 " has a different byte order" ) );
+
+  auto section = [ & ]( std::uint64_t offset , std::uint64_t size ) {
+   if( ( offset % alignment != 0 ) || ( offset > file_size ) ||
+       ( size > file_size - offset ) )
+    throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                  " is corrupted" ) );
+   return file + offset;
+  };
+
+  // the product of sizes read from the file, which must not overflow
+  auto product = [ & ]( std::uint64_t a , std::uint64_t b ) {
+   if( b && ( a > std::numeric_limits< std::uint64_t >::max() / b ) )
+    throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                  " is corrupted" ) );
+   return a * b;
+  };
+
+  dimension = header.dimension;
+  number = header.number;
+  if( ( dimension != header.dimension ) || ( number != header.number ) )
+   throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                 " has too many scenarios" ) );
+
+  if( header.precision > CompactScenarioSet::eQuantized )
+   throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                 " has an unknown precision" ) );
+  precision = Precision( header.precision );
+
+  const auto element_size = CompactScenarioSet::element_size( precision );
+  scenarios = section( header.scenarios_offset ,
+                       product( product( header.dimension , header.number ) ,
+                                element_size ) );
+
+  if( precision == CompactScenarioSet::eQuantized ) {
+   quantization = reinterpret_cast< const double * >(
+    section( header.quantization_offset ,
+             product( header.dimension , 2 * sizeof( double ) ) ) );
+   if( ! header.quantization_offset )
+    throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                  " has no quantization" ) );
+   }
+
+  if( header.probabilities_offset )
+   probabilities = reinterpret_cast< const double * >(
+    section( header.probabilities_offset ,
+             product( header.number , sizeof( double ) ) ) );
+
+  if( header.positions_offset ) {
+   const auto sizes_size = product( header.number_mappings ,
+                                    sizeof( std::uint64_t ) );
+   auto sizes = reinterpret_cast< const std::uint64_t * >(
+    section( header.positions_offset , sizes_size ) );
+   mapping_sizes.assign( sizes , sizes + header.number_mappings );
+   std::uint64_t total = 0;
+   for( auto size : mapping_sizes ) {
+    if( size > std::numeric_limits< std::uint64_t >::max() - total )
+     throw( std::invalid_argument( "MappedScenarioSet: " + filename +
+                                   " is corrupted" ) );
+    total += size;
+    }
+   // the sizes lie inside the file, so this sum cannot overflow
+   positions = reinterpret_cast< const std::uint32_t * >(
+    section( align( header.positions_offset + sizes_size ) ,
+             product( total , sizeof( std::uint32_t ) ) ) );
+   }
+  }
+ catch( ... ) {
+#if MAPPED_SCENARIO_SET_MMAP
+  if( file )
+   ::munmap( const_cast< char * >( file ) , file_size );
+#endif
+  throw;
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+MappedScenarioSet::~MappedScenarioSet() {
+#if MAPPED_SCENARIO_SET_MMAP
+ if( file )
+  ::munmap( const_cast< char * >( file ) , file_size );
+#endif
+}
+
+/*--------------------------------------------------------------------------*/
+
+Subset MappedScenarioSet::get_scenario_positions( Index i ) const {
+ std::size_t start = 0;
+ for( Index m = 0 ; m < i ; ++m )
+  start += mapping_sizes[ m ];
+ return Subset( positions + start , positions + start + mapping_sizes[ i ] );
+}
+
+/*--------------------------------------------------------------------------*/
+
+bool MappedScenarioSet::matches( StochasticBlock & block ) const {
+ if( ! positions )
+  return true;
+
+ const auto & data_mappings = block.get_data_mappings();
+ if( data_mappings.size() != mapping_sizes.size() )
+  return false;
+
+ const std::uint32_t * current = positions;
+ for( Index i = 0 ; i < mapping_sizes.size() ; ++i ) {
+  const auto & from = block.get_scenario_positions( i );
+  if( ( from.size() != mapping_sizes[ i ] ) ||
+      ( ! std::equal( from.begin() , from.end() , current ) ) )
+   return false;
+  current += mapping_sizes[ i ];
+  }
+ return true;
+}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioSet MappedScenarioSet::get_scenario_set() const {
+ ScenarioSet scenario_set( dimension , number );
+ for( Index i = 0 ; ( i < number ) && ( dimension > 0 ) ; ++i )
+  get_scenario( i , & *scenario_set.get_scenario( i ) );
+ if( probabilities )
+  scenario_set.set_probabilities(
+   std::vector< double >( probabilities , probabilities + number ) );
+ return scenario_set;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void MappedScenarioSet::write( const std::string & filename ,
+                               const ScenarioSet & scenarios ,
+                               StochasticBlock * block ,
+                               Precision precision ) {
+ if( precision != CompactScenarioSet::eDouble ) {
+  write( filename , CompactScenarioSet( scenarios , precision ) , block );
+  return;
+  }
+
+ // the scenarios are contiguous in the ScenarioSet
+ const std::uint64_t data_size = std::uint64_t( scenarios.get_dimension() ) *
+                                 scenarios.size() * sizeof( double );
+ write_file( filename , scenarios.get_dimension() , scenarios.size() ,
+             precision , data_size ? & *scenarios.get_scenario( 0 ) : nullptr ,
+             data_size , scenarios.get_probabilities() , {} , {} , block );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void MappedScenarioSet::write( const std::string & filename ,
+                               const CompactScenarioSet & scenarios ,
+                               StochasticBlock * block ) {
+ write_file( filename , scenarios.get_dimension() , scenarios.size() ,
+             scenarios.get_precision() , scenarios.get_data() ,
+             scenarios.get_data_size() , scenarios.get_probabilities() ,
+             scenarios.get_offset() , scenarios.get_scale() , block );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void MappedScenarioSet::write_file( const std::string & filename ,
+                                    Index dimension , Index number ,
+                                    Precision precision , const void * data ,
+                                    std::size_t data_size ,
+                                    const std::vector< double > &
+                                    probabilities ,
+                                    const std::vector< double > & q_offset ,
+                                    const std::vector< double > & q_scale ,
+                                    StochasticBlock * block ) {
+ // the layout of the data mappings: the sizes, followed by the positions
+ std::vector< std::uint64_t > sizes;
+ std::vector< std::uint32_t > all_positions;
+ if( block ) {
+  const auto number_mappings = block->get_data_mappings().size();
+  sizes.reserve( number_mappings );
+  for( Index i = 0 ; i < number_mappings ; ++i ) {
+   const auto & from = block->get_scenario_positions( i );
+   sizes.push_back( from.size() );
+   all_positions.insert( all_positions.end() , from.begin() , from.end() );
+   }
+  }
+
+ const bool quantized = precision == CompactScenarioSet::eQuantized;
+
+ FileHeader header = {};
+ std::memcpy( header.magic , magic , sizeof( magic ) );
+ header.version = version;
+ header.byte_order = byte_order;
+ header.dimension = dimension;
+ header.number = number;
+ header.number_mappings = sizes.size();
+ header.precision = precision;
+
+ std::uint64_t offset = align( sizeof( header ) );
+ if( ! probabilities.empty() ) {
+  header.probabilities_offset = offset;
+  offset = align( offset + probabilities.size() * sizeof( double ) );
+  }
+ if( block ) {
+  header.positions_offset = offset;
+  offset = align( offset + sizes.size() * sizeof( std::uint64_t ) );
+  offset = align( offset + all_positions.size() * sizeof( std::uint32_t ) );
+  }
+ if( quantized ) {
+  header.quantization_offset = offset;
+  offset = align( offset + 2 * std::uint64_t( dimension ) * sizeof( double ) );
+  }
+ header.scenarios_offset = offset;
+
+ std::ofstream output( filename , std::ios::binary | std::ios::trunc );
+ if( ! output )
+  throw( std::runtime_error( "MappedScenarioSet::write: cannot open " +
+                             filename ) );
+
+ offset = 0;
+ write_section( output , & header , sizeof( header ) , offset );
+ if( ! probabilities.empty() )
+  write_section( output , probabilities.data() ,
+                 probabilities.size() * sizeof( double ) , offset );
+ if( block ) {
+  write_section( output , sizes.data() ,
+                 sizes.size() * sizeof( std::uint64_t ) , offset );
+  write_section( output , all_positions.data() ,
+                 all_positions.size() * sizeof( std::uint32_t ) , offset );
+  }
+ if( quantized ) {  // the offsets, followed by the scales
+  output.write( reinterpret_cast< const char * >( q_offset.data() ) ,
+                dimension * sizeof( double ) );
+  offset += dimension * sizeof( double );
+  write_section( output , q_scale.data() , dimension * sizeof( double ) ,
+                 offset );
+  }
+ if( data_size > 0 )
+  output.write( static_cast< const char * >( data ) , data_size );
+
+ if( ! output )
+  throw( std::runtime_error( "MappedScenarioSet::write: cannot write " +
+                             filename ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void MappedScenarioSet::convert( const netCDF::NcGroup & group ,
+                                 const std::string & filename ,
+                                 StochasticBlock * block ,
+                                 Precision precision ) {
+ ScenarioSet scenario_set;
+ scenario_set.deserialize( group );
+ write( filename , scenario_set , block , precision );
+}
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File MappedScenarioSet.cpp ----------------------*/
+/*--------------------------------------------------------------------------*/
@@ -0,0 +1,110 @@
+/*--------------------------------------------------------------------------*/
+/*-------------------------- File ParallelRun.h ----------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ *
+ * Internal header (not installed) with the run_in_parallel() function,
+ * which runs the same function in several threads and forwards to the
+ * caller the first exception thrown by any of them. It is used by
+ * ScenarioEvaluator, ScenarioGenerator and StochasticBlock.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*----------------------------- DEFINITIONS --------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#ifndef __ParallelRun
+#define __ParallelRun
+                      /* self-identification: #endif at the end of the file */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*----------------------------- NAMESPACE ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// namespace for the Structured Modeling System++ (SMS++)
+namespace SMSpp_di_unipi_it
+{
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ FUNCTIONS ---------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// runs a function in the given number of threads
+/** Calls run( t , failed ) for t = 0, ..., number_threads - 1, each call in
+ * its own thread: the calling thread makes the call with t = 0, and
+ * number_threads - 1 threads are started for the others. The flag \p
+ * failed (a const std::atomic< bool > &) becomes true as soon as a call
+ * throws, and the other calls should check it to stop early. When all the
+ * calls have returned, the first exception thrown by any of them (if any)
+ * is rethrown. If a thread cannot be started, \p failed is set, the threads
+ * already running are joined and the exception is rethrown, without making
+ * the call with t = 0. */
+
+template< class Run >
+void run_in_parallel( unsigned number_threads , Run && run ) {
+ std::atomic< bool > failed( false );
+ std::exception_ptr error;
+ std::mutex error_mutex;
+
+ auto guarded_run = [ & ]( unsigned t ) {
+  try {
+   run( t , static_cast< const std::atomic< bool > & >( failed ) );
+   }
+  catch( ... ) {
+   std::lock_guard< std::mutex > lock( error_mutex );
+   if( ! error )
+    error = std::current_exception();
+   failed = true;
+   }
+  };
+
+ std::vector< std::thread > threads;
+ threads.reserve( number_threads > 1 ? number_threads - 1 : 0 );
+ try {
+  for( unsigned t = 1 ; t < number_threads ; ++t )
+   threads.emplace_back( guarded_run , t );
+  }
+ catch( ... ) {
+  // a thread could not be started: stop and join those already running
+  failed = true;
+  for( auto & thread : threads )
+   thread.join();
+  throw;
+  }
+
+ guarded_run( 0 );
+
+ for( auto & thread : threads )
+  thread.join();
+
+ if( error )
+  std::rethrow_exception( error );
+}
+
+/*--------------------------------------------------------------------------*/
+
+}  // end( namespace SMSpp_di_unipi_it )
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#endif  /* ParallelRun.h included */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------ End File ParallelRun.h --------------------------*/
+/*--------------------------------------------------------------------------*/
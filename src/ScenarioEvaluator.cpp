@@ -0,0 +1,170 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioEvaluator.cpp -----------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the ScenarioEvaluator class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioEvaluator.h"
+#include "ParallelRun.h"
+
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = ScenarioEvaluator::Index;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------------- TYPES -----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+namespace {
+
+/// the scenarios [ begin , end ) still to be evaluated by a worker
+
+struct WorkRange {
+ std::mutex mutex;
+ Index begin = 0;
+ Index end = 0;
+};
+
+/*--------------------------------------------------------------------------*/
+
+/// takes the next scenario of the given WorkRange, if any
+
+bool pop( WorkRange & range , Index & scenario ) {
+ std::lock_guard< std::mutex > lock( range.mutex );
+ if( range.begin >= range.end )
+  return false;
+ scenario = range.begin++;
+ return true;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// moves half of the scenarios of the most loaded worker into ranges[ w ]
+
+bool steal( std::vector< WorkRange > & ranges , Index w ) {
+ for( ; ; ) {
+  Index victim = w;
+  Index max_remaining = 0;
+  for( Index v = 0 ; v < ranges.size() ; ++v ) {
+   if( v == w )
+    continue;
+   std::lock_guard< std::mutex > lock( ranges[ v ].mutex );
+   if( ranges[ v ].end - ranges[ v ].begin > max_remaining ) {
+    max_remaining = ranges[ v ].end - ranges[ v ].begin;
+    victim = v;
+    }
+   }
+
+  if( victim == w )
+   return false;  // nothing left anywhere
+
+  Index begin , end;
+  {
+   std::lock_guard< std::mutex > lock( ranges[ victim ].mutex );
+   const auto remaining = ranges[ victim ].end - ranges[ victim ].begin;
+   if( remaining == 0 )
+    continue;  // someone else got there first: look again
+   end = ranges[ victim ].end;
+   begin = end - ( remaining + 1 ) / 2;
+   ranges[ victim ].end = begin;
+  }
+
+  std::lock_guard< std::mutex > lock( ranges[ w ].mutex );
+  ranges[ w ].begin = begin;
+  ranges[ w ].end = end;
+  return true;
+  }
+}
+
+}  // end( unnamed namespace )
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- METHODS of ScenarioEvaluator ----------------------*/
+/*--------------------------------------------------------------------------*/
+
+ScenarioEvaluator::ScenarioEvaluator(
+ std::vector< std::unique_ptr< StochasticBlock > > && workers )
+ : workers( std::move( workers ) ) {
+ if( this->workers.empty() )
+  throw( std::invalid_argument( "ScenarioEvaluator: no worker given" ) );
+ for( const auto & worker : this->workers )
+  if( ! worker )
+   throw( std::invalid_argument( "ScenarioEvaluator: null worker" ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioEvaluator::ScenarioEvaluator( Index number_workers ,
+                                      const WorkerFactory & factory ) {
+ if( number_workers == 0 )
+  number_workers = std::max( std::thread::hardware_concurrency() , 1u );
+
+ workers.reserve( number_workers );
+ for( Index w = 0 ; w < number_workers ; ++w ) {
+  workers.push_back( factory( w ) );
+  if( ! workers.back() )
+   throw( std::invalid_argument( "ScenarioEvaluator: null worker" ) );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioEvaluator::evaluate( Index number_scenarios ,
+                                  const Evaluation & evaluation ) {
+ if( number_scenarios == 0 )
+  return;
+
+ const Index number_threads = std::min( Index( workers.size() ) ,
+                                        number_scenarios );
+
+ if( number_threads == 1 ) {
+  for( Index i = 0 ; i < number_scenarios ; ++i )
+   evaluation( *workers.front() , i );
+  return;
+  }
+
+ // initially, each worker gets a contiguous chunk of the scenarios
+ std::vector< WorkRange > ranges( number_threads );
+ for( Index w = 0 ; w < number_threads ; ++w ) {
+  ranges[ w ].begin = ( std::size_t( number_scenarios ) * w ) /
+                      number_threads;
+  ranges[ w ].end = ( std::size_t( number_scenarios ) * ( w + 1 ) ) /
+                    number_threads;
+  }
+
+ // the calling thread is worker 0
+ run_in_parallel( number_threads ,
+                  [ & ]( Index w , const std::atomic< bool > & failed ) {
+  Index scenario;
+  while( ! failed.load( std::memory_order_relaxed ) ) {
+   if( pop( ranges[ w ] , scenario ) )
+    evaluation( *workers[ w ] , scenario );
+   else if( ! steal( ranges , w ) )
+    break;
+   }
+  } );
+}
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File ScenarioEvaluator.cpp ----------------------*/
+/*--------------------------------------------------------------------------*/
@@ -0,0 +1,110 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioGenerator.cpp -----------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the ScenarioGenerator and ScenarioSetSampler classes.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioGenerator.h"
+#include "ParallelRun.h"
+
+#include <algorithm>
+#include <atomic>
+#include <numeric>
+#include <thread>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- METHODS of ScenarioGenerator ----------------------*/
+/*--------------------------------------------------------------------------*/
+
+void ScenarioGenerator::fill( ScenarioSet & scenarios , Index number ,
+                              std::uint64_t seed ,
+                              Index number_threads ) const {
+ scenarios.clear();
+ scenarios.resize( get_dimension() , number );
+
+ const Index number_streams = ( number + stream_length() - 1 ) /
+                              stream_length();
+ if( number_threads == 0 )
+  number_threads = std::max( std::thread::hardware_concurrency() , 1u );
+ number_threads = std::max( std::min( number_threads , number_streams ) ,
+                           Index( 1 ) );
+
+ std::atomic< Index > next_stream( 0 );
+ run_in_parallel( number_threads ,
+                  [ & ]( Index , const std::atomic< bool > & failed ) {
+  for( Index stream ; ( ! failed.load( std::memory_order_relaxed ) ) &&
+                      ( ( stream = next_stream++ ) < number_streams ) ; ) {
+   auto engine = get_engine( seed , stream );
+   const Index end = std::min( number , ( stream + 1 ) * stream_length() );
+   for( Index i = stream * stream_length() ; i < end ; ++i )
+    generate( scenarios.get_scenario( i ) , engine );
+   }
+  } );
+}
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- METHODS of ScenarioSetSampler ---------------------*/
+/*--------------------------------------------------------------------------*/
+
+ScenarioSetSampler::ScenarioSetSampler( const ScenarioSet & scenarios )
+ : scenarios( scenarios ) {
+ if( scenarios.empty() )
+  throw( std::invalid_argument( "ScenarioSetSampler: empty ScenarioSet" ) );
+
+ const auto & probabilities = scenarios.get_probabilities();
+ if( probabilities.empty() )
+  return;
+
+ cumulative.resize( probabilities.size() );
+ std::partial_sum( probabilities.begin() , probabilities.end() ,
+                   cumulative.begin() );
+ if( cumulative.back() <= 0 )
+  throw( std::invalid_argument( "ScenarioSetSampler: the probabilities "
+                                "sum to zero" ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioGenerator::Index ScenarioSetSampler::draw(
+ RandomEngine & engine ) const {
+ if( cumulative.empty() )
+  return std::uniform_int_distribution< Index >( 0 , scenarios.size() - 1 )
+   ( engine );
+
+ const auto u = std::uniform_real_distribution< double >
+  ( 0 , cumulative.back() )( engine );
+ const auto it = std::upper_bound( cumulative.begin() , cumulative.end() ,
+                                   u );
+ return std::min( Index( it - cumulative.begin() ) ,
+                  Index( scenarios.size() - 1 ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioSetSampler::generate( std::vector< double >::iterator scenario ,
+                                   RandomEngine & engine ) const {
+ const auto sample = scenarios.get_scenario( draw( engine ) );
+ std::copy_n( sample , get_dimension() , scenario );
+}
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File ScenarioGenerator.cpp ----------------------*/
+/*--------------------------------------------------------------------------*/
@@ -0,0 +1,254 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioOrdering.cpp ------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the ScenarioOrdering class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioOrdering.h"
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+#include <utility>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = ScenarioOrdering::Index;
+using Subset = ScenarioOrdering::Subset;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------------- FUNCTIONS -------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+namespace {
+
+/// returns the number of entries that differ between columns a and b of X
+
+template< class Matrix >
+std::size_t changed_entries( const Matrix & X , Index a , Index b ) {
+ return ( X.col( a ).array() != X.col( b ).array() ).count();
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// computes the order of the considered entries of the scenarios
+/** Calls \p order( X ), X being the matrix of the scenarios restricted to
+ * the given positions (all of them if \p positions is empty), without any
+ * copy if all the positions are considered. */
+
+template< class Order >
+void with_considered_entries( const ScenarioSet & scenarios ,
+                              const Subset & positions , Order && order ) {
+ if( positions.empty() ) {
+  order( scenarios.get_matrix() );
+  return;
+  }
+
+ const auto all = scenarios.get_matrix();
+ Eigen::MatrixXd X( positions.size() , scenarios.size() );
+ for( Index j = 0 ; j < scenarios.size() ; ++j )
+  for( Index k = 0 ; k < positions.size() ; ++k )
+   X( k , j ) = all( positions[ k ] , j );
+ order( X );
+}
+
+}  // end( unnamed namespace )
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- METHODS of ScenarioOrdering -----------------------*/
+/*--------------------------------------------------------------------------*/
+
+std::vector< Index > ScenarioOrdering::order( const ScenarioSet & scenarios )
+ const {
+ std::vector< Index > result;
+ result.reserve( scenarios.size() );
+
+ with_considered_entries( scenarios , positions , [ & ]( const c_Ref & X ) {
+  Subset columns( scenarios.size() );
+  std::iota( columns.begin() , columns.end() , 0 );
+  if( method == eClustering )
+   clustering( X , std::move( columns ) , result );
+  else
+   nearest_neighbour( X , std::move( columns ) , result );
+ } );
+
+ return result;
+}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioSet ScenarioOrdering::reorder( const ScenarioSet & scenarios ,
+                                       std::vector< Index > * permutation )
+ const {
+ const auto sequence = order( scenarios );
+
+ ScenarioSet reordered( scenarios.get_dimension() , scenarios.size() );
+ if( scenarios.get_dimension() > 0 )
+  for( Index i = 0 ; i < sequence.size() ; ++i )
+   reordered.get_matrix().col( i ) = scenarios.get_matrix().col(
+                                      sequence[ i ] );
+
+ const auto & probabilities = scenarios.get_probabilities();
+ if( ! probabilities.empty() ) {
+  std::vector< double > reordered_probabilities( sequence.size() );
+  for( Index i = 0 ; i < sequence.size() ; ++i )
+   reordered_probabilities[ i ] = probabilities[ sequence[ i ] ];
+  reordered.set_probabilities( std::move( reordered_probabilities ) );
+  }
+
+ if( permutation )
+  *permutation = sequence;
+ return reordered;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioOrdering::evaluate( const ScenarioSet & scenarios ,
+                                 const std::vector< Index > & permutation ,
+                                 std::size_t * changed_entries ,
+                                 double * distance ) const {
+ std::size_t changed = 0;
+ double total = 0;
+ with_considered_entries( scenarios , positions , [ & ]( const c_Ref & X ) {
+  for( Index i = 1 ; i < permutation.size() ; ++i ) {
+   changed += ::changed_entries( X , permutation[ i - 1 ] ,
+                                 permutation[ i ] );
+   total += ( X.col( permutation[ i - 1 ] ) -
+              X.col( permutation[ i ] ) ).norm();
+   }
+ } );
+
+ if( changed_entries )
+  *changed_entries = changed;
+ if( distance )
+  *distance = total;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioOrdering::nearest_neighbour( const c_Ref & X ,
+                                          Subset && columns ,
+                                          std::vector< Index > & result )
+ const {
+ if( columns.empty() )
+  return;
+
+ std::mt19937_64 engine( seed );
+
+ // the distance between two scenarios, compared lexicographically
+ auto distance = [ & ]( Index a , Index b ) {
+  return std::make_pair( metric == eChangedEntries ?
+                         changed_entries( X , a , b ) : 0 ,
+                         ( X.col( a ) - X.col( b ) ).squaredNorm() );
+ };
+
+ if( result.empty() ) {
+  result.push_back( columns.front() );
+  columns.erase( columns.begin() );
+  }
+
+ while( ! columns.empty() ) {
+  Index candidates = columns.size();
+  if( max_candidates && ( candidates > max_candidates ) ) {
+   // move a random sample of the candidates to the front
+   for( Index t = 0 ; t < max_candidates ; ++t ) {
+    std::uniform_int_distribution< Index > dist( t , columns.size() - 1 );
+    std::swap( columns[ t ] , columns[ dist( engine ) ] );
+    }
+   candidates = max_candidates;
+   }
+
+  const auto current = result.back();
+  Index best = 0;
+  auto best_distance = distance( current , columns[ 0 ] );
+  for( Index t = 1 ; t < candidates ; ++t ) {
+   const auto d = distance( current , columns[ t ] );
+   if( d < best_distance ) {
+    best_distance = d;
+    best = t;
+    }
+   }
+
+  result.push_back( columns[ best ] );
+  columns[ best ] = columns.back();
+  columns.pop_back();
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioOrdering::clustering( const c_Ref & X , Subset && columns ,
+                                   std::vector< Index > & result ) const {
+ if( ( columns.size() <= cluster_size ) || ( X.rows() == 0 ) ) {
+  nearest_neighbour( X , std::move( columns ) , result );
+  return;
+  }
+
+ // the principal direction of the scenarios, by power iteration
+ Eigen::VectorXd mean = Eigen::VectorXd::Zero( X.rows() );
+ for( auto j : columns )
+  mean += X.col( j );
+ mean /= columns.size();
+
+ Eigen::VectorXd direction = Eigen::VectorXd::Ones( X.rows() );
+ Eigen::VectorXd next( X.rows() );
+ for( int iteration = 0 ; iteration < 10 ; ++iteration ) {
+  next.setZero();
+  for( auto j : columns )
+   next += ( X.col( j ) - mean ) *
+           ( X.col( j ) - mean ).dot( direction );
+  const double norm = next.norm();
+  if( norm == 0 )
+   break;  // all the scenarios are equal along direction
+  direction = next / norm;
+  }
+
+ // split the scenarios at the median of their projection
+ std::vector< std::pair< double , Index > > projections;
+ projections.reserve( columns.size() );
+ for( auto j : columns )
+  projections.emplace_back( ( X.col( j ) - mean ).dot( direction ) , j );
+ const auto middle = projections.begin() + projections.size() / 2;
+ std::nth_element( projections.begin() , middle , projections.end() );
+
+ Subset lower , upper;
+ lower.reserve( middle - projections.begin() );
+ upper.reserve( projections.end() - middle );
+ for( auto p = projections.begin() ; p != middle ; ++p )
+  lower.push_back( p->second );
+ for( auto p = middle ; p != projections.end() ; ++p )
+  upper.push_back( p->second );
+
+ // keep the first scenario first, as nearest neighbour does
+ if( result.empty() ) {
+  if( std::find( upper.begin() , upper.end() , columns.front() ) !=
+      upper.end() )
+   std::swap( lower , upper );
+  std::iter_swap( lower.begin() , std::find( lower.begin() , lower.end() ,
+                                             columns.front() ) );
+  }
+
+ columns.clear();
+ clustering( X , std::move( lower ) , result );
+ clustering( X , std::move( upper ) , result );
+}
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- End File ScenarioOrdering.cpp ---------------------*/
+/*--------------------------------------------------------------------------*/
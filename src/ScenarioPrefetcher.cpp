@@ -0,0 +1,166 @@
+/*--------------------------------------------------------------------------*/
+/*---------------------- File ScenarioPrefetcher.cpp -----------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the ScenarioPrefetcher class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioPrefetcher.h"
+
+#include <algorithm>
+#include <numeric>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = ScenarioPrefetcher::Index;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- METHODS of ScenarioPrefetcher -----------------------*/
+/*--------------------------------------------------------------------------*/
+
+ScenarioPrefetcher::ScenarioPrefetcher( Index dimension , Loader loader ,
+                                        Index depth )
+ : dimension( dimension ) , loader( std::move( loader ) ) ,
+   buffers( std::max( depth , Index( 2 ) ) ,
+            std::vector< double >( dimension ) ) {}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioPrefetcher::ScenarioPrefetcher( const ScenarioSet & scenarios ,
+                                        Index depth )
+ : ScenarioPrefetcher( scenarios.get_dimension() ,
+                       [ set = & scenarios ]( Index i , double * scenario ) {
+                        std::copy_n( set->get_scenario( i ) ,
+                                     set->get_dimension() , scenario );
+                       } , depth ) {}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioPrefetcher::ScenarioPrefetcher( const CompactScenarioSet & scenarios ,
+                                        Index depth )
+ : ScenarioPrefetcher( scenarios.get_dimension() ,
+                       [ set = & scenarios ]( Index i , double * scenario ) {
+                        set->get_scenario( i , scenario );
+                       } , depth ) {}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioPrefetcher::ScenarioPrefetcher( const MappedScenarioSet & scenarios ,
+                                        Index depth )
+ : ScenarioPrefetcher( scenarios.get_dimension() ,
+                       [ set = & scenarios ]( Index i , double * scenario ) {
+                        set->get_scenario( i , scenario );
+                       } , depth ) {}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioPrefetcher::start( std::vector< Index > && sequence ) {
+ stop();
+ this->sequence = std::move( sequence );
+ if( ! this->sequence.empty() )
+  thread = std::thread( & ScenarioPrefetcher::run , this );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioPrefetcher::start( Index first , Index last ) {
+ std::vector< Index > sequence( last > first ? last - first : 0 );
+ std::iota( sequence.begin() , sequence.end() , first );
+ start( std::move( sequence ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+const std::vector< double > * ScenarioPrefetcher::next() {
+ std::unique_lock< std::mutex > lock( mutex );
+
+ // give the buffer of the previous scenario back to the background thread
+ if( taken > released ) {
+  ++released;
+  released_cv.notify_one();
+  }
+
+ if( taken >= sequence.size() )
+  return nullptr;
+
+ loaded_cv.wait( lock , [ this ]() { return ( loaded > taken ) || error; } );
+
+ if( loaded <= taken ) {  // the scenario could not be loaded
+  auto exception = error;
+  lock.unlock();
+  stop();
+  std::rethrow_exception( exception );
+  }
+
+ current = sequence[ taken ];
+ return & buffers[ taken++ % buffers.size() ];
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioPrefetcher::stop() {
+ {
+  std::lock_guard< std::mutex > lock( mutex );
+  stopping = true;
+ }
+ released_cv.notify_one();
+
+ if( thread.joinable() )
+  thread.join();
+
+ sequence.clear();
+ loaded = taken = released = 0;
+ stopping = false;
+ error = nullptr;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioPrefetcher::run() {
+ const auto depth = buffers.size();
+
+ for( std::size_t s = 0 ; s < sequence.size() ; ++s ) {
+  {  // wait for the buffer of scenario s to be given back
+   std::unique_lock< std::mutex > lock( mutex );
+   released_cv.wait( lock , [ & ]() {
+                            return stopping || ( s < released + depth ); } );
+   if( stopping )
+    return;
+  }
+
+  try {
+   loader( sequence[ s ] , buffers[ s % depth ].data() );
+   }
+  catch( ... ) {
+   std::lock_guard< std::mutex > lock( mutex );
+   error = std::current_exception();
+   loaded_cv.notify_one();
+   return;
+   }
+
+  {
+   std::lock_guard< std::mutex > lock( mutex );
+   ++loaded;
+  }
+  loaded_cv.notify_one();
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File ScenarioPrefetcher.cpp ---------------------*/
+/*--------------------------------------------------------------------------*/
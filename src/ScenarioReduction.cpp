@@ -0,0 +1,314 @@
+/*--------------------------------------------------------------------------*/
+/*----------------------- File ScenarioReduction.cpp -----------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the ScenarioReduction class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioReduction.h"
+
+#include <algorithm>
+#include <functional>
+#include <iterator>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <random>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = ScenarioReduction::Index;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------------- FUNCTIONS -------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+namespace {
+
+/// computes the distances between two blocks of columns of X
+/** Sets D( i , j ) to the Euclidean distance between the columns of X whose
+ * indices are k0 + i and j0 + j, by means of the squared norms of the
+ * columns of X, for i = 0, ..., kb - 1 and j = 0, ..., jb - 1. */
+
+void block_distances( const ScenarioSet::c_Matrix & X ,
+                      const Eigen::VectorXd & norms ,
+                      Index k0 , Index kb , Index j0 , Index jb ,
+                      Eigen::MatrixXd & D ) {
+ D.noalias() = X.middleCols( k0 , kb ).transpose() * X.middleCols( j0 , jb );
+ D *= -2.0;
+ D.colwise() += norms.segment( k0 , kb );
+ D.rowwise() += norms.segment( j0 , jb ).transpose();
+ D = D.cwiseMax( 0.0 ).cwiseSqrt();
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// computes the distances between a block of columns of X and some others
+/** Sets D( i , c ) to the Euclidean distance between the columns of X whose
+ * indices are k0 + i and columns[ c ], by means of the squared norms of the
+ * columns of X, for i = 0, ..., kb - 1. The columns are used in place: each
+ * run of consecutive indices in \p columns (which are typically sorted) is
+ * dealt with by a single matrix product. */
+
+void block_distances( const ScenarioSet::c_Matrix & X ,
+                      const Eigen::VectorXd & norms , Index k0 , Index kb ,
+                      const std::vector< Index > & columns ,
+                      Eigen::MatrixXd & D ) {
+ D.resize( kb , columns.size() );
+ for( Index c = 0 ; c < columns.size() ; ) {
+  Index run = 1;
+  while( ( c + run < columns.size() ) &&
+         ( columns[ c + run ] == columns[ c ] + run ) )
+   ++run;
+  D.middleCols( c , run ).noalias() =
+   X.middleCols( k0 , kb ).transpose() * X.middleCols( columns[ c ] , run );
+  c += run;
+  }
+ D *= -2.0;
+ D.colwise() += norms.segment( k0 , kb );
+ for( Index c = 0 ; c < columns.size() ; ++c )
+  D.col( c ).array() += norms( columns[ c ] );
+ D = D.cwiseMax( 0.0 ).cwiseSqrt();
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// computes the distances between all the columns of X and column u
+
+void column_distances( const ScenarioSet::c_Matrix & X ,
+                       const Eigen::VectorXd & norms , Index u ,
+                       Eigen::VectorXd & d ) {
+ d.noalias() = X.transpose() * X.col( u );
+ d = ( norms.array() + norms( u ) - 2.0 * d.array() ).cwiseMax( 0.0 )
+      .sqrt().matrix();
+ d( u ) = 0;
+}
+
+}  // end( unnamed namespace )
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- METHODS of ScenarioReduction ----------------------*/
+/*--------------------------------------------------------------------------*/
+
+ScenarioSet ScenarioReduction::reduce( const ScenarioSet & scenarios ,
+                                       Index number ,
+                                       std::vector< Index > * assignment )
+ const {
+ const Index n = scenarios.size();
+ std::vector< bool > selected( n , false );
+ std::vector< Index > owner( n );
+
+ if( number >= n ) {
+  selected.assign( n , true );
+  std::iota( owner.begin() , owner.end() , 0 );
+  }
+ else if( number > 0 ) {
+  if( method == eBackwardReduction )
+   backward_reduction( scenarios , number , selected , owner );
+  else
+   forward_selection( scenarios , number , selected , owner );
+  }
+
+ ScenarioSet reduced( scenarios.get_dimension() );
+ reduced.reserve( std::min( number , n ) );
+ std::vector< Index > position( n , Inf< Index >() );
+ for( Index k = 0 ; k < n ; ++k )
+  if( selected[ k ] ) {
+   position[ k ] = reduced.size();
+   reduced.add_scenario( scenarios.get_scenario( k ) );
+   }
+
+ std::vector< double > probabilities( reduced.size() , 0.0 );
+ if( ! reduced.empty() )
+  for( Index k = 0 ; k < n ; ++k )
+   probabilities[ position[ owner[ k ] ] ] += scenarios.get_probability( k );
+ reduced.set_probabilities( std::move( probabilities ) );
+
+ if( assignment ) {
+  assignment->resize( n );
+  for( Index k = 0 ; k < n ; ++k )
+   ( *assignment )[ k ] = reduced.empty() ? Inf< Index >() :
+                                            position[ owner[ k ] ];
+  }
+
+ return reduced;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioReduction::forward_selection( const ScenarioSet & scenarios ,
+                                           Index number ,
+                                           std::vector< bool > & selected ,
+                                           std::vector< Index > & owner )
+ const {
+ const auto X = scenarios.get_matrix();
+ const Index n = scenarios.size();
+ const Eigen::VectorXd p = scenarios.get_probability_vector();
+ const Eigen::VectorXd norms = X.colwise().squaredNorm().transpose();
+
+ // distance of each scenario from the closest selected one
+ Eigen::VectorXd closest = Eigen::VectorXd::Constant(
+  n , std::numeric_limits< double >::infinity() );
+
+ // the scenarios not selected yet, and the sampled candidates, both sorted
+ std::vector< Index > remaining( n );
+ std::iota( remaining.begin() , remaining.end() , 0 );
+ std::vector< Index > sample;
+
+ std::mt19937_64 engine( seed );
+ Eigen::MatrixXd D;
+ Eigen::VectorXd score , d;
+
+ for( Index it = 0 ; it < number ; ++it ) {
+  const std::vector< Index > * candidates = & remaining;
+  if( max_candidates && ( max_candidates < remaining.size() ) ) {
+   sample.clear();
+   std::sample( remaining.begin() , remaining.end() ,
+                std::back_inserter( sample ) , max_candidates , engine );
+   candidates = & sample;
+   }
+  const Index nc = candidates->size();
+
+  // score( c ) = sum_k p_k min( closest_k , d( k , c ) ); the selected
+  // scenarios have closest_k == 0 and so they do not contribute
+  score.setZero( nc );
+  for( Index k0 = 0 ; k0 < n ; k0 += block_size ) {
+   const Index kb = std::min( block_size , n - k0 );
+   block_distances( X , norms , k0 , kb , *candidates , D );
+   if( it > 0 )
+    for( Index c = 0 ; c < nc ; ++c )
+     D.col( c ) = D.col( c ).cwiseMin( closest.segment( k0 , kb ) );
+   score.noalias() += D.transpose() * p.segment( k0 , kb );
+   }
+
+  Index best;
+  score.minCoeff( & best );
+  const Index u = ( *candidates )[ best ];
+  remaining.erase( std::lower_bound( remaining.begin() , remaining.end() ,
+                                     u ) );
+  selected[ u ] = true;
+
+  column_distances( X , norms , u , d );
+  for( Index k = 0 ; k < n ; ++k )
+   if( d( k ) < closest( k ) ) {
+    closest( k ) = d( k );
+    owner[ k ] = u;
+    }
+  closest( u ) = 0;
+  owner[ u ] = u;
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioReduction::backward_reduction( const ScenarioSet & scenarios ,
+                                            Index number ,
+                                            std::vector< bool > & selected ,
+                                            std::vector< Index > & owner )
+ const {
+ const auto X = scenarios.get_matrix();
+ const Index n = scenarios.size();
+ const double inf = std::numeric_limits< double >::infinity();
+ const Eigen::VectorXd norms = X.colwise().squaredNorm().transpose();
+ std::vector< double > p( n );
+ for( Index k = 0 ; k < n ; ++k )
+  p[ k ] = scenarios.get_probability( k );
+
+ selected.assign( n , true );
+ std::iota( owner.begin() , owner.end() , 0 );
+
+ // nearest neighbour of each scenario, computed blockwise
+ std::vector< Index > nearest( n , 0 );
+ std::vector< double > nearest_distance( n , inf );
+ Eigen::MatrixXd D;
+ for( Index k0 = 0 ; k0 < n ; k0 += block_size ) {
+  const Index kb = std::min( block_size , n - k0 );
+  for( Index j0 = 0 ; j0 < n ; j0 += block_size ) {
+   const Index jb = std::min( block_size , n - j0 );
+   block_distances( X , norms , k0 , kb , j0 , jb , D );
+   for( Index i = 0 ; i < kb ; ++i )
+    for( Index j = 0 ; j < jb ; ++j )
+     if( ( k0 + i != j0 + j ) && ( D( i , j ) < nearest_distance[ k0 + i ] ) ) {
+      nearest_distance[ k0 + i ] = D( i , j );
+      nearest[ k0 + i ] = j0 + j;
+      }
+   }
+  }
+
+ // the scenarios whose nearest neighbour is a given one (possibly stale)
+ std::vector< std::vector< Index > > nearest_of( n );
+ for( Index k = 0 ; k < n ; ++k )
+  nearest_of[ nearest[ k ] ].push_back( k );
+
+ // min-heap of the removal costs; an entry is valid only if its cost is
+ // the current cost of a scenario which has not been removed yet
+ using Entry = std::pair< double , Index >;
+ std::priority_queue< Entry , std::vector< Entry > ,
+                      std::greater< Entry > > heap;
+ std::vector< double > cost( n );
+ for( Index k = 0 ; k < n ; ++k )
+  heap.emplace( cost[ k ] = p[ k ] * nearest_distance[ k ] , k );
+
+ Eigen::VectorXd d;
+ for( Index kept = n ; kept > number ; --kept ) {
+  while( ( ! selected[ heap.top().second ] ) ||
+         ( heap.top().first != cost[ heap.top().second ] ) )
+   heap.pop();
+  const Index l = heap.top().second;
+  heap.pop();
+  selected[ l ] = false;
+
+  // update the scenarios whose nearest neighbour was l
+  for( auto k : nearest_of[ l ] ) {
+   if( ( ! selected[ k ] ) || ( nearest[ k ] != l ) )
+    continue;
+   column_distances( X , norms , k , d );
+   nearest_distance[ k ] = inf;
+   for( Index h = 0 ; h < n ; ++h )
+    if( selected[ h ] && ( h != k ) && ( d( h ) < nearest_distance[ k ] ) ) {
+     nearest_distance[ k ] = d( h );
+     nearest[ k ] = h;
+     }
+   nearest_of[ nearest[ k ] ].push_back( k );
+   heap.emplace( cost[ k ] = p[ k ] * nearest_distance[ k ] , k );
+   }
+  std::vector< Index >().swap( nearest_of[ l ] );
+  }
+
+ // give each removed scenario to the closest kept one, computed blockwise
+ std::vector< Index > kept;
+ kept.reserve( number );
+ for( Index k = 0 ; k < n ; ++k )
+  if( selected[ k ] )
+   kept.push_back( k );
+
+ for( Index k0 = 0 ; k0 < n ; k0 += block_size ) {
+  const Index kb = std::min( block_size , n - k0 );
+  block_distances( X , norms , k0 , kb , kept , D );
+  for( Index i = 0 ; i < kb ; ++i )
+   if( ! selected[ k0 + i ] ) {
+    Index closest;
+    D.row( i ).minCoeff( & closest );
+    owner[ k0 + i ] = kept[ closest ];
+    }
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File ScenarioReduction.cpp ----------------------*/
+/*--------------------------------------------------------------------------*/
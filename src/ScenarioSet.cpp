@@ -0,0 +1,122 @@
+/*--------------------------------------------------------------------------*/
+/*-------------------------- File ScenarioSet.cpp --------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the ScenarioSet class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioSet.h"
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- METHODS of ScenarioSet ------------------------*/
+/*--------------------------------------------------------------------------*/
+
+void ScenarioSet::deserialize( const netCDF::NcGroup & group ) {
+ Index num_scenarios = 0;
+ Index scenario_dimension = 0;
+ if( ( ! ::SMSpp_di_unipi_it::deserialize_dim( group , "NumberScenarios" ,
+                                               num_scenarios , true ) ) ||
+     ( ! ::SMSpp_di_unipi_it::deserialize_dim( group , "ScenarioDimension" ,
+                                               scenario_dimension , true ) ) )
+  throw( std::logic_error( "ScenarioSet::deserialize: dimension "
+                           "'NumberScenarios' or 'ScenarioDimension' is "
+                           "missing." ) );
+
+ clear();
+ resize( scenario_dimension , num_scenarios );
+
+ if( ! data.empty() ) {
+  auto scenarios = group.getVar( "Scenarios" );
+  if( scenarios.isNull() )
+   throw( std::logic_error( "ScenarioSet::deserialize: variable "
+                            "'Scenarios' is missing." ) );
+  scenarios.getVar( data.data() );
+  }
+
+ auto probs = group.getVar( "Probabilities" );
+ if( ! probs.isNull() ) {
+  probabilities.resize( number );
+  if( number > 0 )
+   probs.getVar( probabilities.data() );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioSet::resize( Index dimension , Index number ) {
+ if( dimension != this->dimension ) {
+  data.assign( std::size_t( dimension ) * number , 0.0 );
+  this->dimension = dimension;
+  }
+ else
+  data.resize( std::size_t( dimension ) * number , 0.0 );
+
+ if( ! probabilities.empty() )
+  probabilities.resize( number , 0.0 );
+
+ this->number = number;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioSet::normalize_probabilities() {
+ if( probabilities.empty() )
+  return;
+
+ double sum = 0;
+ for( auto p : probabilities )
+  sum += p;
+
+ if( sum <= 0 )
+  throw( std::logic_error( "ScenarioSet::normalize_probabilities: the "
+                           "probabilities sum to zero" ) );
+
+ for( auto & p : probabilities )
+  p /= sum;
+}
+
+/*--------------------------------------------------------------------------*/
+
+Eigen::VectorXd ScenarioSet::get_probability_vector() const {
+ if( probabilities.empty() )
+  return Eigen::VectorXd::Constant( number , 1.0 / std::max( number ,
+                                                             Index( 1 ) ) );
+ return Eigen::Map< const Eigen::VectorXd >( probabilities.data() , number );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioSet::serialize( netCDF::NcGroup & group ) const {
+ auto num_scenarios_dim = group.addDim( "NumberScenarios" , number );
+ auto dimension_dim = group.addDim( "ScenarioDimension" , dimension );
+
+ if( ! data.empty() )
+  group.addVar( "Scenarios" , netCDF::NcDouble() ,
+                { num_scenarios_dim , dimension_dim } ).putVar( data.data() );
+
+ // the probabilities are there even if the scenarios have no entry
+ if( ! probabilities.empty() )
+  group.addVar( "Probabilities" , netCDF::NcDouble() ,
+                num_scenarios_dim ).putVar( probabilities.data() );
+}
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- End File ScenarioSet.cpp -------------------------*/
+/*--------------------------------------------------------------------------*/
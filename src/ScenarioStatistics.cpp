@@ -0,0 +1,341 @@
+/*--------------------------------------------------------------------------*/
+/*---------------------- File ScenarioStatistics.cpp -----------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the ScenarioStatistics class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = ScenarioStatistics::Index;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- METHODS of ScenarioStatistics -----------------------*/
+/*--------------------------------------------------------------------------*/
+
+ScenarioStatistics::ScenarioStatistics( Index dimension , Index bins )
+ : dimension( dimension ) , bins( bins + bins % 2 ) ,
+   mean( Eigen::VectorXd::Zero( dimension ) ) ,
+   deviations( Eigen::VectorXd::Zero( dimension ) ) ,
+   cells( std::size_t( dimension ) * this->bins ) {}
+
+/*--------------------------------------------------------------------------*/
+
+template< class Decode , class Probability >
+void ScenarioStatistics::add_chunks( Index count , Decode && decode ,
+                                     Probability && probability ) {
+ const Index chunk = chunk_size();
+ std::vector< double > buffer( std::size_t( dimension ) * chunk );
+ std::vector< double > weights( chunk );
+ for( Index i = 0 ; i < count ; i += chunk ) {
+  const Index n = std::min( chunk , count - i );
+  for( Index k = 0 ; k < n ; ++k ) {
+   decode( i + k , buffer.data() + std::size_t( k ) * dimension );
+   weights[ k ] = probability( i + k );
+   }
+  add( buffer.data() , n , weights.data() );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioStatistics::add( const double * scenarios , Index number ,
+                              const double * weights ) {
+ if( std::any_of( weights , weights + number ,
+                  []( double weight ) { return weight < 0; } ) )
+  throw( std::invalid_argument( "ScenarioStatistics::add: negative "
+                                "weight" ) );
+
+ const Eigen::Map< const Eigen::MatrixXd > X( scenarios , dimension ,
+                                              number );
+ const Eigen::Map< const Eigen::VectorXd > w( weights , number );
+ const double chunk_weight = w.sum();
+ if( chunk_weight <= 0 )
+  return;
+
+ // the mean and the squared deviations of the chunk
+ const Eigen::VectorXd chunk_mean = X * w / chunk_weight;
+ Eigen::VectorXd chunk_deviations = Eigen::VectorXd::Zero( dimension );
+ for( Index j = 0 ; j < number ; ++j )
+  if( w[ j ] > 0 )
+   chunk_deviations.array() += w[ j ] *
+                               ( X.col( j ) - chunk_mean ).array().square();
+
+ // merged with those of the previous chunks (Chan, Golub and LeVeque)
+ const double new_weight = total_weight + chunk_weight;
+ const Eigen::VectorXd delta = chunk_mean - mean;
+ mean += delta * ( chunk_weight / new_weight );
+ deviations += chunk_deviations + delta.cwiseAbs2() *
+                                  ( total_weight * chunk_weight / new_weight );
+ total_weight = new_weight;
+
+ for( Index j = 0 ; j < number ; ++j )
+  if( w[ j ] > 0 ) {
+   if( bins > 0 )
+    add_to_histograms( scenarios + std::size_t( j ) * dimension , w[ j ] );
+   ++this->number;
+   }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioStatistics::add( const ScenarioSet & scenarios ) {
+ if( scenarios.get_dimension() != dimension )
+  throw( std::invalid_argument( "ScenarioStatistics::add: wrong dimension" ) );
+
+ // the scenarios are contiguous in the ScenarioSet: no copy is needed
+ const Eigen::VectorXd probabilities = scenarios.get_probability_vector();
+ const auto data = scenarios.get_matrix().data();
+ const Index chunk = chunk_size();
+ for( Index i = 0 ; i < scenarios.size() ; i += chunk )
+  add( data + std::size_t( i ) * dimension ,
+       std::min( chunk , scenarios.size() - i ) , probabilities.data() + i );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioStatistics::add( const CompactScenarioSet & scenarios ) {
+ if( scenarios.get_dimension() != dimension )
+  throw( std::invalid_argument( "ScenarioStatistics::add: wrong dimension" ) );
+
+ add_chunks( scenarios.size() ,
+             [ & ]( Index i , double * scenario ) {
+              scenarios.get_scenario( i , scenario ); } ,
+             [ & ]( Index i ) { return scenarios.get_probability( i ); } );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioStatistics::add( const MappedScenarioSet & scenarios ) {
+ if( scenarios.get_dimension() != dimension )
+  throw( std::invalid_argument( "ScenarioStatistics::add: wrong dimension" ) );
+ if( scenarios.empty() )
+  return;
+
+ auto probability = [ & ]( Index i ) {
+  return scenarios.get_probability( i );
+ };
+
+ const auto data = scenarios.get_scenario( Index( 0 ) );
+ if( ! data ) {  // the values must be decoded
+  add_chunks( scenarios.size() ,
+              [ & ]( Index i , double * scenario ) {
+               scenarios.get_scenario( i , scenario ); } ,
+              probability );
+  return;
+  }
+
+ // the double values are read right from the mapped file
+ const Index chunk = chunk_size();
+ std::vector< double > weights( chunk );
+ for( Index i = 0 ; i < scenarios.size() ; i += chunk ) {
+  const Index n = std::min( chunk , scenarios.size() - i );
+  for( Index k = 0 ; k < n ; ++k )
+   weights[ k ] = probability( i + k );
+  add( data + std::size_t( i ) * dimension , n , weights.data() );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioStatistics::clear() {
+ number = 0;
+ total_weight = 0;
+ mean.setZero();
+ deviations.setZero();
+ kept_weights.clear();
+}
+
+/*--------------------------------------------------------------------------*/
+
+std::vector< double > ScenarioStatistics::get_mean() const {
+ if( number == 0 )
+  throw( std::logic_error( "ScenarioStatistics::get_mean: no scenario" ) );
+ return std::vector< double >( mean.data() , mean.data() + dimension );
+}
+
+/*--------------------------------------------------------------------------*/
+
+std::vector< double > ScenarioStatistics::get_variance() const {
+ if( number == 0 )
+  throw( std::logic_error( "ScenarioStatistics::get_variance: no "
+                           "scenario" ) );
+ std::vector< double > variance( dimension );
+ Eigen::Map< Eigen::VectorXd >( variance.data() , dimension ) =
+  deviations / total_weight;
+ return variance;
+}
+
+/*--------------------------------------------------------------------------*/
+
+std::vector< double > ScenarioStatistics::get_quantile( double p ) const {
+ if( number == 0 )
+  throw( std::logic_error( "ScenarioStatistics::get_quantile: no "
+                           "scenario" ) );
+ if( bins == 0 )
+  throw( std::logic_error( "ScenarioStatistics::get_quantile: the "
+                           "quantiles are not computed" ) );
+
+ if( p <= 0 )
+  return std::vector< double >( minimum.data() , minimum.data() + dimension );
+ if( p >= 1 )
+  return std::vector< double >( maximum.data() , maximum.data() + dimension );
+
+ const double target = p * total_weight;
+ const double tolerance = 1e-12 * total_weight;
+ std::vector< double > quantile( maximum.data() ,
+                                 maximum.data() + dimension );
+
+ if( is_quantile_exact() ) {
+  std::vector< Index > order( number );
+  for( Index e = 0 ; e < dimension ; ++e ) {
+   const auto values = cells.data() + std::size_t( e ) * bins;
+   std::iota( order.begin() , order.end() , 0 );
+   std::sort( order.begin() , order.end() , [ & ]( Index a , Index b ) {
+    return values[ a ] < values[ b ]; } );
+   double cumulative = 0;
+   for( auto k : order ) {
+    cumulative += kept_weights[ k ];
+    if( cumulative + tolerance >= target ) {
+     quantile[ e ] = values[ k ];
+     break;
+     }
+    }
+   }
+  return quantile;
+  }
+
+ for( Index e = 0 ; e < dimension ; ++e ) {
+  const auto cell = cells.data() + std::size_t( e ) * bins;
+  double cumulative = 0;
+  for( Index b = 0 ; b < bins ; ++b ) {
+   if( ( cell[ b ] > 0 ) &&
+       ( cumulative + cell[ b ] + tolerance >= target ) ) {
+    const double fraction = std::clamp( ( target - cumulative ) / cell[ b ] ,
+                                        0.0 , 1.0 );
+    quantile[ e ] = std::clamp( lower[ e ] + ( b + fraction ) * width[ e ] ,
+                                minimum[ e ] , maximum[ e ] );
+    break;
+    }
+   cumulative += cell[ b ];
+   }
+  }
+ return quantile;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioStatistics::add_to_histograms( const double * scenario ,
+                                            double weight ) {
+ const Eigen::Map< const Eigen::VectorXd > x( scenario , dimension );
+ if( ! x.allFinite() )
+  throw( std::invalid_argument( "ScenarioStatistics::add: non-finite "
+                                "value" ) );
+ if( number == 0 ) {
+  minimum = x;
+  maximum = x;
+  }
+ else {
+  minimum = minimum.cwiseMin( x );
+  maximum = maximum.cwiseMax( x );
+  }
+
+ if( number < bins ) {  // just keep the values
+  for( Index e = 0 ; e < dimension ; ++e )
+   cells[ std::size_t( e ) * bins + number ] = scenario[ e ];
+  kept_weights.push_back( weight );
+  return;
+  }
+
+ if( number == bins )
+  build_histograms();
+
+ const Index half = bins / 2;
+ for( Index e = 0 ; e < dimension ; ++e ) {
+  const double value = scenario[ e ];
+  const auto cell = cells.data() + std::size_t( e ) * bins;
+  auto & low = lower[ e ];
+  auto & step = width[ e ];
+
+  while( value < low ) {  // the range becomes the upper half of the cells
+   for( Index j = bins ; j-- > half ; )
+    cell[ j ] = cell[ 2 * ( j - half ) ] + cell[ 2 * ( j - half ) + 1 ];
+   std::fill( cell , cell + half , 0.0 );
+   low -= bins * step;
+   step *= 2;
+   }
+
+  while( value > low + bins * step ) {  // it becomes the lower half
+   for( Index j = 0 ; j < half ; ++j )
+    cell[ j ] = cell[ 2 * j ] + cell[ 2 * j + 1 ];
+   std::fill( cell + half , cell + bins , 0.0 );
+   step *= 2;
+   }
+
+  cell[ std::min( bins - 1 , Index( ( value - low ) / step ) ) ] += weight;
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioStatistics::build_histograms() {
+ lower.resize( dimension );
+ width.resize( dimension );
+ std::vector< double > values( bins );
+
+ for( Index e = 0 ; e < dimension ; ++e ) {
+  const auto cell = cells.data() + std::size_t( e ) * bins;
+  std::copy_n( cell , bins , values.begin() );
+  std::fill( cell , cell + bins , 0.0 );
+
+  const double low = minimum[ e ];
+  double step = ( maximum[ e ] - low ) / bins;
+  if( ! ( step > 0 ) )  // all the values are equal (so far)
+   step = std::max( std::abs( low ) , 1.0 ) * 1e-9;
+
+  for( Index k = 0 ; k < bins ; ++k )
+   cell[ std::min( bins - 1 , Index( ( values[ k ] - low ) / step ) ) ] +=
+    kept_weights[ k ];
+
+  lower[ e ] = low;
+  width[ e ] = step;
+  }
+
+ kept_weights.clear();
+}
+
+/*--------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------*/
+
+Index ScenarioStatistics::chunk_size() const {
+ // a chunk of (about) 1 MB stays in the cache between the two reductions
+ return std::clamp( Index( ( 1 << 17 ) / std::max( dimension , Index( 1 ) ) ) ,
+                    Index( 1 ) , Index( 256 ) );
+}
+
+/*--------------------------------------------------------------------------*/
+/*-------------------- End File ScenarioStatistics.cpp ---------------------*/
+/*--------------------------------------------------------------------------*/
@@ -0,0 +1,194 @@
+/*--------------------------------------------------------------------------*/
+/*------------------------- File ScenarioTree.cpp --------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the ScenarioTree class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "ScenarioTree.h"
+
+#include <stdexcept>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = ScenarioTree::Index;
+using Subset = ScenarioTree::Subset;
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- METHODS of ScenarioTree --------------------------*/
+/*--------------------------------------------------------------------------*/
+
+ScenarioTree::ScenarioTree( std::vector< double > && root )
+ : root( std::move( root ) ) , nodes( 1 ) {}
+
+/*--------------------------------------------------------------------------*/
+
+Index ScenarioTree::add_node( Index parent , Subset && positions ,
+                              std::vector< double > && values ,
+                              double probability ) {
+ if( parent >= nodes.size() )
+  throw( std::invalid_argument( "ScenarioTree::add_node: invalid parent" ) );
+ if( positions.size() != values.size() )
+  throw( std::invalid_argument( "ScenarioTree::add_node: positions and "
+                                "values have different sizes" ) );
+ for( auto position : positions )
+  if( position >= root.size() )
+   throw( std::invalid_argument( "ScenarioTree::add_node: invalid "
+                                 "position" ) );
+
+ const Index node = nodes.size();
+ nodes.emplace_back();
+ auto & new_node = nodes.back();
+ new_node.parent = parent;
+ new_node.stage = nodes[ parent ].stage + 1;
+ new_node.probability = probability;
+ new_node.positions = std::move( positions );
+ new_node.values = std::move( values );
+ nodes[ parent ].children.push_back( node );
+ return node;
+}
+
+/*--------------------------------------------------------------------------*/
+
+Subset ScenarioTree::get_leaves() const {
+ Subset leaves;
+ Subset stack( 1 , 0 );
+ while( ! stack.empty() ) {
+  const auto node = stack.back();
+  stack.pop_back();
+  const auto & children = nodes[ node ].children;
+  if( children.empty() )
+   leaves.push_back( node );
+  else  // in reverse, so that the first child is visited first
+   stack.insert( stack.end() , children.rbegin() , children.rend() );
+  }
+ return leaves;
+}
+
+/*--------------------------------------------------------------------------*/
+
+double ScenarioTree::get_probability( Index node ) const {
+ double probability = 1;
+ for( ; node != 0 ; node = nodes[ node ].parent )
+  probability *= nodes[ node ].probability;
+ return probability;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioTree::get_scenario( Index node , double * scenario ) const {
+ Subset path;
+ for( ; node != 0 ; node = nodes[ node ].parent )
+  path.push_back( node );
+
+ std::copy( root.begin() , root.end() , scenario );
+ for( auto n = path.rbegin() ; n != path.rend() ; ++n ) {
+  const auto & current = nodes[ *n ];
+  for( Index k = 0 ; k < current.positions.size() ; ++k )
+   scenario[ current.positions[ k ] ] = current.values[ k ];
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+std::size_t ScenarioTree::get_number_values() const {
+ std::size_t number = root.size();
+ for( const auto & node : nodes )
+  number += node.values.size();
+ return number;
+}
+
+/*--------------------------------------------------------------------------*/
+
+ScenarioSet ScenarioTree::get_scenario_set() const {
+ const auto leaves = get_leaves();
+ ScenarioSet scenario_set( get_dimension() , leaves.size() );
+ std::vector< double > probabilities( leaves.size() );
+ for( Index i = 0 ; i < leaves.size() ; ++i ) {
+  if( get_dimension() > 0 )
+   get_scenario( leaves[ i ] , & *scenario_set.get_scenario( i ) );
+  probabilities[ i ] = get_probability( leaves[ i ] );
+  }
+ scenario_set.set_probabilities( std::move( probabilities ) );
+ return scenario_set;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void ScenarioTree::traverse( StochasticBlock & block , const Visit & visit ,
+                             c_ModParam issuePMod ,
+                             c_ModParam issueAMod ) const {
+ std::vector< double > scenario( root );
+ block.set_data( scenario.cbegin() , issuePMod , issueAMod );
+ visit( block , 0 );
+
+ // the entries changed since the previous visit
+ std::vector< bool > changed( root.size() , false );
+ Subset changed_positions;
+ auto change = [ & ]( Index position ) {
+  if( ! changed[ position ] ) {
+   changed[ position ] = true;
+   changed_positions.push_back( position );
+   }
+ };
+
+ // the nodes along the current path, with the next child to be entered
+ std::vector< std::pair< Index , Index > > path( 1 , { 0 , 0 } );
+
+ // the values overwritten by the nodes along the current path
+ std::vector< double > saved;
+
+ while( ! path.empty() ) {
+  auto & [ node , next ] = path.back();
+  const auto & children = nodes[ node ].children;
+
+  if( next >= children.size() ) {  // leave the node
+   const auto & current = nodes[ node ];
+   for( auto k = current.positions.size() ; k-- > 0 ; ) {
+    scenario[ current.positions[ k ] ] = saved.back();
+    saved.pop_back();
+    change( current.positions[ k ] );
+    }
+   path.pop_back();
+   continue;
+   }
+
+  // enter the next child
+  const auto child = children[ next++ ];
+  const auto & current = nodes[ child ];
+  for( Index k = 0 ; k < current.positions.size() ; ++k ) {
+   const auto position = current.positions[ k ];
+   saved.push_back( scenario[ position ] );
+   scenario[ position ] = current.values[ k ];
+   change( position );
+   }
+
+  block.write_data_entries( changed_positions , scenario.cbegin() ,
+                            issuePMod , issueAMod );
+  for( auto position : changed_positions )
+   changed[ position ] = false;
+  changed_positions.clear();
+
+  visit( block , child );
+  path.emplace_back( child , 0 );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+/*----------------------- End File ScenarioTree.cpp ------------------------*/
+/*--------------------------------------------------------------------------*/
@@ -17,6 +17,17 @@
 /*--------------------------------------------------------------------------*/
 
 #include "StochasticBlock.h"
+#include "ParallelRun.h"
+
+#include <atomic>
+#include <climits>
+#include <numeric>
+#include <thread>
+#include <typeinfo>
+
+#if defined( __AVX__ )
+#include <immintrin.h>
+#endif
 
 /*--------------------------------------------------------------------------*/
 /*------------------------- NAMESPACE AND USING ----------------------------*/
@@ -24,6 +35,730 @@
 
 using namespace SMSpp_di_unipi_it;
 
+using Index = Block::Index;
+using Subset = Block::Subset;
+using Range = Block::Range;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------------- FUNCTIONS -------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+namespace {
+
+/// the number of Snapshot taken so far (by any StochasticBlock)
+
+std::atomic< std::size_t > snapshot_counter{ 0 };
+
+/*--------------------------------------------------------------------------*/
+
+/// returns the number of elements of the given Subset
+
+Index set_size( const Subset & set ) { return set.size(); }
+
+/// returns the number of elements of the given Range (Inf if unbounded)
+
+Index set_size( const Range & set ) {
+ if( set.second == Inf< Index >() )
+  return Inf< Index >();
+ return set.second > set.first ? set.second - set.first : 0;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// returns the first n elements of the given Subset, compressed
+
+CompressedSubset get_elements( const Subset & set , Index n ) {
+ if( n == set.size() )
+  return CompressedSubset( set );
+ return CompressedSubset( Subset( set.begin() , set.begin() + n ) );
+}
+
+/// returns the first n elements of the given Range, compressed
+
+CompressedSubset get_elements( const Range & set , Index n ) {
+ return CompressedSubset( Range( set.first , set.first + n ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// converts n contiguous values of a scenario into T
+/** The loops over plain (restrict) pointers are vectorized by the compiler;
+ * when AVX is available, the conversion to int is explicitly vectorized as
+ * well (truncating, as the conversion of the scalar loop does). */
+
+template< class T >
+void convert( const double * __restrict values , Index n ,
+              T * __restrict result ) {
+ if constexpr( std::is_same_v< T , double > ) {
+  std::copy_n( values , n , result );
+  return;
+  }
+ Index k = 0;
+#if defined( __AVX__ )
+ if constexpr( std::is_same_v< T , int > )
+  for( ; k + 4 <= n ; k += 4 )
+   _mm_storeu_si128( reinterpret_cast< __m128i * >( result + k ) ,
+                     _mm256_cvttpd_epi32( _mm256_loadu_pd( values + k ) ) );
+#endif
+ for( ; k < n ; ++k )
+  result[ k ] = T( values[ k ] );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// reads the values of a scenario at the given n positions, converted to T
+/** When AVX2 is available and the positions fit into an int (as told by
+ * \p small_positions), the values are read four at a time with the gather
+ * instruction; otherwise, the loop is left to the compiler. */
+
+template< class T >
+void gather( const double * __restrict values ,
+             const Index * __restrict positions , Index n ,
+             T * __restrict result , bool small_positions ) {
+ Index k = 0;
+#if defined( __AVX2__ )
+ if constexpr( sizeof( Index ) == sizeof( int ) )
+  if( small_positions )
+   for( ; k + 4 <= n ; k += 4 ) {
+    const auto indices = _mm_loadu_si128(
+     reinterpret_cast< const __m128i * >( positions + k ) );
+    // the masked form, since some compilers warn about the source of the
+    // unmasked one being uninitialized
+    const auto gathered = _mm256_mask_i32gather_pd(
+     _mm256_setzero_pd() , values , indices ,
+     _mm256_castsi256_pd( _mm256_set1_epi64x( -1 ) ) , 8 );
+    if constexpr( std::is_same_v< T , double > )
+     _mm256_storeu_pd( result + k , gathered );
+    else
+     _mm_storeu_si128( reinterpret_cast< __m128i * >( result + k ) ,
+                       _mm256_cvttpd_epi32( gathered ) );
+    }
+#endif
+ for( ; k < n ; ++k )
+  result[ k ] = T( values[ positions[ k ] ] );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// returns a Scatter for a SimpleDataMapping whose "to" set is a Subset
+
+template< class T , class F >
+auto make_scatter( const F & function , Block * block , const Subset & to ) {
+ const bool ordered = std::is_sorted( to.begin() , to.end() );
+ std::vector< T > buffer;
+
+ return [ function , block , ordered , buffer ]
+  ( std::vector< double >::const_iterator values , Subset && positions ,
+    c_ModParam issuePMod , c_ModParam issueAMod ) mutable {
+  if constexpr( std::is_same_v< T , double > )
+   function( block , values , std::move( positions ) , ordered ,
+             issuePMod , issueAMod );
+  else {
+   buffer.resize( positions.size() );
+   if( ! buffer.empty() )
+    convert( & *values , buffer.size() , buffer.data() );
+   function( block , buffer.cbegin() , std::move( positions ) , ordered ,
+             issuePMod , issueAMod );
+   }
+  };
+}
+
+/// returns a Scatter for a SimpleDataMapping whose "to" set is a Range
+/** Since the "to" set is a Range, the positions given to the Scatter are
+ * always increasing; they are split into maximal contiguous runs, each one
+ * being written with a single call to the method of the Block. The double
+ * values are given to the Block as they are, without any copy. */
+
+template< class T , class F >
+auto make_scatter( const F & function , Block * block , const Range & to ) {
+ std::vector< T > buffer;
+
+ return [ function , block , buffer ]
+  ( std::vector< double >::const_iterator values , Subset && positions ,
+    c_ModParam issuePMod , c_ModParam issueAMod ) mutable {
+  const Index n = positions.size();
+  auto converted = [ & ]() {
+   if constexpr( std::is_same_v< T , double > )
+    return values;
+   else {
+    buffer.resize( n );
+    if( n > 0 )
+     convert( & *values , n , buffer.data() );
+    return buffer.cbegin();
+    }
+  }();
+  for( Index k = 0 ; k < n ; ) {
+   Index h = k + 1;
+   while( ( h < n ) && ( positions[ h ] == positions[ h - 1 ] + 1 ) )
+    ++h;
+   function( block , converted + k ,
+             Range( positions[ k ] , positions[ h - 1 ] + 1 ) ,
+             issuePMod , issueAMod );
+   k = h;
+   }
+  };
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// the values of a scenario read by a step of a compiled plan
+/** A Gather reads from a scenario the values at the given positions,
+ * converted to T. The positions are kept as a CompressedSubset, and read
+ * segment by segment: the values at a run of positions are copied (and
+ * converted) with no index at all, and only the literal segments read
+ * their positions from memory. If the positions are contiguous and T is
+ * double, then the values are not copied at all: the iterator to the
+ * scenario is directly returned. */
+
+template< class T >
+class Gather {
+
+public:
+
+ explicit Gather( const Subset & from )
+  : from( from ) ,
+    small_positions( std::all_of( this->from.get_literals().begin() ,
+                                  this->from.get_literals().end() ,
+                                  []( Index k ) {
+                                   return k <= Index( INT_MAX ); } ) ) ,
+    buffer( this->from.size() ) {}
+
+ typename std::vector< T >::const_iterator operator()(
+  std::vector< double >::const_iterator scenario ) {
+  if constexpr( std::is_same_v< T , double > )
+   if( ( ! from.empty() ) && from.is_range() )
+    return scenario + from.get_segments().front().first;
+
+  auto result = buffer.data();
+  for( const auto & segment : from.get_segments() ) {
+   if( segment.is_literal() )
+    gather( & *scenario , from.get_literals().data() + segment.first ,
+            segment.length , result , small_positions );
+   else if( segment.stride == 1 )
+    convert( & scenario[ segment.first ] , segment.length , result );
+   else
+    for( Index k = 0 ; k < segment.length ; ++k )
+     result[ k ] = T( scenario[ segment[ k ] ] );
+   result += segment.length;
+   }
+  return buffer.cbegin();
+ }
+
+private:
+
+ CompressedSubset from;
+ bool small_positions;
+ std::vector< T > buffer;
+};
+
+/*--------------------------------------------------------------------------*/
+
+/// splits the given positions into maximal contiguous increasing runs
+
+std::vector< Range > get_runs( const Subset & positions ) {
+ std::vector< Range > runs;
+ for( Index k = 0 ; k < positions.size() ; ) {
+  Index h = k + 1;
+  while( ( h < positions.size() ) &&
+         ( positions[ h ] == positions[ h - 1 ] + 1 ) )
+   ++h;
+  runs.emplace_back( positions[ k ] , positions[ h - 1 ] + 1 );
+  k = h;
+  }
+ return runs;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// returns a step of a compiled plan calling a method taking a Range
+/** The returned step writes the values of the scenario at positions \p from
+ * into the positions \p to of the Block, which are split into maximal
+ * contiguous runs, each written with one call to \p function. The positions
+ * in \p to are assumed not to be repeated. */
+
+template< class T , class F >
+auto make_range_step( const F & function , Block * block , Subset && from ,
+                      Subset && to ) {
+ std::vector< Range > runs = get_runs( to );
+ Gather< T > gather( from );
+
+ return [ function , block , runs , gather ]
+  ( std::vector< double >::const_iterator scenario ,
+    c_ModParam issuePMod , c_ModParam issueAMod ) mutable {
+  auto values = gather( scenario );
+  for( const auto & run : runs ) {
+   function( block , values , run , issuePMod , issueAMod );
+   values += run.second - run.first;
+   }
+  };
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// returns a step of a compiled plan calling a method taking a Subset
+/** The returned step writes the values of the scenario at positions \p from
+ * into the positions \p to of the Block with a single call to \p function.
+ * If the positions \p to are contiguous and the Block also has a method
+ * with the given name taking a Range, that one is used instead, so that no
+ * Subset needs to be passed at all; otherwise, the positions \p to are kept
+ * compressed, and decompressed into the Subset passed at each call. */
+
+template< class T , class F >
+StochasticBlock::ScatterStep make_subset_step(
+ const F & function , Block * block , const std::string & name ,
+ Subset && from , Subset && to ) {
+ CompressedSubset compressed_to( to );
+ if( ( ! name.empty() ) && ( ! to.empty() ) && compressed_to.is_range() ) {
+  using RangeFunction =
+   typename SimpleDataMapping< Subset , Range , T >::FunctionType;
+  RangeFunction range_function;
+  try {
+   range_function = Block::get_method< RangeFunction >( name );
+   }
+  catch( ... ) {}  // the Block has no such method: use the Subset one
+  if( range_function )
+   return make_range_step< T >( range_function , block , std::move( from ) ,
+                                std::move( to ) );
+  }
+
+ const bool ordered = compressed_to.is_sorted();
+ Gather< T > gather( from );
+ Subset positions;
+ positions.reserve( to.size() );
+
+ return [ function , block , ordered , to = std::move( compressed_to ) ,
+          gather , positions ]
+  ( std::vector< double >::const_iterator scenario ,
+    c_ModParam issuePMod , c_ModParam issueAMod ) mutable {
+  // the method may take the Subset away; if it does not, then its memory
+  // is reused the next time
+  positions.resize( to.size() );
+  to.decompress( positions.data() );
+  function( block , gather( scenario ) , std::move( positions ) , ordered ,
+            issuePMod , issueAMod );
+  };
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// returns a StepBuilder for a SimpleDataMapping whose "to" set is a Subset
+
+template< class T , class F >
+auto make_step_builder( const F & function , Block * block ,
+                        const std::string & name , const Subset & ) {
+ return [ function , block , name ]( Subset && from , Subset && to ) {
+  return make_subset_step< T >( function , block , name , std::move( from ) ,
+                                std::move( to ) );
+  };
+}
+
+/// returns a StepBuilder for a SimpleDataMapping whose "to" set is a Range
+
+template< class T , class F >
+auto make_step_builder( const F & function , Block * block ,
+                        const std::string & , const Range & ) {
+ return [ function , block ]( Subset && from , Subset && to ) {
+  return StochasticBlock::ScatterStep(
+   make_range_step< T >( function , block , std::move( from ) ,
+                         std::move( to ) ) );
+  };
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// computes the layout of a SimpleDataMapping< SetFrom , SetTo , T >
+/** If the given SimpleDataMappingBase is a SimpleDataMapping< SetFrom ,
+ * SetTo , T >, this function fills the given DataMappingLayout and returns
+ * true. Otherwise, it returns false. */
+
+template< class SetFrom , class SetTo , class T , class Layout >
+bool get_layout( const SimpleDataMappingBase * data_mapping ,
+                 Layout & layout ) {
+ auto mapping = dynamic_cast< const SimpleDataMapping< SetFrom , SetTo , T > * >
+  ( data_mapping );
+ if( ! mapping )
+  return false;
+
+ const auto & from = mapping->get_set_from();
+ const auto & to = mapping->get_set_to();
+ const auto n = std::min( set_size( from ) , set_size( to ) );
+ if( n == Inf< Index >() )
+  return false;  // both sets are unbounded: the layout is unknown
+
+ layout.from = get_elements( from , n );
+ layout.to = get_elements( to , n );
+ layout.scatter = make_scatter< T >( mapping->get_function() ,
+                                     mapping->get_block() , to );
+ layout.build_step = make_step_builder< T >( mapping->get_function() ,
+                                             mapping->get_block() ,
+                                             mapping->get_function_name() ,
+                                             to );
+ layout.block = mapping->get_block();
+ layout.function_name = mapping->get_function_name();
+ layout.int_data = std::is_same_v< T , int >;
+ layout.range_target = std::is_same_v< SetTo , Range >;
+ return true;
+}
+
+/// computes the layout of any SimpleDataMapping< SetFrom , SetTo , T >
+
+template< class Layout >
+bool get_layout( const SimpleDataMappingBase * data_mapping ,
+                 Layout & layout ) {
+ return get_layout< Subset , Subset , double >( data_mapping , layout ) ||
+        get_layout< Subset , Range , double >( data_mapping , layout ) ||
+        get_layout< Range , Subset , double >( data_mapping , layout ) ||
+        get_layout< Range , Range , double >( data_mapping , layout ) ||
+        get_layout< Subset , Subset , int >( data_mapping , layout ) ||
+        get_layout< Subset , Range , int >( data_mapping , layout ) ||
+        get_layout< Range , Subset , int >( data_mapping , layout ) ||
+        get_layout< Range , Range , int >( data_mapping , layout );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// copies a SimpleDataMapping< SetFrom , SetTo , T >, rebinding its Block
+/** If the given SimpleDataMappingBase is a SimpleDataMapping< SetFrom ,
+ * SetTo , T >, this function returns a copy of it writing into the given
+ * Block. Otherwise, it returns nullptr. */
+
+template< class SetFrom , class SetTo , class T >
+std::unique_ptr< SimpleDataMappingBase > rebind(
+ const SimpleDataMappingBase * data_mapping , Block * block ) {
+ auto mapping = dynamic_cast< const SimpleDataMapping< SetFrom , SetTo , T > * >
+  ( data_mapping );
+ if( ! mapping )
+  return nullptr;
+ return std::make_unique< SimpleDataMapping< SetFrom , SetTo , T > >
+  ( mapping->get_function() , block , mapping->get_set_from() ,
+    mapping->get_set_to() , mapping->get_function_name() );
+}
+
+/// copies any SimpleDataMapping< SetFrom , SetTo , T >, rebinding its Block
+
+std::unique_ptr< SimpleDataMappingBase > rebind(
+ const SimpleDataMappingBase * data_mapping , Block * block ) {
+ std::unique_ptr< SimpleDataMappingBase > copy;
+ ( copy = rebind< Subset , Subset , double >( data_mapping , block ) ) ||
+ ( copy = rebind< Subset , Range , double >( data_mapping , block ) ) ||
+ ( copy = rebind< Range , Subset , double >( data_mapping , block ) ) ||
+ ( copy = rebind< Range , Range , double >( data_mapping , block ) ) ||
+ ( copy = rebind< Subset , Subset , int >( data_mapping , block ) ) ||
+ ( copy = rebind< Subset , Range , int >( data_mapping , block ) ) ||
+ ( copy = rebind< Range , Subset , int >( data_mapping , block ) ) ||
+ ( copy = rebind< Range , Range , int >( data_mapping , block ) );
+ return copy;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// computes the path of nested Blocks leading from root to block
+/** Stores into \p path the indices of the nested Blocks to be followed
+ * from \p root to reach \p block (nothing if they are the same Block) and
+ * returns true, or returns false if \p block is not \p root or one of its
+ * (recursively) nested Blocks. */
+
+bool get_path( Block * block , Block * root , Subset & path ) {
+ path.clear();
+ for( Block * current = block ; current != root ; ) {
+  if( ! current )
+   return false;
+  auto father = current->get_f_Block();
+  if( ! father )
+   return false;
+  const auto & nested = father->get_nested_Blocks();
+  auto position = std::find( nested.begin() , nested.end() , current );
+  if( position == nested.end() )
+   return false;
+  path.push_back( position - nested.begin() );
+  current = father;
+  }
+ std::reverse( path.begin() , path.end() );
+ return true;
+}
+
+/// returns the Block reached from root by following the given path
+/** Returns the Block reached from \p root by following the given \p path
+ * of nested Blocks, throwing std::logic_error (with the given message) if
+ * some index is out of range. */
+
+Block * follow_path( Block * root , Subset::const_iterator begin ,
+                     Subset::const_iterator end , const char * message ) {
+ for( ; begin != end ; ++begin ) {
+  if( *begin >= root->get_number_nested_Blocks() )
+   throw( std::logic_error( message ) );
+  root = root->get_nested_Block( *begin );
+  }
+ return root;
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// returns the Block of copy corresponding to the given Block of original
+/** Returns the Block reached from \p copy by following the same path of
+ * nested Blocks that leads from \p original to \p block, or \p block
+ * itself if it is not a (nested) Block of \p original. */
+
+Block * corresponding_block( Block * block , Block * original ,
+                             Block * copy ) {
+ Subset path;
+ if( ! get_path( block , original , path ) )
+  return block;
+ return follow_path( copy , path.cbegin() , path.cend() ,
+                     "StochasticBlock::get_R3_Block: the copy of the inner "
+                     "Block has a different structure" );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// the variables of the "DataMappings" group (see serialize())
+/** A SerializedDataMappings holds the values of the variables of the
+ * "DataMappings" group described in StochasticBlock::serialize(), in the
+ * same order. */
+
+struct SerializedDataMappings {
+ std::vector< int > type;   ///< the "Type" of each data mapping
+ Subset from_size;          ///< the "SetFromSize" of each data mapping
+ Subset from_elements;      ///< the "SetFromElements" of all of them
+ Subset to_size;            ///< the "SetToSize" of each data mapping
+ Subset to_elements;        ///< the "SetToElements" of all of them
+ Subset path_size;          ///< the "BlockPathSize" of each data mapping
+ Subset path;               ///< the "BlockPath" of all of them
+ Subset name_size;          ///< the "FunctionNameSize" of each data mapping
+ std::vector< char > name;  ///< the "FunctionName" of all of them
+};
+
+/// the bits of the "Type" of a data mapping (see serialize())
+
+enum TypeBits { eRangeFrom = 1 , eRangeTo = 2 , eIntData = 4 ,
+                eEncodedFrom = 8 , eEncodedTo = 16 };
+
+/*--------------------------------------------------------------------------*/
+
+/// appends the given Subset to the given sizes and elements
+/** The Subset is appended as encoded by CompressedSubset::encode() if this
+ * is shorter, in which case true is returned; otherwise, its elements are
+ * appended as they are, and false is returned. */
+
+bool put_set( const Subset & set , Subset & size , Subset & elements ) {
+ CompressedSubset compressed( set );
+ if( compressed.encoded_size() < set.size() ) {
+  const auto start = elements.size();
+  compressed.encode( elements );
+  size.push_back( elements.size() - start );
+  return true;
+  }
+ size.push_back( set.size() );
+ elements.insert( elements.end() , set.begin() , set.end() );
+ return false;
+}
+
+/// appends the given Range (as its two ends) to the given sizes and elements
+
+bool put_set( const Range & set , Subset & size , Subset & elements ) {
+ size.push_back( 2 );
+ elements.push_back( set.first );
+ elements.push_back( set.second );
+ return false;
+}
+
+/// reads a Subset of the given size out of the given elements
+/** If \p encoded, the elements are the ones written by
+ * CompressedSubset::encode(). */
+
+void get_set( Subset::const_iterator elements , Index size , bool encoded ,
+              Subset & set ) {
+ if( encoded )
+  set = CompressedSubset::decode( elements , size );
+ else
+  set.assign( elements , elements + size );
+}
+
+/// reads a Range (out of its two ends) out of the given elements
+
+void get_set( Subset::const_iterator elements , Index size , bool encoded ,
+              Range & set ) {
+ if( encoded || ( size != 2 ) )
+  throw( std::logic_error( "StochasticBlock::deserialize: a Range set of a "
+                           "data mapping has not two elements" ) );
+ set = Range( elements[ 0 ] , elements[ 1 ] );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// appends a SimpleDataMapping< SetFrom , SetTo , T > to the given variables
+/** If the given SimpleDataMappingBase is a SimpleDataMapping< SetFrom ,
+ * SetTo , T > with a function name, whose Block is (a nested Block of) \p
+ * inner_block, this function appends it to \p serialized and returns true.
+ * Otherwise, it returns false (and \p serialized is not changed). */
+
+template< class SetFrom , class SetTo , class T >
+bool put_data_mapping( const SimpleDataMappingBase * data_mapping ,
+                       Block * inner_block ,
+                       SerializedDataMappings & serialized ) {
+ auto mapping = dynamic_cast< const SimpleDataMapping< SetFrom , SetTo , T > * >
+  ( data_mapping );
+ if( ! mapping )
+  return false;
+
+ Subset path;
+ const auto & name = mapping->get_function_name();
+ if( name.empty() || ( ! get_path( mapping->get_block() , inner_block ,
+                                   path ) ) )
+  return false;
+
+ int type = ( std::is_same_v< SetFrom , Range > ? eRangeFrom : 0 ) |
+            ( std::is_same_v< SetTo , Range > ? eRangeTo : 0 ) |
+            ( std::is_same_v< T , int > ? eIntData : 0 );
+ if( put_set( mapping->get_set_from() , serialized.from_size ,
+              serialized.from_elements ) )
+  type |= eEncodedFrom;
+ if( put_set( mapping->get_set_to() , serialized.to_size ,
+              serialized.to_elements ) )
+  type |= eEncodedTo;
+ serialized.type.push_back( type );
+ serialized.path_size.push_back( path.size() );
+ serialized.path.insert( serialized.path.end() , path.begin() , path.end() );
+ serialized.name_size.push_back( name.size() );
+ serialized.name.insert( serialized.name.end() , name.begin() , name.end() );
+ return true;
+}
+
+/// appends any SimpleDataMapping< SetFrom , SetTo , T > to the variables
+
+bool put_data_mapping( const SimpleDataMappingBase * data_mapping ,
+                       Block * inner_block ,
+                       SerializedDataMappings & serialized ) {
+ return
+  put_data_mapping< Subset , Subset , double >( data_mapping , inner_block ,
+                                                serialized ) ||
+  put_data_mapping< Subset , Range , double >( data_mapping , inner_block ,
+                                               serialized ) ||
+  put_data_mapping< Range , Subset , double >( data_mapping , inner_block ,
+                                               serialized ) ||
+  put_data_mapping< Range , Range , double >( data_mapping , inner_block ,
+                                              serialized ) ||
+  put_data_mapping< Subset , Subset , int >( data_mapping , inner_block ,
+                                             serialized ) ||
+  put_data_mapping< Subset , Range , int >( data_mapping , inner_block ,
+                                            serialized ) ||
+  put_data_mapping< Range , Subset , int >( data_mapping , inner_block ,
+                                            serialized ) ||
+  put_data_mapping< Range , Range , int >( data_mapping , inner_block ,
+                                           serialized );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// builds a SimpleDataMapping< SetFrom , SetTo , T > out of its sets
+/** Builds a SimpleDataMapping< SetFrom , SetTo , T > writing into \p block
+ * with the method of the given name, whose sets have the given sizes and
+ * start at the given elements (encoded as told by the given "Type"). */
+
+template< class SetFrom , class SetTo , class T >
+std::unique_ptr< SimpleDataMappingBase > make_data_mapping(
+ int type , Block * block , std::string && name ,
+ Subset::const_iterator from_elements , Index from_size ,
+ Subset::const_iterator to_elements , Index to_size ) {
+ using Mapping = SimpleDataMapping< SetFrom , SetTo , T >;
+ SetFrom from;
+ get_set( from_elements , from_size , type & eEncodedFrom , from );
+ SetTo to;
+ get_set( to_elements , to_size , type & eEncodedTo , to );
+ auto function = Block::get_method< typename Mapping::FunctionType >( name );
+ return std::make_unique< Mapping >( function , block , std::move( from ) ,
+                                     std::move( to ) , std::move( name ) );
+}
+
+/// builds the SimpleDataMapping of the given "Type" (see serialize())
+
+std::unique_ptr< SimpleDataMappingBase > make_data_mapping(
+ int type , Block * block , std::string && name ,
+ Subset::const_iterator from_elements , Index from_size ,
+ Subset::const_iterator to_elements , Index to_size ) {
+ switch( type & ~( eEncodedFrom | eEncodedTo ) ) {
+  case 0:
+   return make_data_mapping< Subset , Subset , double >(
+    type , block , std::move( name ) , from_elements , from_size ,
+    to_elements , to_size );
+  case eRangeTo:
+   return make_data_mapping< Subset , Range , double >(
+    type , block , std::move( name ) , from_elements , from_size ,
+    to_elements , to_size );
+  case eRangeFrom:
+   return make_data_mapping< Range , Subset , double >(
+    type , block , std::move( name ) , from_elements , from_size ,
+    to_elements , to_size );
+  case eRangeFrom | eRangeTo:
+   return make_data_mapping< Range , Range , double >(
+    type , block , std::move( name ) , from_elements , from_size ,
+    to_elements , to_size );
+  case eIntData:
+   return make_data_mapping< Subset , Subset , int >(
+    type , block , std::move( name ) , from_elements , from_size ,
+    to_elements , to_size );
+  case eIntData | eRangeTo:
+   return make_data_mapping< Subset , Range , int >(
+    type , block , std::move( name ) , from_elements , from_size ,
+    to_elements , to_size );
+  case eIntData | eRangeFrom:
+   return make_data_mapping< Range , Subset , int >(
+    type , block , std::move( name ) , from_elements , from_size ,
+    to_elements , to_size );
+  case eIntData | eRangeFrom | eRangeTo:
+   return make_data_mapping< Range , Range , int >(
+    type , block , std::move( name ) , from_elements , from_size ,
+    to_elements , to_size );
+  }
+ throw( std::logic_error( "StochasticBlock::deserialize: unknown Type of a "
+                          "data mapping" ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// writes the given values as a variable of the given group
+/** Writes the given values as the variable \p name of type \p type of the
+ * given group, over a new dimension \p dimension; nothing is written if
+ * there is no value (a netCDF dimension of size zero would be unlimited). */
+
+template< class T >
+void put_variable( netCDF::NcGroup & group , const std::string & name ,
+                   const netCDF::NcType & type , const std::string & dimension ,
+                   const std::vector< T > & values ) {
+ if( ! values.empty() )
+  group.addVar( name , type , group.addDim( dimension , values.size() ) )
+   .putVar( values.data() );
+}
+
+/// writes the given values as a variable over an existing dimension
+
+template< class T >
+void put_variable( netCDF::NcGroup & group , const std::string & name ,
+                   const netCDF::NcType & type ,
+                   const netCDF::NcDim & dimension ,
+                   const std::vector< T > & values ) {
+ group.addVar( name , type , dimension ).putVar( values.data() );
+}
+
+/// reads the variable of the given name, having the given number of values
+/** Reads the variable \p name of the given group, which has \p size values
+ * (and may be absent only if \p size is zero), into \p values. */
+
+template< class T >
+void get_variable( const netCDF::NcGroup & group , const std::string & name ,
+                   std::size_t size , std::vector< T > & values ) {
+ values.resize( size );
+ if( size == 0 )
+  return;
+ auto variable = group.getVar( name );
+ if( variable.isNull() )
+  throw( std::logic_error( "StochasticBlock::deserialize: variable '" + name +
+                           "' is missing." ) );
+ variable.getVar( values.data() );
+}
+
+}  // end( unnamed namespace )
+
 /*--------------------------------------------------------------------------*/
 /*----------------------------- STATIC MEMBERS -----------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -39,6 +774,39 @@ SMSpp_insert_in_factory_cpp_1( StochasticBlock );
 /*--------------------------------------------------------------------------*/
 
 void StochasticBlock::deserialize( const netCDF::NcGroup & group ) {
+ lazy.reset();
+ if( ! lazy_deserialization.load() )
+  deserialize_inner_block( group );
+ else {
+  // drop now what deserialize_inner_block() will replace: the data
+  // mappings and, if the group has one, the previous inner Block
+  if( ( ! group.getGroup( "Block" ).isNull() ) && ( ! v_Block.empty() ) ) {
+   delete v_Block.front();
+   v_Block.clear();
+   }
+  data_mappings.clear();
+  layouts_valid = false;
+  reset_last_scenario();
+  discard_pending_data();
+  lazy = std::make_unique< LazyDeserialization >();
+  lazy->group = group;
+  }
+
+ auto scenario_set_group = group.getGroup( "ScenarioSet" );
+ if( ! scenario_set_group.isNull() ) {
+  scenario_set = std::make_unique< ScenarioSet >();
+  scenario_set->deserialize( scenario_set_group );
+  }
+ else
+  scenario_set.reset();
+
+ Block::deserialize( group );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::deserialize_inner_block( const netCDF::NcGroup & group )
+{
  auto inner_block_group = group.getGroup( "Block" );
  if( ! inner_block_group.isNull() ) {
 
@@ -47,10 +815,21 @@ void StochasticBlock::deserialize( const netCDF::NcGroup & group ) {
    throw std::logic_error( "StochasticBlock::deserialize: the 'Block' "
                            "group is present but its description is "
                            "incomplete." );
-  set_inner_block( inner_block );
+  replace_inner_block( inner_block , true );
  }
 
  data_mappings.clear();
+ layouts_valid = false;
+ reset_last_scenario();
+ discard_pending_data();
+
+ auto data_mappings_group = group.getGroup( "DataMappings" );
+ if( ! data_mappings_group.isNull() ) {
+  deserialize_data_mappings( data_mappings_group );
+  return;
+  }
+
+ // the format of the SMS++ core (see serialize())
  Index num_data_mappings;
  if( ::SMSpp_di_unipi_it::deserialize_dim( group , "NumberDataMappings" ,
                                            num_data_mappings , true ) &&
@@ -59,8 +838,658 @@ void StochasticBlock::deserialize( const netCDF::NcGroup & group ) {
   assert( v_Block.size() == 1 && v_Block.front() );
   SimpleDataMappingBase::deserialize( group , data_mappings , v_Block.front() );
  }
+}
 
- Block::deserialize( group );
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::deserialize_data_mappings(
+ const netCDF::NcGroup & group ) {
+ Index number;
+ if( ! ::SMSpp_di_unipi_it::deserialize_dim( group , "NumberDataMappings" ,
+                                             number , true ) )
+  throw( std::logic_error( "StochasticBlock::deserialize: dimension "
+                           "'NumberDataMappings' is missing." ) );
+ if( number == 0 )
+  return;
+ if( v_Block.empty() || ( ! v_Block.front() ) )
+  throw( std::logic_error( "StochasticBlock::deserialize: there are data "
+                           "mappings but no inner Block." ) );
+ Block * inner_block = v_Block.front();
+
+ // the netCDF library is not thread-safe: all the reads are done here
+ SerializedDataMappings serialized;
+ get_variable( group , "Type" , number , serialized.type );
+ get_variable( group , "SetFromSize" , number , serialized.from_size );
+ get_variable( group , "SetToSize" , number , serialized.to_size );
+ get_variable( group , "BlockPathSize" , number , serialized.path_size );
+ get_variable( group , "FunctionNameSize" , number , serialized.name_size );
+
+ // where the elements of each data mapping start
+ auto starts = []( const Subset & size ) {
+  Subset start( size.size() + 1 , 0 );
+  std::partial_sum( size.begin() , size.end() , start.begin() + 1 );
+  return start;
+ };
+ const auto from_start = starts( serialized.from_size );
+ const auto to_start = starts( serialized.to_size );
+ const auto path_start = starts( serialized.path_size );
+ const auto name_start = starts( serialized.name_size );
+
+ get_variable( group , "SetFromElements" , from_start.back() ,
+               serialized.from_elements );
+ get_variable( group , "SetToElements" , to_start.back() ,
+               serialized.to_elements );
+ get_variable( group , "BlockPath" , path_start.back() , serialized.path );
+ get_variable( group , "FunctionName" , name_start.back() , serialized.name );
+
+ // the data mappings are then built in chunks handed out to the threads,
+ // each one building distinct elements of data_mappings
+ data_mappings.resize( number );
+ auto decode = [ & ]( Index begin , Index end ) {
+  for( Index i = begin ; i < end ; ++i ) {
+   auto block = follow_path( inner_block ,
+                             serialized.path.cbegin() + path_start[ i ] ,
+                             serialized.path.cbegin() + path_start[ i + 1 ] ,
+                             "StochasticBlock::deserialize: the Block of a "
+                             "data mapping does not exist" );
+   std::string name( serialized.name.begin() + name_start[ i ] ,
+                     serialized.name.begin() + name_start[ i + 1 ] );
+   data_mappings[ i ] = make_data_mapping(
+    serialized.type[ i ] , block , std::move( name ) ,
+    serialized.from_elements.cbegin() + from_start[ i ] ,
+    serialized.from_size[ i ] ,
+    serialized.to_elements.cbegin() + to_start[ i ] ,
+    serialized.to_size[ i ] );
+   }
+  };
+
+ const Index chunk = 64;
+ const Index number_chunks = ( number + chunk - 1 ) / chunk;
+ Index number_threads = deserialization_threads.load();
+ if( number_threads == 0 )
+  number_threads = std::max( std::thread::hardware_concurrency() , 1u );
+ number_threads = std::min( number_threads , number_chunks );
+
+ std::atomic< Index > next_chunk( 0 );
+ try {
+  run_in_parallel( number_threads ,
+                   [ & ]( Index , const std::atomic< bool > & failed ) {
+   for( Index c ; ( ! failed.load( std::memory_order_relaxed ) ) &&
+                  ( ( c = next_chunk++ ) < number_chunks ) ; )
+    decode( c * chunk , std::min( number , ( c + 1 ) * chunk ) );
+   } );
+  }
+ catch( ... ) {
+  data_mappings.clear();
+  throw;
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+/*-------------- METHODS FOR MODIFYING THE StochasticBlock -----------------*/
+/*--------------------------------------------------------------------------*/
+
+Block * StochasticBlock::get_R3_Block( Configuration * r3bc , Block * base ,
+                                       Block * father ) {
+ complete_deserialization();
+
+ StochasticBlock * copy = nullptr;
+ if( base ) {
+  copy = dynamic_cast< StochasticBlock * >( base );
+  if( ! copy )
+   throw( std::invalid_argument( "StochasticBlock::get_R3_Block: base is "
+                                 "not a StochasticBlock" ) );
+  }
+ else
+  copy = new StochasticBlock( father );
+
+ try {
+  auto inner_block = get_inner_block();
+  copy->set_inner_block( inner_block ?
+                         inner_block->get_R3_Block( r3bc , nullptr , copy ) :
+                         nullptr );
+
+  std::vector< std::unique_ptr< SimpleDataMappingBase > > mappings;
+  mappings.reserve( data_mappings.size() );
+  for( const auto & data_mapping : data_mappings ) {
+   auto block = data_mapping->get_block();
+   mappings.push_back( rebind( data_mapping.get() ,
+                               corresponding_block( block , inner_block ,
+                                                    copy->get_inner_block() )
+                               ) );
+   if( ! mappings.back() )
+    throw( std::logic_error( "StochasticBlock::get_R3_Block: a data mapping "
+                             "of unknown type cannot be copied" ) );
+   }
+  copy->set_data_mappings( std::move( mappings ) );
+  }
+ catch( ... ) {
+  if( ! base )
+   delete copy;
+  throw;
+  }
+
+ if( scenario_set )
+  copy->set_scenario_set( std::make_unique< ScenarioSet >( *scenario_set ) );
+ copy->delta_mode = delta_mode;
+ copy->compile_data_mappings( compiled );
+ copy->deferred_mode = deferred_mode;
+ copy->group_modifications = group_modifications;
+ return copy;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::set_expected_data( c_ModParam issuePMod ,
+                                         c_ModParam issueAMod ) {
+ if( ( ! scenario_set ) || scenario_set->empty() )
+  throw( std::logic_error( "StochasticBlock::set_expected_data: there is "
+                           "no scenario" ) );
+ ScenarioStatistics statistics( scenario_set->get_dimension() , 0 );
+ statistics.add( *scenario_set );
+ set_data( statistics.get_mean() , issuePMod , issueAMod );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::set_quantile_data( double p , c_ModParam issuePMod ,
+                                         c_ModParam issueAMod ) {
+ if( ( ! scenario_set ) || scenario_set->empty() )
+  throw( std::logic_error( "StochasticBlock::set_quantile_data: there is "
+                           "no scenario" ) );
+ // as many cells as scenarios: the quantiles are exact
+ ScenarioStatistics statistics( scenario_set->get_dimension() ,
+                                scenario_set->size() );
+ statistics.add( *scenario_set );
+ set_data( statistics.get_quantile( p ) , issuePMod , issueAMod );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::set_data_delta( std::vector< double >::const_iterator data ,
+                                      c_ModParam issuePMod ,
+                                      c_ModParam issueAMod ) {
+ const bool full = last_scenario.size() != scenario_dimension;
+
+ for( Index i = 0 ; i < layouts.size() ; ++i ) {
+  const auto & layout = layouts[ i ];
+  if( ( ! layout.scatter ) || layout.from.empty() )
+   continue;  // an opaque (or empty) data mapping
+
+  if( full ) {
+   set_data_mapping( i , data , issuePMod , issueAMod );
+   continue;
+   }
+
+  // find the positions (in the layout) of the changed entries, and then
+  // the corresponding positions in the Block
+  changed_values.clear();
+  changed_positions.clear();
+  Index k = 0;
+  layout.from.for_each( [ & ]( Index from ) {
+   const auto value = data[ from ];
+   if( value != last_scenario[ from ] ) {
+    changed_values.push_back( value );
+    changed_positions.push_back( k );
+    if( snapshot_id )
+     track_written( i , k );
+    }
+   ++k;
+   } );
+  layout.to.translate( changed_positions );
+
+  if( changed_positions.empty() )
+   continue;
+
+  if( changed_positions.size() == layout.from.size() )
+   set_data_mapping( i , data , issuePMod , issueAMod );
+  else if( ! statistics )
+   layout.scatter( changed_values.cbegin() , Subset( changed_positions ) ,
+                   issuePMod , issueAMod );
+  else {
+   const auto start = Statistics::Clock::now();
+   layout.scatter( changed_values.cbegin() , Subset( changed_positions ) ,
+                   issuePMod , issueAMod );
+   statistics->add( i , changed_positions.size() , start );
+   }
+  }
+
+ last_scenario.assign( data , data + scenario_dimension );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::update_layouts() {
+ if( layouts_valid )
+  return;
+
+ complete_deserialization();
+
+ layouts.clear();
+ layouts.resize( data_mappings.size() );
+ snapshot_id = 0;
+ entry_start.clear();
+ opaque_mappings.clear();
+ scenario_dimension = 0;
+
+ for( Index i = 0 ; i < data_mappings.size() ; ++i ) {
+  auto & layout = layouts[ i ];
+  if( ! get_layout( data_mappings[ i ].get() , layout ) ) {
+   layout = DataMappingLayout();
+   opaque_mappings.push_back( i );
+   continue;
+   }
+  if( ! layout.function_name.empty() ) {
+   const auto & getters = get_getters();
+   auto getter = getters.find( { layout.function_name , layout.int_data } );
+   if( getter != getters.end() )
+    layout.get = getter->second;
+   }
+  if( ! layout.from.empty() )
+   scenario_dimension = std::max( scenario_dimension ,
+                                  1 + layout.from.max() );
+  }
+
+ layouts_valid = true;
+
+ if( compiled )
+  build_plan();
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::build_plan() {
+ plan.clear();
+ plan_mappings.clear();
+
+ std::vector< bool > merged( layouts.size() , false );
+ for( Index i = 0 ; i < layouts.size() ; ++i ) {
+  const auto & layout = layouts[ i ];
+  if( merged[ i ] || ( ! layout.build_step ) || layout.from.empty() )
+   continue;
+
+  Subset from( layout.from.decompress() );
+  Subset to( layout.to.decompress() );
+  Subset mappings( 1 , i );
+
+  // merge all the following data mappings calling the same method
+  if( ! layout.function_name.empty() )
+   for( Index j = i + 1 ; j < layouts.size() ; ++j ) {
+    const auto & other = layouts[ j ];
+    if( merged[ j ] || ( ! other.build_step ) ||
+        ( other.block != layout.block ) ||
+        ( other.int_data != layout.int_data ) ||
+        ( other.range_target != layout.range_target ) ||
+        ( other.function_name != layout.function_name ) )
+     continue;
+    from.insert( from.end() , other.from.begin() , other.from.end() );
+    to.insert( to.end() , other.to.begin() , other.to.end() );
+    mappings.push_back( j );
+    merged[ j ] = true;
+    }
+
+  plan.push_back( layout.build_step( std::move( from ) , std::move( to ) ) );
+  plan_mappings.push_back( std::move( mappings ) );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::set_data_plan( std::vector< double >::const_iterator data ,
+                                     c_ModParam issuePMod ,
+                                     c_ModParam issueAMod ,
+                                     bool only_changed ) {
+ for( Index s = 0 ; s < plan.size() ; ++s ) {
+  if( only_changed && std::none_of( plan_mappings[ s ].begin() ,
+                                    plan_mappings[ s ].end() ,
+                                    [ this ]( Index i ) {
+                                     return changed_mappings[ i ];
+                                    } ) )
+   continue;
+
+  if( snapshot_id )
+   for( auto i : plan_mappings[ s ] )
+    track_written( i );
+
+  if( ! statistics ) {
+   plan[ s ]( data , issuePMod , issueAMod );
+   continue;
+   }
+
+  const auto start = Statistics::Clock::now();
+  plan[ s ]( data , issuePMod , issueAMod );
+  const double time = std::chrono::duration< double >(
+   Statistics::Clock::now() - start ).count();
+
+  // split the time among the merged data mappings by number of elements
+  std::size_t total = 0;
+  for( auto i : plan_mappings[ s ] )
+   total += layouts[ i ].from.size();
+  for( auto i : plan_mappings[ s ] ) {
+   const auto n = layouts[ i ].from.size();
+   statistics->elements[ i ] += n;
+   statistics->time[ i ] += total ? time * n / total : 0;
+   }
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::set_data_deferred(
+ std::vector< double >::const_iterator data , c_ModParam issuePMod ,
+ c_ModParam issueAMod ) {
+ pending_pmod = issuePMod;
+ pending_amod = issueAMod;
+
+ if( pending_scenario.size() != scenario_dimension ) {
+  pending_scenario.assign( data , data + scenario_dimension );
+  changed_entries.assign( scenario_dimension , true );
+  pending = true;
+  return;
+  }
+
+ for( Index k = 0 ; k < scenario_dimension ; ++k )
+  if( data[ k ] != pending_scenario[ k ] ) {
+   pending_scenario[ k ] = data[ k ];
+   changed_entries[ k ] = true;
+   pending = true;
+   }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::flush_data() {
+ // the writes are counted, but the set_data() call was already counted
+ if( statistics )
+  size_statistics();
+
+ if( ! pending )
+  return;
+
+ update_layouts();
+ assert( pending_scenario.size() == scenario_dimension );
+ const auto data = pending_scenario.cbegin();
+
+ issue_grouped( pending_pmod , pending_amod ,
+                [ & ]( c_ModParam pmod , c_ModParam amod ) {
+  if( delta_mode ) {  // the delta mode finds the changed entries by itself
+   set_data_delta( data , pmod , amod );
+   return;
+   }
+  changed_mappings.assign( layouts.size() , false );
+  for( Index i = 0 ; i < layouts.size() ; ++i )
+   changed_mappings[ i ] = std::any_of( layouts[ i ].from.begin() ,
+                                        layouts[ i ].from.end() ,
+                                        [ this ]( Index k ) {
+                                         return changed_entries[ k ];
+                                        } );
+  if( compiled )
+   set_data_plan( data , pmod , amod , true );
+  else
+   for( Index i = 0 ; i < layouts.size() ; ++i )
+    if( changed_mappings[ i ] )
+     set_data_mapping( i , data , pmod , amod );
+ } );
+
+ changed_entries.assign( scenario_dimension , false );
+ pending = false;
+}
+
+/*--------------------------------------------------------------------------*/
+
+bool StochasticBlock::store_solution(
+ std::vector< double >::const_iterator scenario ) {
+ if( ! warm_start_cache )
+  throw( std::logic_error( "StochasticBlock::store_solution: there is no "
+                           "WarmStartCache" ) );
+ auto inner_block = get_inner_block();
+ if( ! inner_block )
+  return false;
+
+ std::unique_ptr< Solution > solution( inner_block->get_Solution( nullptr ,
+                                                                  false ) );
+ if( ! solution )
+  return false;
+
+ update_layouts();
+ warm_start_cache->store( scenario , scenario_dimension ,
+                          std::move( solution ) );
+ return true;
+}
+
+/*--------------------------------------------------------------------------*/
+
+bool StochasticBlock::warm_start( std::vector< double >::const_iterator
+                                  scenario , bool * exact ) {
+ if( ! warm_start_cache )
+  throw( std::logic_error( "StochasticBlock::warm_start: there is no "
+                           "WarmStartCache" ) );
+ auto inner_block = get_inner_block();
+ if( ! inner_block )
+  return false;
+
+ update_layouts();
+ auto solution = warm_start_cache->find( scenario , scenario_dimension ,
+                                         exact );
+ if( ! solution )
+  return false;
+
+ solution->write( inner_block );
+ return true;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::gather( Index i ,
+                              std::vector< double >::iterator values ) {
+ const auto & layout = layouts[ i ];
+ if( ! layout.get )
+  throw( std::logic_error( "StochasticBlock: the data of data mapping " +
+                           std::to_string( i ) + " cannot be read" ) );
+ layout.get( layout.block , layout.to.decompress() , values );
+}
+
+/*--------------------------------------------------------------------------*/
+
+std::map< std::pair< std::string , bool > , StochasticBlock::Getter > &
+StochasticBlock::get_getters() {
+ static std::map< std::pair< std::string , bool > , Getter > getters;
+ return getters;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::start_tracking( std::size_t id ) {
+ snapshot_id = id;
+ written_in_full.assign( layouts.size() , false );
+ written_entries.resize( layouts.size() );
+ for( auto & entries : written_entries )
+  entries.clear();
+}
+
+/*--------------------------------------------------------------------------*/
+
+StochasticBlock::Snapshot StochasticBlock::take_snapshot() {
+ update_layouts();
+
+ Snapshot snapshot;
+ snapshot.sizes.resize( layouts.size() );
+ std::size_t size = 0;
+ for( Index i = 0 ; i < layouts.size() ; ++i )
+  size += snapshot.sizes[ i ] = layouts[ i ].to.size();
+
+ snapshot.values.resize( size );
+ auto values = snapshot.values.begin();
+ for( Index i = 0 ; i < layouts.size() ; ++i ) {
+  gather( i , values );
+  values += snapshot.sizes[ i ];
+  }
+
+ snapshot.id = ++snapshot_counter;
+ start_tracking( snapshot.id );
+ return snapshot;
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::restore_snapshot( const Snapshot & snapshot ,
+                                        c_ModParam issuePMod ,
+                                        c_ModParam issueAMod ) {
+ update_layouts();
+ if( snapshot.sizes.size() != layouts.size() )
+  throw( std::invalid_argument( "StochasticBlock::restore_snapshot: the "
+                                "Snapshot does not match the data mappings" ) );
+ for( Index i = 0 ; i < layouts.size() ; ++i )
+  if( snapshot.sizes[ i ] != layouts[ i ].to.size() )
+   throw( std::invalid_argument( "StochasticBlock::restore_snapshot: the "
+                                 "Snapshot does not match the data "
+                                 "mappings" ) );
+
+ reset_last_scenario();
+ discard_pending_data();
+
+ std::vector< double > current;
+ auto saved = snapshot.values.cbegin();
+ issue_grouped( issuePMod , issueAMod ,
+                [ & ]( c_ModParam pmod , c_ModParam amod ) {
+  for( Index i = 0 ; i < layouts.size() ; ++i ) {
+   const auto & layout = layouts[ i ];
+   const Index n = layout.to.size();
+
+   changed_values.clear();
+   changed_positions.clear();
+   if( snapshot_id && ( snapshot.id == snapshot_id ) ) {
+    // only write back the positions written since the Snapshot
+    if( written_in_full[ i ] ) {
+     changed_values.assign( saved , saved + n );
+     changed_positions = layout.to.decompress();
+     }
+    else {
+     auto & entries = written_entries[ i ];
+     std::sort( entries.begin() , entries.end() );
+     entries.erase( std::unique( entries.begin() , entries.end() ) ,
+                    entries.end() );
+     for( auto k : entries ) {
+      changed_values.push_back( saved[ k ] );
+      changed_positions.push_back( k );
+      }
+     layout.to.translate( changed_positions );
+     }
+    }
+   else {
+    // read the current values and only write back those that differ
+    current.resize( n );
+    gather( i , current.begin() );
+    for( Index k = 0 ; k < n ; ++k )
+     if( saved[ k ] != current[ k ] ) {
+      changed_values.push_back( saved[ k ] );
+      changed_positions.push_back( k );
+      }
+    layout.to.translate( changed_positions );
+    }
+   saved += n;
+
+   if( ! changed_positions.empty() )
+    layout.scatter( changed_values.cbegin() , Subset( changed_positions ) ,
+                    pmod , amod );
+   }
+ } );
+
+ // the data are now those of the Snapshot
+ start_tracking( snapshot.id );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::write_data_entries(
+ const Subset & positions , std::vector< double >::const_iterator data ,
+ c_ModParam issuePMod , c_ModParam issueAMod ) {
+ update_layouts();
+ discard_pending_data();
+
+ if( entry_start.size() != scenario_dimension + 1 ) {
+  // index, once and for all, the data mappings using each entry
+  entry_start.assign( scenario_dimension + 1 , 0 );
+  for( const auto & layout : layouts )
+   for( auto k : layout.from )
+    ++entry_start[ k + 1 ];
+  std::partial_sum( entry_start.begin() , entry_start.end() ,
+                    entry_start.begin() );
+  entry_users.resize( entry_start.back() );
+  entry_targets.resize( entry_start.back() );
+  auto next = entry_start;
+  for( Index i = 0 ; i < layouts.size() ; ++i ) {
+   Index k = 0;
+   auto to = layouts[ i ].to.begin();
+   for( auto from : layouts[ i ].from ) {
+    entry_targets[ next[ from ] ] = *to++;
+    entry_users[ next[ from ]++ ] = { i , k++ };
+    }
+   }
+  entry_values.resize( layouts.size() );
+  entry_positions.resize( layouts.size() );
+  }
+
+ for( Index i = 0 ; i < layouts.size() ; ++i ) {
+  entry_values[ i ].clear();
+  entry_positions[ i ].clear();
+  }
+ for( auto position : positions ) {
+  if( position >= scenario_dimension )
+   continue;  // not used by any data mapping
+  for( auto u = entry_start[ position ] ; u < entry_start[ position + 1 ] ;
+       ++u ) {
+   const auto [ i , k ] = entry_users[ u ];
+   entry_values[ i ].push_back( data[ position ] );
+   entry_positions[ i ].push_back( entry_targets[ u ] );
+   if( snapshot_id )
+    track_written( i , k );
+   }
+  if( last_scenario.size() == scenario_dimension )
+   last_scenario[ position ] = data[ position ];
+  }
+
+ if( statistics )
+  start_statistics();
+
+ issue_grouped( issuePMod , issueAMod ,
+                [ & ]( c_ModParam pmod , c_ModParam amod ) {
+  for( Index i = 0 ; i < layouts.size() ; ++i ) {
+   const auto & layout = layouts[ i ];
+   const auto n = entry_positions[ i ].size();
+   if( ! layout.scatter )  // an opaque data mapping
+    set_data_mapping( i , data , pmod , amod );
+   else if( n == 0 )
+    continue;
+   else if( n == layout.from.size() )
+    set_data_mapping( i , data , pmod , amod );
+   else if( ! statistics )
+    layout.scatter( entry_values[ i ].cbegin() ,
+                    Subset( entry_positions[ i ] ) , pmod , amod );
+   else {
+    const auto start = Statistics::Clock::now();
+    layout.scatter( entry_values[ i ].cbegin() ,
+                    Subset( entry_positions[ i ] ) , pmod , amod );
+    statistics->add( i , n , start );
+    }
+   }
+ } );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void StochasticBlock::get_current_data( std::vector< double > & scenario ) {
+ update_layouts();
+ scenario.assign( scenario_dimension , 0.0 );
+
+ std::vector< double > current;
+ for( Index i = 0 ; i < layouts.size() ; ++i ) {
+  const auto & layout = layouts[ i ];
+  current.resize( layout.to.size() );
+  gather( i , current.begin() );
+  auto value = current.cbegin();
+  layout.from.for_each( [ & ]( Index from ) { scenario[ from ] = *value++; } );
+  }
 }
 
 /*--------------------------------------------------------------------------*/
@@ -69,9 +1498,15 @@ void StochasticBlock::deserialize( const netCDF::NcGroup & group ) {
 
 void StochasticBlock::add_Modification( sp_Mod mod ,
                                         Observer::ChnlName chnl ) {
- // TODO
+ complete_deserialization();
+
+ if( statistics ) {
+  ++statistics->modifications;
+  ++statistics->modification_types[ typeid( *mod ) ];
+  }
+
  if( anyone_there() )
-  Block::add_Modification( std::make_shared< NBModification >( this ) );
+  Block::add_Modification( mod , chnl );
 }
 
 /*--------------------------------------------------------------------------*/
@@ -82,16 +1517,49 @@ void StochasticBlock::print( std::ostream & output , char vlvl ) const
 {
  output << std::endl << "StochasticBlock with ";
 
- if( v_Block.empty() )
+ if( lazy && ( ! lazy->done.load( std::memory_order_acquire ) ) )
+  output << "an inner Block not deserialized yet" << std::endl;
+ else if( v_Block.empty() )
   output << "no inner Block";
  else
   output << "the inner Block " << v_Block.front() << std::endl;
+
+ if( vlvl <= 0 )
+  return;
+
+ output << std::endl << data_mappings.size() << " data mappings";
+ if( scenario_set )
+  output << ", a ScenarioSet with " << scenario_set->size() << " scenarios";
+ if( scenario_generator )
+  output << ", a ScenarioGenerator";
+ if( delta_mode )
+  output << ", delta mode";
+ if( compiled )
+  output << ", compiled plan";
+ if( group_modifications )
+  output << ", grouped Modification";
+ output << std::endl;
+
+ if( ( vlvl <= 1 ) || ( ! statistics ) )
+  return;
+
+ output << "set_data() calls: " << statistics->set_data_calls << std::endl;
+ for( Index i = 0 ; i < statistics->elements.size() ; ++i )
+  output << "data mapping " << i << ": " << statistics->elements[ i ]
+         << " elements written in " << statistics->time[ i ] << " s"
+         << std::endl;
+ output << "Modification received: " << statistics->modifications
+        << std::endl;
+ for( const auto & type : statistics->modification_types )
+  output << "  " << type.first.name() << ": " << type.second << std::endl;
  }
 
 /*--------------------------------------------------------------------------*/
 
 void StochasticBlock::serialize( netCDF::NcGroup & group ) const
 {
+ complete_deserialization();
+
  Block::serialize( group );
 
  group.putAtt( "type" , "StochasticBlock" );
@@ -107,9 +1575,54 @@ void StochasticBlock::serialize( netCDF::NcGroup & group ) const
   inner_block->serialize( inner_block_group );
   }
 
- SimpleDataMappingBase::serialize( group , data_mappings , inner_block );
+ if( ( ! write_data_mappings_group.load() ) ||
+     ( ! serialize_data_mappings( group , inner_block ) ) )
+  SimpleDataMappingBase::serialize( group , data_mappings , inner_block );
+
+ if( scenario_set ) {
+  auto scenario_set_group = group.addGroup( "ScenarioSet" );
+  scenario_set->serialize( scenario_set_group );
+  }
  }
 
+/*--------------------------------------------------------------------------*/
+
+bool StochasticBlock::serialize_data_mappings( netCDF::NcGroup & group ,
+                                               Block * inner_block ) const {
+ if( data_mappings.empty() )
+  return true;
+ if( ! inner_block )
+  return false;
+
+ SerializedDataMappings serialized;
+ for( const auto & data_mapping : data_mappings )
+  if( ! put_data_mapping( data_mapping.get() , inner_block , serialized ) )
+   return false;
+
+ auto data_mappings_group = group.addGroup( "DataMappings" );
+ auto number_dim = data_mappings_group.addDim( "NumberDataMappings" ,
+                                               data_mappings.size() );
+ put_variable( data_mappings_group , "Type" , netCDF::NcInt() , number_dim ,
+               serialized.type );
+ put_variable( data_mappings_group , "SetFromSize" , netCDF::NcUint() ,
+               number_dim , serialized.from_size );
+ put_variable( data_mappings_group , "SetFromElements" , netCDF::NcUint() ,
+               "SetFromLength" , serialized.from_elements );
+ put_variable( data_mappings_group , "SetToSize" , netCDF::NcUint() ,
+               number_dim , serialized.to_size );
+ put_variable( data_mappings_group , "SetToElements" , netCDF::NcUint() ,
+               "SetToLength" , serialized.to_elements );
+ put_variable( data_mappings_group , "BlockPathSize" , netCDF::NcUint() ,
+               number_dim , serialized.path_size );
+ put_variable( data_mappings_group , "BlockPath" , netCDF::NcUint() ,
+               "BlockPathLength" , serialized.path );
+ put_variable( data_mappings_group , "FunctionNameSize" , netCDF::NcUint() ,
+               number_dim , serialized.name_size );
+ put_variable( data_mappings_group , "FunctionName" , netCDF::NcChar() ,
+               "FunctionNameLength" , serialized.name );
+ return true;
+}
+
 /*--------------------------------------------------------------------------*/
 /*-------------------- End File StochasticBlock.cpp ------------------------*/
 /*--------------------------------------------------------------------------*/
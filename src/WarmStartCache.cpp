@@ -0,0 +1,153 @@
+/*--------------------------------------------------------------------------*/
+/*------------------------ File WarmStartCache.cpp -------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Implementation of the WarmStartCache class.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+/*--------------------------------------------------------------------------*/
+/*---------------------------- IMPLEMENTATION ------------------------------*/
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include "WarmStartCache.h"
+
+#include <algorithm>
+#include <cstring>
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- NAMESPACE AND USING ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = WarmStartCache::Index;
+
+/*--------------------------------------------------------------------------*/
+/*---------------------- METHODS of WarmStartCache -------------------------*/
+/*--------------------------------------------------------------------------*/
+
+void WarmStartCache::set_capacity( Index capacity ) {
+ this->capacity = std::max( capacity , Index( 1 ) );
+ evict();
+}
+
+/*--------------------------------------------------------------------------*/
+
+std::uint64_t WarmStartCache::fingerprint(
+ std::vector< double >::const_iterator scenario , Index dimension ) {
+ // FNV-1a over the bits of the values, followed by a final mixing
+ std::uint64_t hash = 0xcbf29ce484222325ULL ^ dimension;
+ for( Index k = 0 ; k < dimension ; ++k ) {
+  const double value = scenario[ k ] == 0 ? 0.0 : scenario[ k ];
+  std::uint64_t bits;
+  std::memcpy( & bits , & value , sizeof( bits ) );
+  hash = ( hash ^ bits ) * 0x100000001b3ULL;
+  }
+ hash ^= hash >> 33;
+ hash *= 0xff51afd7ed558ccdULL;
+ hash ^= hash >> 33;
+ return hash;
+}
+
+/*--------------------------------------------------------------------------*/
+
+WarmStartCache::EntryIterator WarmStartCache::find_exact(
+ std::vector< double >::const_iterator scenario , Index dimension ,
+ std::uint64_t fingerprint ) {
+ auto candidates = fingerprints.equal_range( fingerprint );
+ for( auto it = candidates.first ; it != candidates.second ; ++it ) {
+  const auto & stored = it->second->scenario;
+  if( ( stored.size() == dimension ) &&
+      std::equal( stored.begin() , stored.end() , scenario ) )
+   return it->second;
+  }
+ return entries.end();
+}
+
+/*--------------------------------------------------------------------------*/
+
+void WarmStartCache::store( std::vector< double >::const_iterator scenario ,
+                            Index dimension ,
+                            std::unique_ptr< Solution > solution ) {
+ const auto hash = fingerprint( scenario , dimension );
+ auto entry = find_exact( scenario , dimension , hash );
+ if( entry != entries.end() ) {
+  entry->solution = std::move( solution );
+  entries.splice( entries.begin() , entries , entry );
+  return;
+  }
+
+ entries.push_front( Entry{ hash ,
+                            std::vector< double >( scenario ,
+                                                   scenario + dimension ) ,
+                            std::move( solution ) } );
+ fingerprints.emplace( hash , entries.begin() );
+ evict();
+}
+
+/*--------------------------------------------------------------------------*/
+
+Solution * WarmStartCache::find( std::vector< double >::const_iterator
+                                 scenario , Index dimension , bool * exact ) {
+ auto best = find_exact( scenario , dimension ,
+                         fingerprint( scenario , dimension ) );
+ const bool found = best != entries.end();
+
+ if( ( ! found ) && ( max_distance > 0 ) ) {
+  // look for the closest scenario, stopping the computation of a distance
+  // as soon as it exceeds the best one found so far
+  double best_distance = max_distance * max_distance;
+  for( auto it = entries.begin() ; it != entries.end() ; ++it ) {
+   if( it->scenario.size() != dimension )
+    continue;
+   double distance = 0;
+   for( Index k = 0 ; ( k < dimension ) && ( distance <= best_distance ) ;
+        ++k ) {
+    const double difference = it->scenario[ k ] - scenario[ k ];
+    distance += difference * difference;
+    }
+   if( distance <= best_distance ) {
+    best_distance = distance;
+    best = it;
+    }
+   }
+  }
+
+ if( exact )
+  *exact = found;
+
+ if( best == entries.end() ) {
+  ++misses;
+  return nullptr;
+  }
+
+ ++( found ? exact_hits : nearest_hits );
+ entries.splice( entries.begin() , entries , best );
+ return best->solution.get();
+}
+
+/*--------------------------------------------------------------------------*/
+
+void WarmStartCache::evict() {
+ while( entries.size() > capacity ) {
+  auto last = std::prev( entries.end() );
+  auto candidates = fingerprints.equal_range( last->fingerprint );
+  for( auto it = candidates.first ; it != candidates.second ; ++it )
+   if( it->second == last ) {
+    fingerprints.erase( it );
+    break;
+    }
+  entries.erase( last );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+/*--------------------- End File WarmStartCache.cpp ------------------------*/
+/*--------------------------------------------------------------------------*/
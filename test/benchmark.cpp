@@ -0,0 +1,297 @@
+/*--------------------------------------------------------------------------*/
+/*--------------------------- File benchmark.cpp ---------------------------*/
+/*--------------------------------------------------------------------------*/
+/** @file
+ * Benchmark of StochasticBlock::set_data().
+ *
+ * Measures the throughput (scenario entries written per second) of
+ * StochasticBlock::set_data() for a varying number of data mappings,
+ * Subset or Range mappings, int or double data, scenario dimension, and
+ * with or without a Solver attached to the StochasticBlock (so that the
+ * Modification issued by the inner Block are actually delivered). Each
+ * configuration is run in the default mode, with the compiled plan (see
+ * StochasticBlock::compile_data_mappings()) and in delta mode (see
+ * StochasticBlock::set_delta_mode()), in the latter case changing 1% of
+ * the entries between consecutive scenarios.
+ *
+ * Usage: StochasticBlock_benchmark [ max_dimension [ min_time ] ]
+ *
+ * where max_dimension (default 1000000) is the largest scenario dimension
+ * and min_time (default 0.2) is the minimum time, in seconds, spent on each
+ * configuration.
+ *
+ * \author Rafael Durbano Lobato \n
+ *         Dipartimento di Informatica \n
+ *         Universita' di Pisa \n
+ *
+ * \copyright &copy; by Rafael Durbano Lobato
+ */
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ INCLUDES ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+#include <StochasticBlock.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <random>
+#include <vector>
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------------- USING -----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+using namespace SMSpp_di_unipi_it;
+
+using Index = Block::Index;
+using Subset = Block::Subset;
+using Range = Block::Range;
+
+/*--------------------------------------------------------------------------*/
+/*-------------------------- GLOBAL VARIABLES ------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+std::mt19937 random_engine;
+
+/*--------------------------------------------------------------------------*/
+/*--------------------------- AUXILIARY TYPES ------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+/// a Block with a vector of int and a vector of double
+
+class BenchmarkBlock : public Block {
+
+public:
+
+ BenchmarkBlock( Block * f_block = nullptr ) : Block( f_block ) {}
+
+ BenchmarkBlock( std::size_t size ) : int_data( size ) , dbl_data( size ) {}
+
+ template< class T >
+ std::vector< T > & get_data() {
+  if constexpr( std::is_same_v< T , int > )
+   return int_data;
+  else
+   return dbl_data;
+ }
+
+ template< class T >
+ void set_data( typename std::vector< T >::const_iterator values ,
+                Subset && subset , bool ordered = false ,
+                c_ModParam issuePMod = eNoBlck ,
+                c_ModParam issueAMod = eNoBlck ) {
+  auto & data = get_data< T >();
+  for( auto i : subset )
+   data[ i ] = *(values++);
+  issue_Modification( issuePMod );
+ }
+
+ template< class T >
+ void set_data( typename std::vector< T >::const_iterator values ,
+                Range rng , c_ModParam issuePMod = eNoBlck ,
+                c_ModParam issueAMod = eNoBlck ) {
+  auto & data = get_data< T >();
+  std::copy( values , values + ( rng.second - rng.first ) ,
+             data.begin() + rng.first );
+  issue_Modification( issuePMod );
+ }
+
+ static void static_initialization() {
+  register_method< BenchmarkBlock , MF_int_it , Subset && , const bool >
+   ( "BenchmarkBlock::set_data" , & BenchmarkBlock::set_data< int > );
+
+  register_method< BenchmarkBlock , MF_int_it , Range >
+   ( "BenchmarkBlock::set_data" , & BenchmarkBlock::set_data< int > );
+
+  register_method< BenchmarkBlock , MF_dbl_it , Subset && , const bool >
+   ( "BenchmarkBlock::set_data" , & BenchmarkBlock::set_data< double > );
+
+  register_method< BenchmarkBlock , MF_dbl_it , Range >
+   ( "BenchmarkBlock::set_data" , & BenchmarkBlock::set_data< double > );
+ }
+
+protected:
+
+ void load( std::istream & input , char frmt ) override {}
+
+ /// issues a Modification standing for the change of the data
+
+ void issue_Modification( c_ModParam issuePMod ) {
+  if( ( Observer::par2mod( issuePMod ) != eNoMod ) && anyone_there() )
+   add_Modification( std::make_shared< NBModification >( this ) ,
+                     Observer::par2chnl( issuePMod ) );
+ }
+
+private:
+ std::vector< int > int_data;
+ std::vector< double > dbl_data;
+ SMSpp_insert_in_factory_h;
+};
+
+SMSpp_insert_in_factory_cpp_1( BenchmarkBlock );
+
+/*--------------------------------------------------------------------------*/
+
+/// a Solver doing nothing but counting the Modification it receives
+
+class CountingSolver : public Solver {
+
+public:
+
+ int compute( bool changedvars = true ) override { return( kOK ); }
+
+ bool has_var_solution() override { return( false ); }
+
+ void get_var_solution( Configuration * solc = nullptr ) override {}
+
+ void add_Modification( sp_Mod & mod ) override { ++count; }
+
+ std::size_t count = 0;
+};
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- AUXILIARY FUNCTIONS ----------------------------*/
+/*--------------------------------------------------------------------------*/
+
+template< class S , class T >
+auto get_method() {
+ using Iter = std::conditional_t< std::is_same_v< T , int > ,
+                                  Block::MF_int_it , Block::MF_dbl_it >;
+ if constexpr( std::is_same_v< S , Subset > )
+  return Block::get_method< Block::FunctionType< Iter , Subset && , bool > >
+   ( "BenchmarkBlock::set_data" );
+ else
+  return Block::get_method< Block::FunctionType< Iter , Range > >
+   ( "BenchmarkBlock::set_data" );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// returns the set of the given size starting at the given offset
+/** A Subset is made of every other element of the Block data, so that it
+ * cannot be turned into a Range. */
+
+template< class S >
+S make_set( Index offset , Index size , bool scenario_side ) {
+ if constexpr( std::is_same_v< S , Range > )
+  return Range( offset , offset + size );
+ else {
+  Subset set( size );
+  for( Index i = 0 ; i < size ; ++i )
+   set[ i ] = scenario_side ? offset + i : 2 * ( offset + i );
+  return set;
+ }
+}
+
+/*--------------------------------------------------------------------------*/
+/*------------------------------ BENCHMARK ---------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+enum Mode { eDefault , eCompiled , eDelta };
+
+/// runs the benchmark for the given configuration and prints the results
+
+template< class S , class T >
+void benchmark( Index dimension , Index number_mappings , bool observed ,
+                Mode mode , double min_time ) {
+ auto inner_block = new BenchmarkBlock( 2 * std::size_t( dimension ) );
+ StochasticBlock stochastic_block;
+ stochastic_block.set_inner_block( inner_block );
+
+ const Index size = dimension / number_mappings;
+ for( Index m = 0 ; m < number_mappings ; ++m )
+  stochastic_block.add_data_mapping
+   ( std::make_unique< SimpleDataMapping< S , S , T > >
+     ( get_method< S , T >() , inner_block ,
+       make_set< S >( m * size , size , true ) ,
+       make_set< S >( m * size , size , false ) ) );
+
+ if( mode == eCompiled )
+  stochastic_block.compile_data_mappings();
+ if( mode == eDelta )
+  stochastic_block.set_delta_mode();
+
+ CountingSolver solver;
+ if( observed )
+  stochastic_block.register_Solver( & solver );
+ const auto issuePMod = observed ? eModBlck : eNoBlck;
+
+ // two scenarios differing in 1% of the entries
+ std::vector< std::vector< double > > scenarios(
+  2 , std::vector< double >( dimension ) );
+ std::uniform_int_distribution< int > value_dist( 0 , 1000 );
+ for( auto & value : scenarios[ 0 ] )
+  value = value_dist( random_engine );
+ scenarios[ 1 ] = scenarios[ 0 ];
+ std::uniform_int_distribution< Index > index_dist( 0 , dimension - 1 );
+ for( Index k = 0 ; k < std::max( dimension / 100 , Index( 1 ) ) ; ++k )
+  scenarios[ 1 ][ index_dist( random_engine ) ] += 1;
+
+ using clock = std::chrono::steady_clock;
+ std::size_t calls = 0;
+ const auto start = clock::now();
+ double elapsed = 0;
+ do {
+  for( int r = 0 ; r < 10 ; ++r , ++calls )
+   stochastic_block.set_data( scenarios[ calls % 2 ] , issuePMod );
+  elapsed = std::chrono::duration< double >( clock::now() - start ).count();
+  } while( elapsed < min_time );
+
+ if( observed )
+  stochastic_block.unregister_Solver( & solver );
+
+ static const char * mode_names[] = { "default" , "compiled" , "delta" };
+ std::cout << std::setw( 8 ) << dimension
+           << std::setw( 9 ) << number_mappings
+           << std::setw( 8 ) << ( std::is_same_v< S , Subset > ? "Subset" :
+                                                                  "Range" )
+           << std::setw( 7 ) << ( std::is_same_v< T , int > ? "int" :
+                                                              "double" )
+           << std::setw( 9 ) << ( observed ? "yes" : "no" )
+           << std::setw( 10 ) << mode_names[ mode ]
+           << std::setw( 14 ) << std::setprecision( 4 )
+           << 1e6 * elapsed / calls
+           << std::setw( 14 ) << std::setprecision( 4 )
+           << double( calls ) * dimension / elapsed / 1e6
+           << std::setw( 12 ) << std::setprecision( 4 )
+           << double( solver.count ) / calls << std::endl;
+}
+
+/*--------------------------------------------------------------------------*/
+
+template< class S , class T >
+void benchmark_all( Index max_dimension , double min_time ) {
+ for( Index dimension = 1000 ; dimension <= max_dimension ; dimension *= 10 )
+  for( Index number_mappings : { 1 , 10 , 100 } )
+   for( bool observed : { false , true } )
+    for( Mode mode : { eDefault , eCompiled , eDelta } )
+     benchmark< S , T >( dimension , number_mappings , observed , mode ,
+                         min_time );
+}
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------------- MAIN ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+int main( int argc , char ** argv ) {
+
+ Index max_dimension = argc > 1 ? std::atoi( argv[ 1 ] ) : 1000000;
+ double min_time = argc > 2 ? std::atof( argv[ 2 ] ) : 0.2;
+
+ std::cout << "dimension mappings    set   type observed      mode"
+           << "  us/set_data  Mentries/s  mods/call" << std::endl;
+
+ benchmark_all< Subset , int >( max_dimension , min_time );
+ benchmark_all< Subset , double >( max_dimension , min_time );
+ benchmark_all< Range , int >( max_dimension , min_time );
+ benchmark_all< Range , double >( max_dimension , min_time );
+}
+
+/*--------------------------------------------------------------------------*/
+/*------------------------- End File benchmark.cpp -------------------------*/
+/*--------------------------------------------------------------------------*/
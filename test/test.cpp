@@ -15,10 +15,26 @@
 /*------------------------------ INCLUDES ----------------------------------*/
 /*--------------------------------------------------------------------------*/
 
+#include <CompressedSubset.h>
+#include <MappedScenarioSet.h>
+#include <ScenarioEvaluator.h>
+#include <ScenarioOrdering.h>
+#include <ScenarioPrefetcher.h>
+#include <ScenarioReduction.h>
+#include <ScenarioStatistics.h>
+#include <ScenarioTree.h>
 #include <StochasticBlock.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
 #include <random>
+#include <stdexcept>
+#include <thread>
 #include <vector>
 
 /*--------------------------------------------------------------------------*/
@@ -40,6 +56,20 @@ std::mt19937 random_engine;
 /*--------------------------- AUXILIARY TYPES ------------------------------*/
 /*--------------------------------------------------------------------------*/
 
+/// the Modification issued by DummyBlock when its data change
+
+class DummyModification : public BlockModification {
+
+public:
+
+ DummyModification( Block * block , std::size_t elements )
+  : BlockModification( block ) , elements( elements ) {}
+
+ std::size_t elements;  ///< the number of elements changed
+};
+
+/*--------------------------------------------------------------------------*/
+
 class DummyBlock : public Block {
 
 public:
@@ -77,6 +107,7 @@ public:
    data[ i ] = *values;
    std::advance( values , 1 );
   }
+  issue_Modification( subset.size() , issuePMod );
  }
 
  template< class T >
@@ -91,6 +122,7 @@ public:
    data[ i ] = *values;
    std::advance( values , 1 );
   }
+  issue_Modification( rng.second - rng.first , issuePMod );
  }
 
  static void static_initialization() {
@@ -105,12 +137,96 @@ public:
 
   register_method< DummyBlock , MF_dbl_it , Range >
    ( "DummyBlock::set_data" , & DummyBlock::set_data< double > );
+
+  StochasticBlock::register_getter< int >
+   ( "DummyBlock::set_data" , & DummyBlock::get_values< int > );
+
+  StochasticBlock::register_getter< double >
+   ( "DummyBlock::set_data" , & DummyBlock::get_values< double > );
+ }
+
+ template< class T >
+ static void get_values( Block * block , const Subset & positions ,
+                         std::vector< double >::iterator values ) {
+  auto & data = static_cast< DummyBlock * >( block )->get_data< T >();
+  for( auto i : positions )
+   *(values++) = data[ i ];
+  ++reads;
+ }
+
+ static inline std::atomic< std::size_t > reads = 0;  ///< get_values() calls
+
+public:
+
+ Block * get_R3_Block( Configuration * r3bc , Block * base ,
+                       Block * father ) override {
+  auto copy = new DummyBlock( father );
+  copy->int_data = int_data;
+  copy->dbl_data = dbl_data;
+  for( auto block : v_Block )
+   copy->v_Block.push_back( block->get_R3_Block( r3bc , nullptr , copy ) );
+  return copy;
+ }
+
+ void add_nested_Block( DummyBlock * block ) {
+  block->set_f_Block( this );
+  v_Block.push_back( block );
+ }
+
+ ~DummyBlock() override {
+  for( auto block : v_Block )
+   delete block;
+ }
+
+public:
+
+ void serialize( netCDF::NcGroup & group ) const override {
+  Block::serialize( group );
+  if( ! int_data.empty() )
+   group.addVar( "IntData" , netCDF::NcInt() ,
+                 group.addDim( "IntSize" , int_data.size() ) )
+    .putVar( int_data.data() );
+  if( ! dbl_data.empty() )
+   group.addVar( "DoubleData" , netCDF::NcDouble() ,
+                 group.addDim( "DoubleSize" , dbl_data.size() ) )
+    .putVar( dbl_data.data() );
+  if( ! v_Block.empty() )
+   group.addDim( "NumberNestedBlocks" , v_Block.size() );
+  for( std::size_t i = 0 ; i < v_Block.size() ; ++i ) {
+   auto nested_group = group.addGroup( "NestedBlock_" + std::to_string( i ) );
+   v_Block[ i ]->serialize( nested_group );
+   }
+ }
+
+ void deserialize( const netCDF::NcGroup & group ) override {
+  Index size;
+  ::SMSpp_di_unipi_it::deserialize_dim( group , "IntSize" , size , true );
+  int_data.resize( size );
+  if( size > 0 )
+   group.getVar( "IntData" ).getVar( int_data.data() );
+  ::SMSpp_di_unipi_it::deserialize_dim( group , "DoubleSize" , size , true );
+  dbl_data.resize( size );
+  if( size > 0 )
+   group.getVar( "DoubleData" ).getVar( dbl_data.data() );
+  ::SMSpp_di_unipi_it::deserialize_dim( group , "NumberNestedBlocks" , size ,
+                                        true );
+  for( Index i = 0 ; i < size ; ++i )
+   v_Block.push_back( new_Block(
+    group.getGroup( "NestedBlock_" + std::to_string( i ) ) , this ) );
+  Block::deserialize( group );
  }
 
 protected:
 
  void load( std::istream & input , char frmt ) override {}
 
+ void issue_Modification( std::size_t elements , c_ModParam issuePMod ) {
+  if( ( Observer::par2mod( issuePMod ) != eNoMod ) && anyone_there() )
+   add_Modification( std::make_shared< DummyModification >( this ,
+                                                            elements ) ,
+                     Observer::par2chnl( issuePMod ) );
+ }
+
 private:
  std::vector< int > int_data;
  std::vector< double > dbl_data;
@@ -119,6 +235,27 @@ private:
 
 SMSpp_insert_in_factory_cpp_1( DummyBlock );
 
+/*--------------------------------------------------------------------------*/
+
+/// a Solver doing nothing but recording the Modification it receives
+
+class RecordingSolver : public Solver {
+
+public:
+
+ int compute( bool changedvars = true ) override { return( kOK ); }
+
+ bool has_var_solution() override { return( false ); }
+
+ void get_var_solution( Configuration * solc = nullptr ) override {}
+
+ void add_Modification( sp_Mod & mod ) override {
+  modifications.push_back( mod );
+ }
+
+ std::vector< sp_Mod > modifications;
+};
+
 /*--------------------------------------------------------------------------*/
 /*------------------------- AUXILIARY FUNCTIONS ----------------------------*/
 /*--------------------------------------------------------------------------*/
@@ -157,6 +294,23 @@ auto get_method() {
 
 /*--------------------------------------------------------------------------*/
 
+template< class T >
+T build_sequential( int size , int offset = 0 );
+
+/// returns a data mapping writing entry from of the scenario into position to
+
+template< class SetFrom , class SetTo , class T >
+std::unique_ptr< SimpleDataMappingBase > single_mapping( Block * block ,
+                                                         Block::Index from ,
+                                                         Block::Index to ) {
+ return std::make_unique< SimpleDataMapping< SetFrom , SetTo , T > >
+  ( get_method< SetTo , T >() , block ,
+    build_sequential< SetFrom >( 1 , from ) ,
+    build_sequential< SetTo >( 1 , to ) , "DummyBlock::set_data" );
+}
+
+/*--------------------------------------------------------------------------*/
+
 template< class T >
 T build( int size , int total_size );
 
@@ -181,9 +335,6 @@ Range build( int size , int total_size ) {
 
 /*--------------------------------------------------------------------------*/
 
-template< class T >
-T build_sequential( int size , int offset = 0 );
-
 template<>
 Subset build_sequential( int size , int offset ) {
  Subset set( size );
@@ -291,24 +442,1769 @@ void test( std::size_t int_size , std::size_t dbl_size ) {
 }
 
 /*--------------------------------------------------------------------------*/
-/*---------------------------------- MAIN ----------------------------------*/
+
+template< class SetFrom , class SetTo >
+void test_forwarded_modifications( std::size_t int_size ,
+                                   std::size_t dbl_size ) {
+
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+ inner_block->set_f_Block( & stochastic_block );
+
+ std::uniform_int_distribution< int > uniform_dist_int( 0 , int_size );
+ std::uniform_int_distribution< int > uniform_dist_dbl( 0 , dbl_size );
+
+ std::size_t scenario_int_size = uniform_dist_int( random_engine );
+ std::size_t scenario_dbl_size = uniform_dist_dbl( random_engine );
+
+ SetFrom set_from_int = build_sequential< SetFrom >( scenario_int_size );
+ SetTo set_to_int = build< SetTo >( scenario_int_size , int_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , int > >
+    ( get_method< SetTo , int >() , inner_block ,
+      set_from_int , set_to_int ) );
+
+ SetFrom set_from_dbl = build_sequential< SetFrom >
+  ( scenario_dbl_size , scenario_int_size );
+ SetTo set_to_dbl = build< SetTo >( scenario_dbl_size , dbl_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , double > >
+    ( get_method< SetTo , double >() , inner_block ,
+      set_from_dbl , set_to_dbl ) );
+
+ RecordingSolver solver;
+ stochastic_block.register_Solver( & solver );
+
+ std::vector< double > int_data( scenario_int_size );
+ std::vector< double > dbl_data( scenario_dbl_size );
+
+ for( std::size_t i = 0 ; i < int_data.size() ; ++i )
+  int_data[ i ] = 1.0e6 + i;
+ for( std::size_t i = 0 ; i < dbl_data.size() ; ++i )
+  dbl_data[ i ] = 2.0e6 + i;
+
+ std::vector< double > data( int_data );
+ data.insert( data.end() , dbl_data.begin() , dbl_data.end() );
+
+ stochastic_block.set_data( data , eModBlck , eModBlck );
+
+ check( set_to_int , int_data , inner_block->get_data< int >() );
+ check( set_to_dbl , dbl_data , inner_block->get_data< double >() );
+
+ // the Solver receives the Modification of the inner Block, not an
+ // NBModification of the StochasticBlock
+ std::size_t elements = 0;
+ assert( solver.modifications.size() <= 2 );
+ for( const auto & mod : solver.modifications ) {
+  assert( ! std::dynamic_pointer_cast< NBModification >( mod ) );
+  auto dummy = std::dynamic_pointer_cast< DummyModification >( mod );
+  assert( dummy && ( dummy->get_Block() == inner_block ) );
+  elements += dummy->elements;
+  }
+ assert( elements == data.size() );
+
+ stochastic_block.unregister_Solver( & solver );
+}
+
 /*--------------------------------------------------------------------------*/
 
-int main() {
+template< class SetFrom , class SetTo >
+void test_grouped_modifications( std::size_t int_size ,
+                                 std::size_t dbl_size ) {
 
- std::uniform_int_distribution< int > size_dist( 0 , 20 );
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+ inner_block->set_f_Block( & stochastic_block );
 
- for( int i = 0 ; i < 10000 ; ++i ) {
-  test< Subset , Subset >( size_dist( random_engine ) ,
-                           size_dist( random_engine ) );
+ std::uniform_int_distribution< int > uniform_dist_int( 0 , int_size );
+ std::uniform_int_distribution< int > uniform_dist_dbl( 0 , dbl_size );
 
-  test< Subset , Range >( size_dist( random_engine ) ,
-                          size_dist( random_engine ) );
+ std::size_t scenario_int_size = uniform_dist_int( random_engine );
+ std::size_t scenario_dbl_size = uniform_dist_dbl( random_engine );
 
-  test< Range , Subset >( size_dist( random_engine ) ,
-                          size_dist( random_engine ) );
+ SetFrom set_from_int = build_sequential< SetFrom >( scenario_int_size );
+ SetTo set_to_int = build< SetTo >( scenario_int_size , int_size );
 
-  test< Range , Range >( size_dist( random_engine ) ,
-                         size_dist( random_engine ) );
- }
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , int > >
+    ( get_method< SetTo , int >() , inner_block ,
+      set_from_int , set_to_int ) );
+
+ SetFrom set_from_dbl = build_sequential< SetFrom >
+  ( scenario_dbl_size , scenario_int_size );
+ SetTo set_to_dbl = build< SetTo >( scenario_dbl_size , dbl_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , double > >
+    ( get_method< SetTo , double >() , inner_block ,
+      set_from_dbl , set_to_dbl ) );
+
+ RecordingSolver solver;
+ stochastic_block.register_Solver( & solver );
+ stochastic_block.set_group_modifications();
+
+ std::vector< double > int_data( scenario_int_size );
+ std::vector< double > dbl_data( scenario_dbl_size );
+ std::vector< double > data( scenario_int_size + scenario_dbl_size );
+
+ // each set_data() issues a single GroupModification, which holds the
+ // Modification of the inner Block
+ for( std::size_t calls = 1 ; calls <= 2 ; ++calls ) {
+  for( std::size_t i = 0 ; i < int_data.size() ; ++i )
+   data[ i ] = int_data[ i ] = 3.0e6 * calls + i;
+  for( std::size_t i = 0 ; i < dbl_data.size() ; ++i )
+   data[ int_data.size() + i ] = dbl_data[ i ] = 4.0e6 * calls + i;
+
+  stochastic_block.set_data( data , eModBlck , eModBlck );
+
+  check( set_to_int , int_data , inner_block->get_data< int >() );
+  check( set_to_dbl , dbl_data , inner_block->get_data< double >() );
+
+  assert( solver.modifications.size() == calls );
+  auto group = std::dynamic_pointer_cast< GroupModification >(
+   solver.modifications.back() );
+  assert( group );
+  std::size_t elements = 0;
+  for( const auto & mod : group->sub_Modifications() ) {
+   auto dummy = std::dynamic_pointer_cast< DummyModification >( mod );
+   assert( dummy && ( dummy->get_Block() == inner_block ) );
+   elements += dummy->elements;
+   }
+  assert( elements == data.size() );
+  }
+
+ stochastic_block.unregister_Solver( & solver );
+}
+
+/*--------------------------------------------------------------------------*/
+
+template< class SetFrom , class SetTo >
+void test_delta_mode( std::size_t int_size , std::size_t dbl_size ) {
+
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+ inner_block->set_f_Block( & stochastic_block );
+
+ std::uniform_int_distribution< int > uniform_dist_int( 0 , int_size );
+ std::uniform_int_distribution< int > uniform_dist_dbl( 0 , dbl_size );
+
+ std::size_t scenario_int_size = uniform_dist_int( random_engine );
+ std::size_t scenario_dbl_size = uniform_dist_dbl( random_engine );
+
+ SetFrom set_from_int = build_sequential< SetFrom >( scenario_int_size );
+ SetTo set_to_int = build< SetTo >( scenario_int_size , int_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , int > >
+    ( get_method< SetTo , int >() , inner_block ,
+      set_from_int , set_to_int ) );
+
+ SetFrom set_from_dbl = build_sequential< SetFrom >
+  ( scenario_dbl_size , scenario_int_size );
+ SetTo set_to_dbl = build< SetTo >( scenario_dbl_size , dbl_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , double > >
+    ( get_method< SetTo , double >() , inner_block ,
+      set_from_dbl , set_to_dbl ) );
+
+ RecordingSolver solver;
+ stochastic_block.register_Solver( & solver );
+ stochastic_block.set_delta_mode();
+
+ std::vector< double > int_data( scenario_int_size );
+ std::vector< double > dbl_data( scenario_dbl_size );
+
+ for( std::size_t i = 0 ; i < int_data.size() ; ++i )
+  int_data[ i ] = 1.0e6 + i;
+ for( std::size_t i = 0 ; i < dbl_data.size() ; ++i )
+  dbl_data[ i ] = 2.0e6 + i;
+
+ std::vector< double > data( int_data );
+ data.insert( data.end() , dbl_data.begin() , dbl_data.end() );
+
+ // returns the number of elements written since the previous call
+ auto written = [ & solver ]() {
+  std::size_t elements = 0;
+  for( const auto & mod : solver.modifications )
+   elements += std::static_pointer_cast< DummyModification >( mod )->elements;
+  solver.modifications.clear();
+  return( elements );
+ };
+
+ // the first scenario is written in full
+
+ stochastic_block.set_data( data , eModBlck , eModBlck );
+ assert( written() == data.size() );
+
+ check( set_to_int , int_data , inner_block->get_data< int >() );
+ check( set_to_dbl , dbl_data , inner_block->get_data< double >() );
+
+ // change only some of the entries: only those are written
+
+ std::size_t changed = 0;
+ for( std::size_t i = 0 ; i < int_data.size() ; i += 2 , ++changed )
+  data[ i ] = int_data[ i ] += 1.0e6;
+ for( std::size_t i = 1 ; i < dbl_data.size() ; i += 3 , ++changed )
+  data[ int_data.size() + i ] = dbl_data[ i ] += 1.0e6;
+
+ stochastic_block.set_data( data.begin() , eModBlck , eModBlck );
+ assert( written() == changed );
+
+ check( set_to_int , int_data , inner_block->get_data< int >() );
+ check( set_to_dbl , dbl_data , inner_block->get_data< double >() );
+
+ // the same scenario again: nothing is written
+
+ stochastic_block.set_data( data.begin() , eModBlck , eModBlck );
+ assert( written() == 0 );
+
+ stochastic_block.unregister_Solver( & solver );
+}
+
+/*--------------------------------------------------------------------------*/
+
+template< class SetFrom , class SetTo >
+void test_scenario_set_index( std::size_t int_size , std::size_t dbl_size ) {
+
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+
+ std::uniform_int_distribution< int > uniform_dist_int( 0 , int_size );
+ std::uniform_int_distribution< int > uniform_dist_dbl( 0 , dbl_size );
+
+ std::size_t scenario_int_size = uniform_dist_int( random_engine );
+ std::size_t scenario_dbl_size = uniform_dist_dbl( random_engine );
+
+ SetFrom set_from_int = build_sequential< SetFrom >( scenario_int_size );
+ SetTo set_to_int = build< SetTo >( scenario_int_size , int_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , int > >
+    ( get_method< SetTo , int >() , inner_block ,
+      set_from_int , set_to_int ) );
+
+ SetFrom set_from_dbl = build_sequential< SetFrom >
+  ( scenario_dbl_size , scenario_int_size );
+ SetTo set_to_dbl = build< SetTo >( scenario_dbl_size , dbl_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , double > >
+    ( get_method< SetTo , double >() , inner_block ,
+      set_from_dbl , set_to_dbl ) );
+
+ // two scenarios, the second one having probability 0.5
+
+ std::vector< double > first_int( scenario_int_size );
+ std::vector< double > first_dbl( scenario_dbl_size );
+ std::vector< double > second_int( scenario_int_size );
+ std::vector< double > second_dbl( scenario_dbl_size );
+
+ for( std::size_t i = 0 ; i < scenario_int_size ; ++i ) {
+  first_int[ i ] = 1.0e6 + i;
+  second_int[ i ] = 3.0e6 + i;
+  }
+ for( std::size_t i = 0 ; i < scenario_dbl_size ; ++i ) {
+  first_dbl[ i ] = 2.0e6 + i;
+  second_dbl[ i ] = 4.0e6 + i;
+  }
+
+ std::vector< double > first( first_int );
+ first.insert( first.end() , first_dbl.begin() , first_dbl.end() );
+ std::vector< double > second( second_int );
+ second.insert( second.end() , second_dbl.begin() , second_dbl.end() );
+
+ auto scenarios = std::make_unique< ScenarioSet >( first.size() );
+ scenarios->add_scenario( first.begin() );
+ scenarios->add_scenario( second.begin() , 0.5 );
+ assert( scenarios->size() == 2 );
+ assert( scenarios->get_probability( 1 ) == 0.5 );
+
+ stochastic_block.set_scenario_set( std::move( scenarios ) );
+ stochastic_block.set_data( 1 );
+
+ check( set_to_int , second_int , inner_block->get_data< int >() );
+ check( set_to_dbl , second_dbl , inner_block->get_data< double >() );
+
+ // go back to the first scenario through its index
+
+ stochastic_block.set_data( 0 );
+
+ check( set_to_int , first_int , inner_block->get_data< int >() );
+ check( set_to_dbl , first_dbl , inner_block->get_data< double >() );
+}
+
+/*--------------------------------------------------------------------------*/
+
+template< class SetFrom , class SetTo >
+void test_compiled_plan( std::size_t int_size , std::size_t dbl_size ) {
+
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+
+ std::uniform_int_distribution< int > uniform_dist_int( 0 , int_size );
+ std::uniform_int_distribution< int > uniform_dist_dbl( 0 , dbl_size );
+
+ std::size_t scenario_int_size = uniform_dist_int( random_engine );
+ std::size_t scenario_dbl_size = uniform_dist_dbl( random_engine );
+
+ SetFrom set_from_int = build_sequential< SetFrom >( scenario_int_size );
+ SetTo set_to_int = build< SetTo >( scenario_int_size , int_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , int > >
+    ( get_method< SetTo , int >() , inner_block ,
+      set_from_int , set_to_int ) );
+
+ SetFrom set_from_dbl = build_sequential< SetFrom >
+  ( scenario_dbl_size , scenario_int_size );
+ SetTo set_to_dbl = build< SetTo >( scenario_dbl_size , dbl_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , double > >
+    ( get_method< SetTo , double >() , inner_block ,
+      set_from_dbl , set_to_dbl ) );
+
+ stochastic_block.compile_data_mappings();
+
+ std::vector< double > int_data( scenario_int_size );
+ std::vector< double > dbl_data( scenario_dbl_size );
+
+ // the plan is used by every set_data() after it has been compiled
+
+ for( double base : { 1.0e6 , 3.0e6 } ) {
+  for( std::size_t i = 0 ; i < int_data.size() ; ++i )
+   int_data[ i ] = base + i;
+  for( std::size_t i = 0 ; i < dbl_data.size() ; ++i )
+   dbl_data[ i ] = base + 1.0e6 + i;
+
+  std::vector< double > data( int_data );
+  data.insert( data.end() , dbl_data.begin() , dbl_data.end() );
+
+  stochastic_block.set_data( data );
+
+  check( set_to_int , int_data , inner_block->get_data< int >() );
+  check( set_to_dbl , dbl_data , inner_block->get_data< double >() );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+template< class SetFrom , class SetTo >
+void test_statistics( std::size_t int_size , std::size_t dbl_size ,
+                      bool compiled ) {
+
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+
+ std::uniform_int_distribution< int > uniform_dist_int( 0 , int_size );
+ std::uniform_int_distribution< int > uniform_dist_dbl( 0 , dbl_size );
+
+ std::size_t scenario_int_size = uniform_dist_int( random_engine );
+ std::size_t scenario_dbl_size = uniform_dist_dbl( random_engine );
+
+ SetFrom set_from_int = build_sequential< SetFrom >( scenario_int_size );
+ SetTo set_to_int = build< SetTo >( scenario_int_size , int_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , int > >
+    ( get_method< SetTo , int >() , inner_block ,
+      set_from_int , set_to_int ) );
+
+ SetFrom set_from_dbl = build_sequential< SetFrom >
+  ( scenario_dbl_size , scenario_int_size );
+ SetTo set_to_dbl = build< SetTo >( scenario_dbl_size , dbl_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , double > >
+    ( get_method< SetTo , double >() , inner_block ,
+      set_from_dbl , set_to_dbl ) );
+
+ if( compiled )
+  stochastic_block.compile_data_mappings();
+ stochastic_block.enable_statistics();
+
+ std::vector< double > int_data( scenario_int_size );
+ std::vector< double > dbl_data( scenario_dbl_size );
+
+ for( std::size_t i = 0 ; i < int_data.size() ; ++i )
+  int_data[ i ] = 1.0e6 + i;
+ for( std::size_t i = 0 ; i < dbl_data.size() ; ++i )
+  dbl_data[ i ] = 2.0e6 + i;
+
+ std::vector< double > data( int_data );
+ data.insert( data.end() , dbl_data.begin() , dbl_data.end() );
+
+ stochastic_block.set_data( data );
+
+ check( set_to_int , int_data , inner_block->get_data< int >() );
+ check( set_to_dbl , dbl_data , inner_block->get_data< double >() );
+
+ auto statistics = stochastic_block.get_statistics();
+ assert( statistics->set_data_calls == 1 );
+ assert( statistics->elements[ 0 ] == scenario_int_size );
+ assert( statistics->elements[ 1 ] == scenario_dbl_size );
+}
+
+/*--------------------------------------------------------------------------*/
+
+template< class SetFrom , class SetTo >
+void test_deferred_mode( std::size_t int_size , std::size_t dbl_size ) {
+
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+
+ std::uniform_int_distribution< int > uniform_dist_int( 0 , int_size );
+ std::uniform_int_distribution< int > uniform_dist_dbl( 0 , dbl_size );
+
+ std::size_t scenario_int_size = uniform_dist_int( random_engine );
+ std::size_t scenario_dbl_size = uniform_dist_dbl( random_engine );
+
+ SetFrom set_from_int = build_sequential< SetFrom >( scenario_int_size );
+ SetTo set_to_int = build< SetTo >( scenario_int_size , int_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , int > >
+    ( get_method< SetTo , int >() , inner_block ,
+      set_from_int , set_to_int ) );
+
+ SetFrom set_from_dbl = build_sequential< SetFrom >
+  ( scenario_dbl_size , scenario_int_size );
+ SetTo set_to_dbl = build< SetTo >( scenario_dbl_size , dbl_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , double > >
+    ( get_method< SetTo , double >() , inner_block ,
+      set_from_dbl , set_to_dbl ) );
+
+ // nothing is written until flush_data()
+
+ stochastic_block.set_deferred_mode();
+
+ const auto old_int_data = inner_block->get_data< int >();
+ const auto old_dbl_data = inner_block->get_data< double >();
+
+ std::vector< double > int_data( scenario_int_size );
+ std::vector< double > dbl_data( scenario_dbl_size );
+
+ for( std::size_t i = 0 ; i < int_data.size() ; ++i )
+  int_data[ i ] = 5.0e6 + i;
+ for( std::size_t i = 0 ; i < dbl_data.size() ; ++i )
+  dbl_data[ i ] = 6.0e6 + i;
+
+ std::vector< double > data( int_data );
+ data.insert( data.end() , dbl_data.begin() , dbl_data.end() );
+
+ stochastic_block.set_data( data );
+ if( ! dbl_data.empty() ) {
+  dbl_data[ 0 ] = 7.0e6;
+  stochastic_block.set_data_entries( Subset( 1 , int_data.size() ) ,
+                                     dbl_data.begin() );
+  }
+
+ assert( inner_block->get_data< int >() == old_int_data );
+ assert( inner_block->get_data< double >() == old_dbl_data );
+
+ stochastic_block.flush_data();
+ assert( ! stochastic_block.has_pending_data() );
+
+ check( set_to_int , int_data , inner_block->get_data< int >() );
+ check( set_to_dbl , dbl_data , inner_block->get_data< double >() );
+}
+
+/*--------------------------------------------------------------------------*/
+
+template< class SetFrom , class SetTo >
+void test_deferred_statistics( std::size_t int_size , std::size_t dbl_size ,
+                               bool compiled ) {
+
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+
+ std::uniform_int_distribution< int > uniform_dist_int( 0 , int_size );
+ std::uniform_int_distribution< int > uniform_dist_dbl( 0 , dbl_size );
+
+ std::size_t scenario_int_size = uniform_dist_int( random_engine );
+ std::size_t scenario_dbl_size = uniform_dist_dbl( random_engine );
+
+ SetFrom set_from_int = build_sequential< SetFrom >( scenario_int_size );
+ SetTo set_to_int = build< SetTo >( scenario_int_size , int_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , int > >
+    ( get_method< SetTo , int >() , inner_block ,
+      set_from_int , set_to_int ) );
+
+ SetFrom set_from_dbl = build_sequential< SetFrom >
+  ( scenario_dbl_size , scenario_int_size );
+ SetTo set_to_dbl = build< SetTo >( scenario_dbl_size , dbl_size );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< SetFrom , SetTo , double > >
+    ( get_method< SetTo , double >() , inner_block ,
+      set_from_dbl , set_to_dbl ) );
+
+ if( compiled )
+  stochastic_block.compile_data_mappings();
+ stochastic_block.set_deferred_mode();
+
+ std::vector< double > int_data( scenario_int_size );
+ std::vector< double > dbl_data( scenario_dbl_size );
+ std::vector< double > data( scenario_int_size + scenario_dbl_size );
+
+ for( int step = 0 ; step < 2 ; ++step ) {
+  for( std::size_t i = 0 ; i < int_data.size() ; ++i )
+   data[ i ] = int_data[ i ] = 8.0e6 + 2.0e6 * step + i;
+  for( std::size_t i = 0 ; i < dbl_data.size() ; ++i )
+   data[ int_data.size() + i ] = dbl_data[ i ] = 9.0e6 + 2.0e6 * step + i;
+
+  // the statistics are enabled (first step) or reset (second step) after
+  // the scenario has been deferred
+
+  stochastic_block.set_data( data );
+  if( step == 0 )
+   stochastic_block.enable_statistics();
+  else
+   stochastic_block.reset_statistics();
+  stochastic_block.flush_data();
+
+  check( set_to_int , int_data , inner_block->get_data< int >() );
+  check( set_to_dbl , dbl_data , inner_block->get_data< double >() );
+
+  auto statistics = stochastic_block.get_statistics();
+  assert( statistics->set_data_calls == 0 );
+  assert( statistics->elements[ 0 ] == scenario_int_size );
+  assert( statistics->elements[ 1 ] == scenario_dbl_size );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+/*--------------------------------------------------------------------------*/
+
+void test_scenario_set( std::size_t dimension , std::size_t number ,
+                        bool with_probabilities ) {
+
+ std::uniform_int_distribution< int > value_dist( 0 , 100 );
+ std::vector< double > scenario( dimension );
+ ScenarioSet scenarios( dimension );
+ for( std::size_t s = 0 ; s < number ; ++s ) {
+  for( auto & value : scenario )
+   value = value_dist( random_engine );
+  scenarios.add_scenario( scenario.begin() ,
+                          with_probabilities ? 1 + s % 3 : -1 );
+  }
+
+ // a scenario of the set itself can be added, even if data is reallocated
+ if( number > 0 )
+  for( int repeat = 0 ; repeat < 3 ; ++repeat ) {
+   scenarios.add_scenario( scenarios.get_scenario( 0 ) );
+   for( std::size_t k = 0 ; k < dimension ; ++k )
+    assert( scenarios.get_scenario( scenarios.size() - 1 )[ k ] ==
+            scenarios.get_scenario( 0 )[ k ] );
+   }
+
+ // serialize and deserialize it back
+ const std::string filename = "test_scenario_set.nc4";
+ {
+  netCDF::NcFile file( filename , netCDF::NcFile::replace );
+  scenarios.serialize( file );
+ }
+ ScenarioSet copy;
+ {
+  netCDF::NcFile file( filename , netCDF::NcFile::read );
+  copy.deserialize( file );
+ }
+ std::remove( filename.c_str() );
+
+ assert( copy.size() == scenarios.size() );
+ assert( copy.get_dimension() == scenarios.get_dimension() );
+ assert( copy.get_probabilities() == scenarios.get_probabilities() );
+ for( Block::Index s = 0 ; s < copy.size() ; ++s )
+  for( std::size_t k = 0 ; k < dimension ; ++k )
+   assert( copy.get_scenario( s )[ k ] == scenarios.get_scenario( s )[ k ] );
+}
+
+/*--------------------------------------------------------------------------*/
+
+/// a ScenarioGenerator throwing when asked for a given scenario
+
+class ThrowingGenerator : public ScenarioGenerator {
+
+public:
+
+ explicit ThrowingGenerator( Index dimension ) : dimension( dimension ) {}
+
+ Index get_dimension() const override { return dimension; }
+
+ void generate( std::vector< double >::iterator scenario ,
+                RandomEngine & engine ) const override {
+  if( ++calls == 100 )
+   throw( std::runtime_error( "ThrowingGenerator" ) );
+  std::fill_n( scenario , dimension , 0.0 );
+ }
+
+ Index dimension;
+ mutable std::atomic< Index > calls = 0;
+};
+
+/*--------------------------------------------------------------------------*/
+
+void test_scenario_generator( std::size_t dbl_size ,
+                              std::size_t number_scenarios ) {
+
+ // a few scenarios, the last one having probability zero
+ std::uniform_int_distribution< int > value_dist( 0 , 100 );
+ ScenarioSet scenarios( dbl_size );
+ std::vector< double > scenario( dbl_size );
+ for( std::size_t s = 0 ; s < 4 ; ++s ) {
+  for( auto & value : scenario )
+   value = 1000 * s + value_dist( random_engine );
+  scenarios.add_scenario( scenario.begin() , s < 3 ? 1 + s : 0 );
+  }
+ ScenarioSetSampler sampler( scenarios );
+
+ auto engine = ScenarioGenerator::get_engine( 7 , 0 );
+ for( int d = 0 ; d < 100 ; ++d )
+  assert( sampler.draw( engine ) < 3 );
+
+ // the same seed gives the same scenarios whatever the number of threads
+ ScenarioSet serial;
+ sampler.fill( serial , number_scenarios , 42 , 1 );
+ assert( serial.size() == number_scenarios );
+ for( Block::Index s = 0 ; ( dbl_size > 0 ) && ( s < serial.size() ) ; ++s ) {
+  const auto sample = serial.get_scenario( s );
+  const auto k = Block::Index( sample[ 0 ] / 1000 );
+  assert( k < 3 );
+  for( std::size_t j = 0 ; j < dbl_size ; ++j )
+   assert( sample[ j ] == scenarios.get_scenario( k )[ j ] );
+  }
+
+ for( Block::Index threads : { 2 , 3 , 4 , 0 } ) {
+  ScenarioSet parallel;
+  sampler.fill( parallel , number_scenarios , 42 , threads );
+  assert( parallel.size() == serial.size() );
+  for( Block::Index s = 0 ; s < serial.size() ; ++s )
+   for( std::size_t j = 0 ; j < dbl_size ; ++j )
+    assert( parallel.get_scenario( s )[ j ] ==
+            serial.get_scenario( s )[ j ] );
+  }
+
+ // an exception thrown by generate() reaches the caller
+ ThrowingGenerator throwing( dbl_size );
+ ScenarioSet unused;
+ bool thrown = false;
+ try {
+  throwing.fill( unused , 1000 , 42 , 4 );
+  }
+ catch( const std::runtime_error & ) {
+  thrown = true;
+  }
+ assert( thrown );
+
+ // set_random_data() writes the scenario that the engine gives
+ auto inner_block = new DummyBlock( 0 , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< Range , Range , double > >
+    ( get_method< Range , double >() , inner_block ,
+      Range( 0 , dbl_size ) , Range( 0 , dbl_size ) ) );
+ stochastic_block.set_scenario_generator(
+  std::make_unique< ScenarioSetSampler >( scenarios ) );
+
+ auto block_engine = ScenarioGenerator::get_engine( 42 , 3 );
+ auto sampler_engine = ScenarioGenerator::get_engine( 42 , 3 );
+ for( int d = 0 ; d < 10 ; ++d ) {
+  stochastic_block.set_random_data( block_engine );
+  sampler.generate( scenario.begin() , sampler_engine );
+  assert( stochastic_block.get_random_data() == scenario );
+  assert( inner_block->get_data< double >() == scenario );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_snapshot( std::size_t int_size , std::size_t dbl_size ) {
+
+ auto inner_block = new DummyBlock( int_size , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+
+ Range set_to_int = build< Range >( int_size / 2 , int_size );
+ Subset set_to_dbl = build< Subset >( dbl_size / 2 , dbl_size );
+ const auto int_number = set_to_int.second - set_to_int.first;
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< Range , Range , int > >
+    ( get_method< Range , int >() , inner_block ,
+      build_sequential< Range >( int_number ) , set_to_int ,
+      "DummyBlock::set_data" ) );
+
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< Subset , Subset , double > >
+    ( get_method< Subset , double >() , inner_block ,
+      build_sequential< Subset >( set_to_dbl.size() , int_number ) ,
+      set_to_dbl , "DummyBlock::set_data" ) );
+
+ const auto int_data = inner_block->get_data< int >();
+ const auto dbl_data = inner_block->get_data< double >();
+ auto snapshot = stochastic_block.take_snapshot();
+
+ std::vector< double > data( int_number + set_to_dbl.size() );
+ std::uniform_int_distribution< int > value_dist( 100 , 200 );
+ for( auto & value : data )
+  value = value_dist( random_engine );
+ stochastic_block.set_data( data );
+
+ std::vector< double > current;
+ stochastic_block.get_current_data( current );
+ assert( current == data );
+
+ // the positions written since the Snapshot are restored without reading
+ auto reads = DummyBlock::reads.load();
+ stochastic_block.restore_snapshot( snapshot );
+ assert( DummyBlock::reads == reads );
+ assert( inner_block->get_data< int >() == int_data );
+ assert( inner_block->get_data< double >() == dbl_data );
+
+ // in delta mode, only the changed entry is written, and written back
+ inner_block->set_f_Block( & stochastic_block );
+ RecordingSolver solver;
+ stochastic_block.register_Solver( & solver );
+ auto written = [ & solver ]() {
+  std::size_t elements = 0;
+  for( const auto & mod : solver.modifications )
+   elements += std::static_pointer_cast< DummyModification >( mod )->elements;
+  solver.modifications.clear();
+  return( elements );
+ };
+
+ stochastic_block.set_delta_mode();
+ stochastic_block.set_data( data );
+ assert( written() == data.size() );
+ auto changed = stochastic_block.take_snapshot();
+ if( ! data.empty() ) {
+  data.back() += 1;
+  stochastic_block.set_data( data , eModBlck , eModBlck );
+  assert( written() == 1 );
+  }
+
+ reads = DummyBlock::reads;
+ stochastic_block.restore_snapshot( changed , eModBlck , eModBlck );
+ assert( DummyBlock::reads == reads );
+ assert( written() == ( data.empty() ? 0 : 1 ) );
+ if( ! data.empty() )
+  data.back() -= 1;
+ stochastic_block.get_current_data( current );
+ assert( current == data );
+
+ // an older Snapshot is restored by reading the current values first
+ reads = DummyBlock::reads;
+ stochastic_block.restore_snapshot( snapshot );
+ assert( DummyBlock::reads == reads + 2 );
+ assert( inner_block->get_data< int >() == int_data );
+ assert( inner_block->get_data< double >() == dbl_data );
+
+ stochastic_block.unregister_Solver( & solver );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_warm_start_cache() {
+
+ WarmStartCache cache( 2 );
+ std::vector< double > scenarios[] = { { 0 , 0 } , { 1 , 1 } , { 5 , 5 } };
+
+ cache.store( scenarios[ 0 ].cbegin() , 2 , nullptr );
+ cache.store( scenarios[ 1 ].cbegin() , 2 , nullptr );
+ cache.store( scenarios[ 2 ].cbegin() , 2 , nullptr );  // evicts { 0 , 0 }
+ assert( cache.size() == 2 );
+
+ bool exact;
+ cache.find( scenarios[ 1 ].cbegin() , 2 , & exact );
+ assert( exact && ( cache.get_exact_hits() == 1 ) );
+
+ cache.find( scenarios[ 0 ].cbegin() , 2 , & exact );  // { 1 , 1 } is closest
+ assert( ( ! exact ) && ( cache.get_nearest_hits() == 1 ) );
+
+ cache.set_max_distance( 1 );
+ cache.find( scenarios[ 0 ].cbegin() , 2 , & exact );
+ assert( cache.get_misses() == 1 );
+
+ assert( WarmStartCache::fingerprint( scenarios[ 0 ].cbegin() , 2 ) ==
+         WarmStartCache::fingerprint( std::vector< double >{ -0.0 , 0 }
+                                      .cbegin() , 2 ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_mapped_scenario_set( std::size_t dbl_size ,
+                               std::size_t number_scenarios ) {
+
+ auto inner_block = new DummyBlock( 0 , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+
+ Subset set_to = build< Subset >( dbl_size / 2 , dbl_size );
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< Subset , Subset , double > >
+    ( get_method< Subset , double >() , inner_block ,
+      build_sequential< Subset >( set_to.size() ) , set_to ) );
+
+ std::uniform_int_distribution< int > value_dist( 0 , 100 );
+ ScenarioSet scenarios( set_to.size() );
+ std::vector< double > scenario( set_to.size() );
+ for( std::size_t s = 0 ; s < number_scenarios ; ++s ) {
+  for( auto & value : scenario )
+   value = value_dist( random_engine );
+  scenarios.add_scenario( scenario.begin() );
+  }
+
+ auto check = [ & ]( Block::Index s ) {
+  const auto & data = inner_block->get_data< double >();
+  for( std::size_t k = 0 ; k < set_to.size() ; ++k )
+   assert( data[ set_to[ k ] ] == scenarios.get_scenario( s )[ k ] );
+ };
+
+ const std::string filename = "test_scenarios.bin";
+ MappedScenarioSet::write( filename , scenarios , & stochastic_block );
+ {
+  MappedScenarioSet mapped( filename );
+  assert( mapped.size() == scenarios.size() );
+  assert( mapped.get_dimension() == scenarios.get_dimension() );
+  assert( mapped.matches( stochastic_block ) );
+
+  for( Block::Index s = 0 ; s < mapped.size() ; ++s ) {
+   stochastic_block.set_data( mapped.get_scenario( s ) );
+   check( s );
+   }
+ }
+
+ // a header whose sizes overflow when multiplied is rejected: the
+ // dimension and the number (offsets 16 and 24), or the number of data
+ // mappings (offset 32)
+ using Patch = std::vector< std::pair< std::streamoff , std::uint64_t > >;
+ for( const auto & patch :
+       { Patch{ { 16 , 1ULL << 31 } , { 24 , 1ULL << 31 } } ,
+         Patch{ { 32 , 1ULL << 62 } } } ) {
+  MappedScenarioSet::write( filename , scenarios , & stochastic_block );
+  {
+   std::fstream file( filename , std::ios::in | std::ios::out |
+                                 std::ios::binary );
+   for( const auto & [ offset , value ] : patch ) {
+    file.seekp( offset );
+    file.write( reinterpret_cast< const char * >( & value ) ,
+                sizeof( value ) );
+    }
+  }
+  bool rejected = false;
+  try {
+   MappedScenarioSet mapped( filename );
+   }
+  catch( std::invalid_argument & ) {
+   rejected = true;
+   }
+  assert( rejected );
+  }
+
+ // a file of version 1 (with a 64-byte header) is rejected
+ MappedScenarioSet::write( filename , scenarios , & stochastic_block );
+ {
+  std::fstream file( filename , std::ios::in | std::ios::out |
+                                std::ios::binary );
+  const std::uint32_t old_version = 1;
+  file.seekp( 8 );
+  file.write( reinterpret_cast< const char * >( & old_version ) ,
+              sizeof( old_version ) );
+ }
+ {
+  bool rejected = false;
+  try {
+   MappedScenarioSet mapped( filename );
+   }
+  catch( std::invalid_argument & ) {
+   rejected = true;
+   }
+  assert( rejected );
+ }
+
+ // the values are small integers, hence they are stored exactly
+ for( auto precision : { CompactScenarioSet::eFloat ,
+                         CompactScenarioSet::eQuantized } ) {
+  CompactScenarioSet compact( scenarios , precision );
+  for( Block::Index s = 0 ; s < compact.size() ; ++s ) {
+   stochastic_block.set_data( compact , s );
+   check( s );
+   }
+
+  MappedScenarioSet::write( filename , compact );
+  MappedScenarioSet mapped( filename );
+  assert( mapped.get_precision() == precision );
+  std::vector< double > scenario( mapped.get_dimension() );
+  for( Block::Index s = 0 ; s < mapped.size() ; ++s ) {
+   mapped.get_scenario( s , scenario.data() );
+   stochastic_block.set_data( scenario );
+   check( s );
+   }
+  }
+ std::remove( filename.c_str() );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_prefetcher( std::size_t dbl_size , std::size_t number_scenarios ,
+                      Block::Index depth ) {
+
+ auto inner_block = new DummyBlock( 0 , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< Range , Range , double > >
+    ( get_method< Range , double >() , inner_block ,
+      build_sequential< Range >( dbl_size ) ,
+      build_sequential< Range >( dbl_size ) ) );
+
+ std::uniform_int_distribution< int > value_dist( 0 , 100 );
+ ScenarioSet scenarios( dbl_size );
+ std::vector< double > scenario( dbl_size );
+ for( std::size_t s = 0 ; s < number_scenarios ; ++s ) {
+  for( auto & value : scenario )
+   value = value_dist( random_engine );
+  scenarios.add_scenario( scenario.begin() );
+  }
+
+ // a shuffled sequence, with a repeated scenario
+ std::vector< Block::Index > sequence( number_scenarios );
+ std::iota( sequence.begin() , sequence.end() , 0 );
+ std::shuffle( sequence.begin() , sequence.end() , random_engine );
+ if( number_scenarios > 0 )
+  sequence.push_back( sequence.front() );
+
+ ScenarioPrefetcher prefetcher( scenarios , depth );
+ prefetcher.start( std::vector< Block::Index >( sequence ) );
+ for( auto s : sequence ) {
+  assert( prefetcher.apply_next( stochastic_block ) );
+  assert( prefetcher.get_scenario_index() == s );
+  const auto & data = inner_block->get_data< double >();
+  for( std::size_t k = 0 ; k < dbl_size ; ++k )
+   assert( data[ k ] == scenarios.get_scenario( s )[ k ] );
+  }
+ assert( ! prefetcher.next() );
+
+ // an exception thrown when loading is rethrown by next()
+ ScenarioPrefetcher failing( dbl_size , [ & ]( Block::Index i , double * ) {
+  if( i == 1 )
+   throw( std::runtime_error( "failing" ) );
+ } , depth );
+ failing.start( 0 , 3 );
+ assert( failing.next() );
+ bool thrown = false;
+ try {
+  failing.next();
+  }
+ catch( const std::runtime_error & ) {
+  thrown = true;
+  }
+ assert( thrown );
+ assert( ! failing.next() );
+
+ // stopping before all the scenarios are taken
+ prefetcher.start( 0 , number_scenarios );
+ prefetcher.next();
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_scenario_tree( std::size_t dbl_size , bool delta_mode ) {
+
+ auto inner_block = new DummyBlock( 0 , dbl_size );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+ Subset set_to = build< Subset >( dbl_size / 2 , dbl_size );
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< Subset , Subset , double > >
+    ( get_method< Subset , double >() , inner_block ,
+      build_sequential< Subset >( set_to.size() ) , set_to ) );
+ stochastic_block.set_delta_mode( delta_mode );
+
+ // three stages, each node changing a random subset of the entries
+ std::uniform_int_distribution< int > value_dist( 0 , 100 );
+ std::vector< double > root( set_to.size() );
+ for( auto & value : root )
+  value = value_dist( random_engine );
+ ScenarioTree tree( std::move( root ) );
+ Subset stage_nodes( 1 , 0 );
+ for( int stage = 0 ; stage < 3 ; ++stage ) {
+  Subset next_nodes;
+  for( auto parent : stage_nodes )
+   for( int c = 0 ; c < 2 ; ++c ) {
+    auto positions = build< Subset >( set_to.size() / 3 , set_to.size() );
+    std::vector< double > values( positions.size() );
+    for( auto & value : values )
+     value = value_dist( random_engine );
+    next_nodes.push_back( tree.add_node( parent , std::move( positions ) ,
+                                         std::move( values ) , 0.5 ) );
+    }
+  stage_nodes = std::move( next_nodes );
+  }
+ assert( tree.get_leaves() == stage_nodes );
+
+ std::vector< double > scenario( set_to.size() );
+ Block::Index visited = 0;
+ tree.traverse( stochastic_block , [ & ]( StochasticBlock & , Block::Index n ) {
+  ++visited;
+  tree.get_scenario( n , scenario.data() );
+  const auto & data = inner_block->get_data< double >();
+  for( std::size_t k = 0 ; k < set_to.size() ; ++k )
+   assert( data[ set_to[ k ] ] == scenario[ k ] );
+ } );
+ assert( visited == tree.size() );
+
+ auto scenarios = tree.get_scenario_set();
+ assert( scenarios.size() == stage_nodes.size() );
+ double total = 0;
+ for( auto probability : scenarios.get_probabilities() )
+  total += probability;
+ assert( std::abs( total - 1 ) < 1e-12 );
+
+ // the last scenario of the delta mode has followed the traversal
+ stochastic_block.set_data( scenarios , 0 );
+ const auto & data = inner_block->get_data< double >();
+ for( std::size_t k = 0 ; k < set_to.size() ; ++k )
+  assert( data[ set_to[ k ] ] == scenarios.get_scenario( 0 )[ k ] );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_ordering( std::size_t dimension , std::size_t number_scenarios ) {
+
+ // scenarios changing few entries at a time, then shuffled
+ std::uniform_int_distribution< int > value_dist( 0 , 3 );
+ ScenarioSet sorted( dimension );
+ std::vector< double > scenario( dimension , 0 );
+ for( std::size_t s = 0 ; s < number_scenarios ; ++s ) {
+  if( dimension > 0 )
+   scenario[ s % dimension ] = value_dist( random_engine );
+  sorted.add_scenario( scenario.begin() , s + 1 );
+  }
+ std::vector< Block::Index > shuffle( number_scenarios );
+ std::iota( shuffle.begin() , shuffle.end() , 0 );
+ std::shuffle( shuffle.begin() , shuffle.end() , random_engine );
+ ScenarioSet scenarios( dimension );
+ for( auto s : shuffle )
+  scenarios.add_scenario( sorted.get_scenario( s ) ,
+                          sorted.get_probabilities()[ s ] );
+
+ std::size_t changed;
+ ScenarioOrdering ordering;
+ for( auto method : { ScenarioOrdering::eNearestNeighbour ,
+                      ScenarioOrdering::eClustering } ) {
+  ordering.set_method( method );
+  ordering.set_cluster_size( 4 );
+  std::vector< Block::Index > permutation;
+  auto reordered = ordering.reorder( scenarios , & permutation );
+
+  // a permutation, starting from the first scenario
+  auto check = permutation;
+  std::sort( check.begin() , check.end() );
+  for( std::size_t i = 0 ; i < check.size() ; ++i )
+   assert( check[ i ] == i );
+  assert( permutation.empty() || ( permutation.front() == 0 ) );
+
+  for( std::size_t i = 0 ; i < permutation.size() ; ++i ) {
+   assert( std::equal( reordered.get_scenario( i ) ,
+                       reordered.get_scenario( i ) + dimension ,
+                       scenarios.get_scenario( permutation[ i ] ) ) );
+   assert( reordered.get_probabilities()[ i ] ==
+           scenarios.get_probabilities()[ permutation[ i ] ] );
+   }
+
+  // the second scenario is the closest one to the first
+  if( ( method == ScenarioOrdering::eNearestNeighbour ) &&
+      ( permutation.size() > 1 ) ) {
+   ordering.evaluate( scenarios , { 0 , permutation[ 1 ] } , & changed );
+   for( Block::Index s = 1 ; s < scenarios.size() ; ++s ) {
+    std::size_t other;
+    ordering.evaluate( scenarios , { 0 , s } , & other );
+    assert( changed <= other );
+    }
+   }
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_scenario_reduction( Block::Index block_size ) {
+
+ // four one-dimensional scenarios, small enough to be reduced by hand
+ ScenarioSet scenarios( 1 );
+ for( double value : { 0.0 , 1.1 , 2.0 , 3.0 } )
+  scenarios.add_scenario( & value );
+ scenarios.set_probabilities( { 0.35 , 0.1 , 0.15 , 0.4 } );
+
+ // forward selection picks 2 (the best single scenario) and then 0; the
+ // scenarios 1 and 3 are both closer to 2
+ ScenarioReduction reduction( ScenarioReduction::eForwardSelection );
+ reduction.set_block_size( block_size );
+ std::vector< Block::Index > assignment;
+ auto reduced = reduction.reduce( scenarios , 2 , & assignment );
+ assert( reduced.size() == 2 );
+ assert( reduced.get_scenario( 0 )[ 0 ] == 0.0 );
+ assert( reduced.get_scenario( 1 )[ 0 ] == 2.0 );
+ assert( std::abs( reduced.get_probabilities()[ 0 ] - 0.35 ) < 1e-12 );
+ assert( std::abs( reduced.get_probabilities()[ 1 ] - 0.65 ) < 1e-12 );
+ assert( ( assignment == std::vector< Block::Index >{ 0 , 1 , 1 , 1 } ) );
+
+ // backward reduction removes 1 (cost 0.1 * 0.9) and then 2 (cost
+ // 0.15 * 1); the probability of 1 goes to 0, which is its closest kept
+ // scenario, and not to 3 through 2
+ reduction.set_method( ScenarioReduction::eBackwardReduction );
+ reduced = reduction.reduce( scenarios , 2 , & assignment );
+ assert( reduced.size() == 2 );
+ assert( reduced.get_scenario( 0 )[ 0 ] == 0.0 );
+ assert( reduced.get_scenario( 1 )[ 0 ] == 3.0 );
+ assert( std::abs( reduced.get_probabilities()[ 0 ] - 0.45 ) < 1e-12 );
+ assert( std::abs( reduced.get_probabilities()[ 1 ] - 0.55 ) < 1e-12 );
+ assert( ( assignment == std::vector< Block::Index >{ 0 , 0 , 1 , 1 } ) );
+
+ // five clusters of scenarios, more than the default number of candidates:
+ // forward selection picks one scenario out of each cluster, both with the
+ // sampled candidates and with all of them
+ std::uniform_real_distribution< double > noise( 0 , 1 );
+ ScenarioSet clusters( 3 );
+ std::vector< double > scenario( 3 );
+ const Block::Index number = 5 * ScenarioReduction::default_max_candidates;
+ for( Block::Index k = 0 ; k < number ; ++k ) {
+  for( auto & value : scenario )
+   value = 100.0 * ( k % 5 ) + noise( random_engine );
+  clusters.add_scenario( scenario.begin() );
+  }
+
+ reduction.set_method( ScenarioReduction::eForwardSelection );
+ for( Block::Index max_candidates :
+       { ScenarioReduction::default_max_candidates , Block::Index( 0 ) } ) {
+  reduction.set_max_candidates( max_candidates );
+  reduced = reduction.reduce( clusters , 5 , & assignment );
+  assert( reduced.size() == 5 );
+  for( Block::Index c = 0 ; c < 5 ; ++c )
+   assert( std::abs( reduced.get_probabilities()[ c ] - 0.2 ) < 1e-12 );
+  for( Block::Index k = 0 ; k < number ; ++k )
+   assert( Block::Index( reduced.get_scenario( assignment[ k ] )[ 0 ] / 100 )
+           == k % 5 );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_lazy_deserialization( std::size_t dbl_size ) {
+
+ const std::string filename = "test_lazy_deserialization.nc4";
+ {
+  auto inner_block = new DummyBlock( 0 , dbl_size );
+  StochasticBlock stochastic_block( nullptr , inner_block );
+  stochastic_block.add_data_mapping
+   ( std::make_unique< SimpleDataMapping< Range , Range , double > >
+     ( get_method< Range , double >() , inner_block ,
+       build_sequential< Range >( dbl_size ) ,
+       build_sequential< Range >( dbl_size ) , "DummyBlock::set_data" ) );
+  netCDF::NcFile file( filename , netCDF::NcFile::replace );
+  stochastic_block.serialize( file );
+ }
+
+ netCDF::NcFile file( filename , netCDF::NcFile::read );
+ StochasticBlock::set_lazy_deserialization();
+ StochasticBlock stochastic_block;
+ stochastic_block.deserialize( file );
+ StochasticBlock::set_lazy_deserialization( false );
+
+ // nothing is built until it is needed
+ assert( stochastic_block.get_nested_Blocks().empty() );
+
+ // several threads needing it at the same time get the same inner Block
+ std::vector< Block * > inner_blocks( 4 , nullptr );
+ std::vector< std::size_t > sizes( inner_blocks.size() );
+ std::vector< std::thread > threads;
+ for( std::size_t t = 0 ; t < inner_blocks.size() ; ++t )
+  threads.emplace_back( [ & , t ]() {
+   const StochasticBlock & reader = stochastic_block;
+   inner_blocks[ t ] = reader.get_inner_block();
+   sizes[ t ] = reader.get_data_mappings().size();
+   } );
+ for( auto & thread : threads )
+  thread.join();
+ for( std::size_t t = 0 ; t < inner_blocks.size() ; ++t ) {
+  assert( inner_blocks[ t ] && ( inner_blocks[ t ] == inner_blocks[ 0 ] ) );
+  assert( sizes[ t ] == 1 );
+  }
+ assert( stochastic_block.get_nested_Blocks().size() == 1 );
+ assert( stochastic_block.get_nested_Blocks().front() == inner_blocks[ 0 ] );
+
+ // completing it again does nothing, and the data mappings work
+ stochastic_block.complete_deserialization();
+ assert( stochastic_block.get_inner_block() == inner_blocks[ 0 ] );
+ std::vector< double > scenario( dbl_size );
+ std::iota( scenario.begin() , scenario.end() , 10.0 );
+ stochastic_block.set_data( scenario );
+ auto inner_block = static_cast< DummyBlock * >( inner_blocks[ 0 ] );
+ assert( inner_block->get_data< double >() == scenario );
+
+ // deserializing it lazily again drops the inner Block right away
+ StochasticBlock::set_lazy_deserialization();
+ stochastic_block.deserialize( file );
+ StochasticBlock::set_lazy_deserialization( false );
+ assert( stochastic_block.get_nested_Blocks().empty() );
+
+ // a Solver generating the abstract representation completes it
+ stochastic_block.generate_abstract_variables();
+ assert( stochastic_block.get_nested_Blocks().size() == 1 );
+ inner_block = static_cast< DummyBlock * >(
+  stochastic_block.get_inner_block() );
+ std::iota( scenario.begin() , scenario.end() , 0.0 );
+ assert( inner_block->get_data< double >() == scenario );
+
+ file.close();
+ std::remove( filename.c_str() );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_clone( std::size_t dbl_size ) {
+
+ // the inner Block has a nested Block, and a data mapping for each one
+ auto inner_block = new DummyBlock( 0 , dbl_size );
+ auto nested_block = new DummyBlock( 0 , dbl_size );
+ inner_block->add_nested_Block( nested_block );
+ StochasticBlock prototype( nullptr , inner_block );
+ Subset set_to = build< Subset >( dbl_size / 2 , dbl_size );
+ for( auto block : { inner_block , nested_block } )
+  prototype.add_data_mapping
+   ( std::make_unique< SimpleDataMapping< Range , Subset , double > >
+     ( get_method< Subset , double >() , block ,
+       build_sequential< Range >( set_to.size() ) , set_to ) );
+ prototype.set_delta_mode();
+
+ ScenarioEvaluator evaluator( prototype , 3 );
+ std::uniform_int_distribution< int > value_dist( 0 , 100 );
+ std::vector< double > scenario( set_to.size() );
+ for( Block::Index w = 0 ; w < evaluator.get_number_workers() ; ++w ) {
+  auto & worker = evaluator.get_worker( w );
+  auto worker_inner = static_cast< DummyBlock * >( worker.get_inner_block() );
+  assert( worker_inner && ( worker_inner != inner_block ) );
+  assert( worker.get_data_mappings().size() == 2 );
+  assert( worker.get_data_mappings()[ 0 ]->get_block() == worker_inner );
+  assert( worker.get_data_mappings()[ 1 ]->get_block() ==
+          worker_inner->get_nested_Block( 0 ) );
+
+  for( auto & value : scenario )
+   value = 1000 + value_dist( random_engine );
+  worker.set_data( scenario );
+  for( auto block : { worker_inner ,
+                      static_cast< DummyBlock * >(
+                       worker_inner->get_nested_Block( 0 ) ) } ) {
+   const auto & data = block->get_data< double >();
+   for( std::size_t k = 0 ; k < set_to.size() ; ++k )
+    assert( data[ set_to[ k ] ] == scenario[ k ] );
+   }
+  }
+
+ // the prototype is untouched
+ for( auto block : { inner_block , nested_block } ) {
+  const auto & data = block->get_data< double >();
+  for( std::size_t k = 0 ; k < dbl_size ; ++k )
+   assert( data[ k ] == k );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_scenario_statistics( std::size_t dimension , std::size_t number ,
+                               Block::Index bins ) {
+
+ std::uniform_real_distribution< double > value_dist( 0 , 100 );
+ auto scenarios = std::make_unique< ScenarioSet >( dimension );
+ std::vector< double > scenario( dimension );
+ for( std::size_t s = 0 ; s < number ; ++s ) {
+  for( auto & value : scenario )
+   value = std::round( value_dist( random_engine ) );
+  scenarios->add_scenario( scenario.begin() ,
+                           1 + std::round( value_dist( random_engine ) ) );
+  }
+ scenarios->normalize_probabilities();
+
+ ScenarioStatistics statistics( dimension , bins );
+ statistics.add( *scenarios );
+ assert( statistics.size() == number );
+ if( number == 0 )
+  return;
+
+ // compared with the direct computation
+ const double p = value_dist( random_engine ) / 100;
+ const auto mean = statistics.get_mean();
+ const auto variance = statistics.get_variance();
+ const auto quantile = bins > 0 ? statistics.get_quantile( p ) :
+                       std::vector< double >();
+ for( std::size_t e = 0 ; e < dimension ; ++e ) {
+  double expected_mean = 0;
+  for( std::size_t s = 0 ; s < number ; ++s )
+   expected_mean += scenarios->get_probability( s ) *
+                    scenarios->get_scenario( s )[ e ];
+  double expected_variance = 0;
+  for( std::size_t s = 0 ; s < number ; ++s )
+   expected_variance += scenarios->get_probability( s ) *
+                        std::pow( scenarios->get_scenario( s )[ e ] -
+                                  expected_mean , 2 );
+  assert( std::abs( mean[ e ] - expected_mean ) < 1e-9 );
+  assert( std::abs( variance[ e ] - expected_variance ) < 1e-6 );
+
+  std::vector< std::pair< double , double > > values;
+  for( std::size_t s = 0 ; s < number ; ++s )
+   values.emplace_back( scenarios->get_scenario( s )[ e ] ,
+                        scenarios->get_probability( s ) );
+  std::sort( values.begin() , values.end() );
+  double cumulative = 0;
+  double expected_quantile = values.back().first;
+  for( const auto & [ value , probability ] : values )
+   if( ( cumulative += probability ) >= p - 1e-12 ) {
+    expected_quantile = value;
+    break;
+    }
+  if( bins == 0 )
+   continue;
+  if( statistics.is_quantile_exact() )
+   assert( quantile[ e ] == expected_quantile );
+  else  // within (about) a cell of the histogram
+   assert( std::abs( quantile[ e ] - expected_quantile ) <=
+           4 * ( values.back().first - values.front().first ) / bins + 1 );
+  }
+
+ // the same, decoding the scenarios
+ ScenarioStatistics compact_statistics( dimension , bins );
+ compact_statistics.add( CompactScenarioSet( *scenarios ,
+                                             CompactScenarioSet::eDouble ) );
+ const auto compact_mean = compact_statistics.get_mean();
+ for( std::size_t e = 0 ; e < dimension ; ++e )
+  assert( std::abs( compact_mean[ e ] - mean[ e ] ) < 1e-9 );
+
+ // the expected scenario is written into the inner Block
+ auto inner_block = new DummyBlock( 0 , 2 * dimension );
+ StochasticBlock stochastic_block( nullptr , inner_block );
+ Subset set_to = build< Subset >( dimension , 2 * dimension );
+ stochastic_block.add_data_mapping
+  ( std::make_unique< SimpleDataMapping< Range , Subset , double > >
+    ( get_method< Subset , double >() , inner_block ,
+      build_sequential< Range >( dimension ) , set_to ) );
+ stochastic_block.set_scenario_set( std::move( scenarios ) );
+ stochastic_block.set_expected_data();
+ const auto & data = inner_block->get_data< double >();
+ for( std::size_t e = 0 ; e < dimension ; ++e )
+  assert( data[ set_to[ e ] ] == mean[ e ] );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_deserialization_threads( std::size_t number_mappings ,
+                                   Block::Index number_threads ) {
+
+ // one data mapping for each entry of the scenario, of every kind, half of
+ // them writing into a nested Block
+ const std::string filename = "test_deserialization_threads.nc4";
+ auto inner_block = new DummyBlock( number_mappings , number_mappings );
+ auto nested_block = new DummyBlock( number_mappings , number_mappings );
+ inner_block->add_nested_Block( nested_block );
+ StochasticBlock original( nullptr , inner_block );
+ for( std::size_t k = 0 ; k < number_mappings ; ++k ) {
+  Block * block = ( k / 8 ) % 2 ? nested_block : inner_block;
+  const Block::Index from = k;
+  const Block::Index to = number_mappings - 1 - k;
+  switch( k % 8 ) {
+   case 0:
+    original.add_data_mapping( single_mapping< Subset , Subset , double >(
+     block , from , to ) );
+    break;
+   case 1:
+    original.add_data_mapping( single_mapping< Subset , Range , double >(
+     block , from , to ) );
+    break;
+   case 2:
+    original.add_data_mapping( single_mapping< Range , Subset , double >(
+     block , from , to ) );
+    break;
+   case 3:
+    original.add_data_mapping( single_mapping< Range , Range , double >(
+     block , from , to ) );
+    break;
+   case 4:
+    original.add_data_mapping( single_mapping< Subset , Subset , int >(
+     block , from , to ) );
+    break;
+   case 5:
+    original.add_data_mapping( single_mapping< Subset , Range , int >(
+     block , from , to ) );
+    break;
+   case 6:
+    original.add_data_mapping( single_mapping< Range , Subset , int >(
+     block , from , to ) );
+    break;
+   default:
+    original.add_data_mapping( single_mapping< Range , Range , int >(
+     block , from , to ) );
+   }
+  }
+
+ // and one writing the whole scenario, whose Subset sets are progressions
+ Subset all_from( number_mappings );
+ std::iota( all_from.begin() , all_from.end() , 0 );
+ Subset all_to( all_from.rbegin() , all_from.rend() );
+ original.add_data_mapping(
+  std::make_unique< SimpleDataMapping< Subset , Subset , double > >(
+   get_method< Subset , double >() , inner_block , std::move( all_from ) ,
+   std::move( all_to ) , "DummyBlock::set_data" ) );
+
+ std::uniform_int_distribution< int > value_dist( 0 , 100 );
+ std::vector< double > scenario( number_mappings );
+ for( auto & value : scenario )
+  value = value_dist( random_engine );
+ original.set_data( scenario );
+
+ // the "DataMappings" group is only written when enabled
+ for( bool group : { false , true } ) {
+  StochasticBlock::set_data_mappings_group( group );
+  {
+   netCDF::NcFile file( filename , netCDF::NcFile::replace );
+   original.serialize( file );
+  }
+  StochasticBlock::set_data_mappings_group( false );
+
+  // whatever the number of threads, the deserialized data mappings write the
+  // same data as the original ones
+  netCDF::NcFile file( filename , netCDF::NcFile::read );
+  const auto data_mappings_group = file.getGroup( "DataMappings" );
+  assert( data_mappings_group.isNull() == ( ! group ) );
+
+  // the long progressions are written encoded, the single indices are not
+  if( group ) {
+   std::vector< int > type( number_mappings + 1 );
+   data_mappings_group.getVar( "Type" ).getVar( type.data() );
+   for( std::size_t k = 0 ; k < number_mappings ; ++k )
+    assert( ( type[ k ] & ( 8 | 16 ) ) == 0 );
+   assert( ( type.back() & ( 8 | 16 ) ) ==
+           ( number_mappings > 3 ? ( 8 | 16 ) : 0 ) );
+   }
+
+  for( auto threads : { Block::Index( 1 ) , number_threads } ) {
+   StochasticBlock::set_deserialization_threads( threads );
+   StochasticBlock copy;
+   copy.deserialize( file );
+   StochasticBlock::set_deserialization_threads( 1 );
+   assert( copy.get_data_mappings().size() == number_mappings + 1 );
+   copy.set_data( scenario );
+
+   auto copy_inner_block = static_cast< DummyBlock * >(
+    copy.get_inner_block() );
+   assert( copy_inner_block->get_number_nested_Blocks() == 1 );
+   auto copy_nested_block = static_cast< DummyBlock * >(
+    copy_inner_block->get_nested_Block( 0 ) );
+   for( auto [ block , copy_block ] :
+         { std::make_pair( inner_block , copy_inner_block ) ,
+           std::make_pair( nested_block , copy_nested_block ) } ) {
+    assert( copy_block->get_data< int >() == block->get_data< int >() );
+    assert( copy_block->get_data< double >() == block->get_data< double >() );
+    }
+   }
+
+  file.close();
+  }
+ std::remove( filename.c_str() );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_compressed_subset( std::size_t number_pieces ) {
+
+ // a mix of runs, strided progressions, repeated and random indices
+ std::uniform_int_distribution< int > piece_dist( 0 , 3 );
+ std::uniform_int_distribution< Block::Index > index_dist( 0 , 1000 );
+ std::uniform_int_distribution< int > length_dist( 1 , 10 );
+ Subset elements;
+ for( std::size_t p = 0 ; p < number_pieces ; ++p ) {
+  const auto piece = piece_dist( random_engine );
+  const auto length = length_dist( random_engine );
+  const auto first = index_dist( random_engine );
+  for( int k = 0 ; k < length ; ++k )
+   elements.push_back( piece == 0 ? first + k :
+                       piece == 1 ? first + 3 * k :
+                       piece == 2 ? first : index_dist( random_engine ) );
+  }
+
+ CompressedSubset compressed( elements );
+ assert( compressed.size() == elements.size() );
+ assert( compressed.decompress() == elements );
+ assert( std::equal( compressed.begin() , compressed.end() ,
+                     elements.begin() , elements.end() ) );
+ assert( compressed.is_sorted() ==
+         std::is_sorted( elements.begin() , elements.end() ) );
+ assert( compressed.max() == ( elements.empty() ? 0 :
+                               *std::max_element( elements.begin() ,
+                                                  elements.end() ) ) );
+
+ Subset visited;
+ compressed.for_each( [ & ]( Block::Index k ) { visited.push_back( k ); } );
+ assert( visited == elements );
+
+ Subset words;
+ compressed.encode( words );
+ assert( words.size() == compressed.encoded_size() );
+ assert( CompressedSubset::decode( words.cbegin() , words.size() ) ==
+         elements );
+
+ Subset positions;
+ for( std::size_t k = 0 ; k < elements.size() ; k += 1 + k % 3 )
+  positions.push_back( k );
+ Subset expected;
+ for( auto k : positions )
+  expected.push_back( elements[ k ] );
+ compressed.translate( positions );
+ assert( positions == expected );
+
+ CompressedSubset range( Range( 5 , 5 + number_pieces ) );
+ assert( range.is_range() && ( range.size() == number_pieces ) );
+ assert( range.get_segments().size() == ( number_pieces > 0 ) );
+ assert( range.memory() <= sizeof( CompressedSubset::Segment ) );
+ Subset sequence( number_pieces );
+ std::iota( sequence.begin() , sequence.end() , 5 );
+ assert( range.decompress() == sequence );
+ assert( CompressedSubset( sequence ).is_range() == ( number_pieces == 0 ||
+                                                      number_pieces >= 4 ) );
+}
+
+/*--------------------------------------------------------------------------*/
+
+void test_evaluator( std::size_t dbl_size , std::size_t number_scenarios ) {
+
+ Subset set_to = build< Subset >( dbl_size / 2 , dbl_size );
+ Range set_from = build_sequential< Range >( set_to.size() );
+
+ ScenarioEvaluator evaluator( 4 , [ & ]( Block::Index ) {
+  auto inner_block = new DummyBlock( 0 , dbl_size );
+  auto worker = std::make_unique< StochasticBlock >( nullptr , inner_block );
+  worker->add_data_mapping
+   ( std::make_unique< SimpleDataMapping< Range , Subset , double > >
+     ( get_method< Subset , double >() , inner_block , set_from , set_to ) );
+  worker->set_delta_mode();
+  return worker;
+ } );
+
+ std::uniform_real_distribution< double > value_dist( 0 , 100 );
+ ScenarioSet scenarios( set_to.size() );
+ std::vector< double > scenario( set_to.size() );
+ for( std::size_t s = 0 ; s < number_scenarios ; ++s ) {
+  for( auto & value : scenario )
+   value = std::round( value_dist( random_engine ) );
+  scenarios.add_scenario( scenario.begin() );
+  }
+
+ auto results = evaluator.evaluate< double >
+  ( scenarios , []( StochasticBlock & worker , Block::Index ) {
+   auto & data = static_cast< DummyBlock * >( worker.get_inner_block() )
+    ->get_data< double >();
+   return std::accumulate( data.begin() , data.end() , 0.0 );
+  } );
+
+ assert( results.size() == number_scenarios );
+
+ for( std::size_t s = 0 ; s < number_scenarios ; ++s ) {
+  double expected = dbl_size * ( dbl_size - 1 ) / 2.0;
+  for( std::size_t j = 0 ; j < set_to.size() ; ++j )
+   expected += *( scenarios.get_scenario( s ) + j ) - set_to[ j ];
+  assert( results[ s ] == expected );
+  }
+}
+
+/*--------------------------------------------------------------------------*/
+/*---------------------------------- MAIN ----------------------------------*/
+/*--------------------------------------------------------------------------*/
+
+int main() {
+
+ std::uniform_int_distribution< int > size_dist( 0 , 20 );
+
+ for( int i = 0 ; i < 10000 ; ++i ) {
+  test< Subset , Subset >( size_dist( random_engine ) ,
+                           size_dist( random_engine ) );
+
+  test< Subset , Range >( size_dist( random_engine ) ,
+                          size_dist( random_engine ) );
+
+  test< Range , Subset >( size_dist( random_engine ) ,
+                          size_dist( random_engine ) );
+
+  test< Range , Range >( size_dist( random_engine ) ,
+                         size_dist( random_engine ) );
+ }
+
+ for( int i = 0 ; i < 1000 ; ++i ) {
+  test_forwarded_modifications< Subset , Subset >( size_dist( random_engine ) ,
+                                                   size_dist( random_engine ) );
+
+  test_forwarded_modifications< Subset , Range >( size_dist( random_engine ) ,
+                                                  size_dist( random_engine ) );
+
+  test_forwarded_modifications< Range , Subset >( size_dist( random_engine ) ,
+                                                  size_dist( random_engine ) );
+
+  test_forwarded_modifications< Range , Range >( size_dist( random_engine ) ,
+                                                 size_dist( random_engine ) );
+ }
+
+ for( int i = 0 ; i < 1000 ; ++i ) {
+  test_scenario_set_index< Subset , Subset >( size_dist( random_engine ) ,
+                                              size_dist( random_engine ) );
+
+  test_scenario_set_index< Subset , Range >( size_dist( random_engine ) ,
+                                             size_dist( random_engine ) );
+
+  test_scenario_set_index< Range , Subset >( size_dist( random_engine ) ,
+                                             size_dist( random_engine ) );
+
+  test_scenario_set_index< Range , Range >( size_dist( random_engine ) ,
+                                            size_dist( random_engine ) );
+ }
+
+ for( int i = 0 ; i < 1000 ; ++i ) {
+  test_compiled_plan< Subset , Subset >( size_dist( random_engine ) ,
+                                         size_dist( random_engine ) );
+
+  test_compiled_plan< Subset , Range >( size_dist( random_engine ) ,
+                                        size_dist( random_engine ) );
+
+  test_compiled_plan< Range , Subset >( size_dist( random_engine ) ,
+                                        size_dist( random_engine ) );
+
+  test_compiled_plan< Range , Range >( size_dist( random_engine ) ,
+                                       size_dist( random_engine ) );
+ }
+
+ for( int i = 0 ; i < 1000 ; ++i ) {
+  test_statistics< Subset , Subset >( size_dist( random_engine ) ,
+                                      size_dist( random_engine ) ,
+                                      i % 2 );
+
+  test_statistics< Subset , Range >( size_dist( random_engine ) ,
+                                     size_dist( random_engine ) ,
+                                     i % 2 );
+
+  test_statistics< Range , Subset >( size_dist( random_engine ) ,
+                                     size_dist( random_engine ) ,
+                                     i % 2 );
+
+  test_statistics< Range , Range >( size_dist( random_engine ) ,
+                                    size_dist( random_engine ) ,
+                                    i % 2 );
+ }
+
+ for( int i = 0 ; i < 1000 ; ++i ) {
+  test_deferred_mode< Subset , Subset >( size_dist( random_engine ) ,
+                                         size_dist( random_engine ) );
+
+  test_deferred_mode< Subset , Range >( size_dist( random_engine ) ,
+                                        size_dist( random_engine ) );
+
+  test_deferred_mode< Range , Subset >( size_dist( random_engine ) ,
+                                        size_dist( random_engine ) );
+
+  test_deferred_mode< Range , Range >( size_dist( random_engine ) ,
+                                       size_dist( random_engine ) );
+ }
+
+ for( int i = 0 ; i < 1000 ; ++i ) {
+  test_deferred_statistics< Subset , Subset >( size_dist( random_engine ) ,
+                                               size_dist( random_engine ) ,
+                                               i % 2 );
+
+  test_deferred_statistics< Subset , Range >( size_dist( random_engine ) ,
+                                              size_dist( random_engine ) ,
+                                              i % 2 );
+
+  test_deferred_statistics< Range , Subset >( size_dist( random_engine ) ,
+                                              size_dist( random_engine ) ,
+                                              i % 2 );
+
+  test_deferred_statistics< Range , Range >( size_dist( random_engine ) ,
+                                             size_dist( random_engine ) ,
+                                             i % 2 );
+ }
+
+ for( int i = 0 ; i < 1000 ; ++i ) {
+  test_grouped_modifications< Subset , Subset >( size_dist( random_engine ) ,
+                                                 size_dist( random_engine ) );
+
+  test_grouped_modifications< Subset , Range >( size_dist( random_engine ) ,
+                                                size_dist( random_engine ) );
+
+  test_grouped_modifications< Range , Subset >( size_dist( random_engine ) ,
+                                                size_dist( random_engine ) );
+
+  test_grouped_modifications< Range , Range >( size_dist( random_engine ) ,
+                                               size_dist( random_engine ) );
+ }
+
+ for( int i = 0 ; i < 1000 ; ++i ) {
+  test_delta_mode< Subset , Subset >( size_dist( random_engine ) ,
+                                      size_dist( random_engine ) );
+
+  test_delta_mode< Subset , Range >( size_dist( random_engine ) ,
+                                     size_dist( random_engine ) );
+
+  test_delta_mode< Range , Subset >( size_dist( random_engine ) ,
+                                     size_dist( random_engine ) );
+
+  test_delta_mode< Range , Range >( size_dist( random_engine ) ,
+                                    size_dist( random_engine ) );
+ }
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_scenario_set( size_dist( random_engine ) % 4 ,
+                     size_dist( random_engine ) , i % 2 );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_evaluator( size_dist( random_engine ) , 50 );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_scenario_generator( size_dist( random_engine ) ,
+                           10 * size_dist( random_engine ) );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_snapshot( size_dist( random_engine ) , size_dist( random_engine ) );
+
+ test_warm_start_cache();
+
+ for( int i = 0 ; i < 10 ; ++i )
+  test_mapped_scenario_set( size_dist( random_engine ) , 5 );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_prefetcher( size_dist( random_engine ) , size_dist( random_engine ) ,
+                   1 + i % 4 );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_scenario_tree( size_dist( random_engine ) , i % 2 );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_ordering( size_dist( random_engine ) , 5 * size_dist( random_engine ) );
+
+ for( Block::Index block_size : { 1 , 3 , 100 } )
+  test_scenario_reduction( block_size );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_lazy_deserialization( size_dist( random_engine ) );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_clone( size_dist( random_engine ) );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_scenario_statistics( size_dist( random_engine ) ,
+                            5 * size_dist( random_engine ) , 2 * ( i % 10 ) );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_deserialization_threads( 100 * size_dist( random_engine ) , i % 5 );
+
+ for( int i = 0 ; i < 100 ; ++i )
+  test_compressed_subset( size_dist( random_engine ) );
 }